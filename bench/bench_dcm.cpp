@@ -0,0 +1,59 @@
+#include "structure.hpp"
+#include "serializers/dcm_buf.hpp"
+#include <benchmark/benchmark.h>
+#include <string>
+
+using namespace bp::literals;
+
+// chain of nested objects, every level carries a few scalars
+static bp::structure make_deep(size_t _levels) {
+    bp::structure s{{"level"_h, 0}, {"name"_h, "leaf node with string longer than node capacity"}};
+    for (size_t i = 1; i < _levels; ++i) {
+        s = bp::structure{{"level"_h, static_cast<int>(i)}, {"value"_h, 0.5 * static_cast<double>(i)}, {"child"_h, s}};
+    }
+    return s;
+}
+
+// flat array of small records
+static bp::structure make_wide(size_t _records) {
+    bp::structure s(bp::structure::value_type::Array);
+    for (size_t i = 0; i < _records; ++i) {
+        s.append(bp::structure{{"id"_h, static_cast<int>(i)}, {"value"_h, 0.5 * static_cast<double>(i)},
+                               {"status"_h, "ok"}, {"flags"_h, {true, false, nullptr}}});
+    }
+    return s;
+}
+
+template<bp::structure (*Make)(size_t)>
+static void BM_DcmSerialize(benchmark::State &_state) {
+    auto s = Make(static_cast<size_t>(_state.range(0)));
+    size_t size = 0;
+    for (auto _: _state) {
+        auto r = s.serialize<bp::serializers::Dcm>();
+        size = r.size();
+        benchmark::DoNotOptimize(r);
+    }
+    _state.SetBytesProcessed(static_cast<int64_t>(_state.iterations() * size));
+    _state.SetComplexityN(_state.range(0));
+}
+
+// message written into reused caller buffer: no allocation per message
+template<bp::structure (*Make)(size_t)>
+static void BM_DcmWriteBuffer(benchmark::State &_state) {
+    auto s = Make(static_cast<size_t>(_state.range(0)));
+    std::string buf(bp::serializers::dcm_writer::measure(s), '\0');
+    for (auto _: _state) {
+        auto size = bp::serializers::to_dcm(s, &buf[0], buf.size());
+        benchmark::DoNotOptimize(size);
+    }
+    _state.SetBytesProcessed(static_cast<int64_t>(_state.iterations() * buf.size()));
+    _state.SetComplexityN(_state.range(0));
+}
+
+// serialization time must grow linearly with both depth and width
+#define DCM_BENCHMARK(func) \
+    BENCHMARK_TEMPLATE(func, make_deep)->RangeMultiplier(4)->Range(64, 4096)->Complexity(benchmark::oN); \
+    BENCHMARK_TEMPLATE(func, make_wide)->RangeMultiplier(4)->Range(64, 65536)->Complexity(benchmark::oN)
+
+DCM_BENCHMARK(BM_DcmSerialize);
+DCM_BENCHMARK(BM_DcmWriteBuffer);
@@ -0,0 +1,192 @@
+#include "numbers.hpp"
+#include "structure.hpp"
+#include "serializers/json.hpp"
+#include "serializers/json_index.hpp"
+#include "serializers/json_reader.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace bp::literals;
+
+// telemetry-like document: array of records with numbers, short and long strings and nested objects
+static std::string make_document(size_t _records) {
+    std::mt19937 rnd(static_cast<uint32_t>(_records));
+    std::string doc = "[";
+    for (size_t i = 0; i < _records; ++i) {
+        if (i) doc += ",";
+        doc += "{\"id\":" + std::to_string(1000000000000ULL + rnd()) +
+               ",\"status\":\"ok\",\"device\":\"temperature sensor \\\"outdoor\\\" " + std::to_string(rnd() % 16) + "\"" +
+               ",\"value\":" + std::to_string((rnd() % 100000) / 100.0) +
+               ",\"flags\":[true,false,null]" +
+               ",\"location\":{\"lat\":" + std::to_string((rnd() % 18000) / 100.0) +
+               ",\"lon\":" + std::to_string((rnd() % 36000) / 100.0) + ",\"floor\":" + std::to_string(rnd() % 10) + "}}";
+    }
+    doc += "]";
+    return doc;
+}
+
+// numbers-only telemetry: arrays of samples with counters and measured values
+static std::string make_numbers(size_t _records) {
+    std::mt19937_64 rnd(_records);
+    std::uniform_real_distribution<double> value(-1000.0, 1000.0);
+    char buf[64];
+    std::string doc = "[";
+    for (size_t i = 0; i < _records; ++i) {
+        if (i) doc += ",";
+        std::snprintf(buf, sizeof(buf), "[%llu,%lld,%.17g,%.6g]", static_cast<unsigned long long>(rnd()),
+                      static_cast<long long>(rnd() % 2000000) - 1000000, value(rnd), value(rnd));
+        doc += buf;
+    }
+    doc += "]";
+    return doc;
+}
+
+template<bp::hash_type::type Serializer>
+static void BM_Parse(benchmark::State &_state) {
+    auto doc = make_document(static_cast<size_t>(_state.range(0)));
+    for (auto _: _state) {
+        bp::structure s;
+        s.parse<Serializer>(doc);
+        benchmark::DoNotOptimize(s);
+    }
+    _state.SetBytesProcessed(static_cast<int64_t>(_state.iterations() * doc.size()));
+}
+
+template<bp::hash_type::type Serializer>
+static void BM_ParseArena(benchmark::State &_state) {
+    auto doc = make_document(static_cast<size_t>(_state.range(0)));
+    bp::arena arena;
+    for (auto _: _state) {
+        {
+            bp::structure s(arena);
+            s.parse<Serializer>(doc);
+            benchmark::DoNotOptimize(s);
+        }
+        arena.release();
+    }
+    _state.SetBytesProcessed(static_cast<int64_t>(_state.iterations() * doc.size()));
+}
+
+template<bp::hash_type::type Serializer>
+static void BM_Serialize(benchmark::State &_state) {
+    auto s = bp::structure::create_from_string<bp::serializers::Json>(make_document(static_cast<size_t>(_state.range(0))));
+    size_t bytes = 0;
+    for (auto _: _state) {
+        auto out = s.serialize<Serializer>();
+        bytes += out.size();
+        benchmark::DoNotOptimize(out);
+    }
+    _state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+
+template<bp::hash_type::type Serializer>
+static void BM_NumbersParse(benchmark::State &_state) {
+    auto doc = make_numbers(static_cast<size_t>(_state.range(0)));
+    for (auto _: _state) {
+        auto s = bp::structure::create_from_string<Serializer>(doc);
+        benchmark::DoNotOptimize(s);
+    }
+    _state.SetBytesProcessed(static_cast<int64_t>(_state.iterations() * doc.size()));
+}
+
+template<bp::hash_type::type Serializer>
+static void BM_NumbersSerialize(benchmark::State &_state) {
+    auto s = bp::structure::create_from_string<bp::serializers::Json>(make_numbers(static_cast<size_t>(_state.range(0))));
+    size_t bytes = 0;
+    for (auto _: _state) {
+        auto out = s.serialize<Serializer>();
+        bytes += out.size();
+        benchmark::DoNotOptimize(out);
+    }
+    _state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+
+// shortest round-trip formatting against printf with enough digits to round-trip
+static void BM_FormatDouble(benchmark::State &_state) {
+    std::mt19937_64 rnd(1);
+    std::uniform_real_distribution<double> value(-1000.0, 1000.0);
+    std::vector<double> values(1024);
+    for (auto &v : values) v = value(rnd);
+    char buf[bp::max_number_chars];
+    size_t i = 0;
+    for (auto _: _state) {
+        auto v = values[i++ & 1023];
+        if (_state.range(0)) {
+            benchmark::DoNotOptimize(bp::format_double(buf, v));
+        } else {
+            benchmark::DoNotOptimize(std::snprintf(buf, sizeof(buf), "%.17g", v));
+        }
+    }
+    _state.SetItemsProcessed(static_cast<int64_t>(_state.iterations()));
+}
+
+template<bp::serializers::structural_index::kernel Kernel>
+static void BM_StructuralIndex(benchmark::State &_state) {
+    if (!bp::serializers::structural_index::supported(Kernel)) {
+        _state.SkipWithError("kernel is not supported by CPU");
+        return;
+    }
+    auto doc = make_document(static_cast<size_t>(_state.range(0)));
+    bp::serializers::structural_index index(Kernel);
+    for (auto _: _state) {
+        index.build(doc);
+        benchmark::DoNotOptimize(index.size());
+    }
+    _state.SetBytesProcessed(static_cast<int64_t>(_state.iterations() * doc.size()));
+}
+
+// picks id and value of every record, skipping everything else
+static void BM_SaxSelect(benchmark::State &_state) {
+    struct handler : bp::serializers::json_handler {
+        int64_t ids = 0;
+        double values = 0;
+
+        bool key(bp::hash_type _hash, const bp::string_view &) override {
+            return _hash == "id"_h || _hash == "value"_h;
+        }
+        void int_value(int64_t _val) override { ids += _val; }
+        void double_value(double _val) override { values += _val; }
+    } h;
+    auto doc = make_document(static_cast<size_t>(_state.range(0)));
+    bp::serializers::json_reader reader;
+    for (auto _: _state) {
+        reader.parse(doc, h);
+        benchmark::DoNotOptimize(h.ids);
+    }
+    _state.SetBytesProcessed(static_cast<int64_t>(_state.iterations() * doc.size()));
+    _state.counters["key_hit_rate"] = reader.keys().hit_rate();
+}
+
+// gateway: look at routing key and forward message
+template<bp::hash_type::type Serializer>
+static void BM_Route(benchmark::State &_state) {
+    auto doc = "{\"route\":\"telemetry\",\"records\":" + make_document(static_cast<size_t>(_state.range(0))) + "}";
+    for (auto _: _state) {
+        auto s = bp::structure::create_from_string<Serializer>(doc);
+        benchmark::DoNotOptimize(s.at("route"_h).template as<std::string>());
+        auto out = s.template serialize<bp::serializers::Json>();
+        benchmark::DoNotOptimize(out);
+    }
+    _state.SetBytesProcessed(static_cast<int64_t>(_state.iterations() * doc.size()));
+}
+
+#define JSON_BENCHMARK(func) \
+    BENCHMARK_TEMPLATE(func, bp::serializers::Json)->Arg(10)->Arg(1000)->Arg(100000); \
+    BENCHMARK_TEMPLATE(func, bp::serializers::JsonCpp)->Arg(10)->Arg(1000)->Arg(100000)
+
+JSON_BENCHMARK(BM_Parse);
+JSON_BENCHMARK(BM_ParseArena);
+JSON_BENCHMARK(BM_Serialize);
+JSON_BENCHMARK(BM_NumbersParse);
+JSON_BENCHMARK(BM_NumbersSerialize);
+BENCHMARK(BM_FormatDouble)->Arg(0)->Arg(1);
+BENCHMARK(BM_SaxSelect)->Arg(10)->Arg(1000)->Arg(100000);
+
+BENCHMARK_TEMPLATE(BM_StructuralIndex, bp::serializers::structural_index::kernel::Scalar)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_StructuralIndex, bp::serializers::structural_index::kernel::Sse42)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_StructuralIndex, bp::serializers::structural_index::kernel::Avx2)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_Route, bp::serializers::Json)->Arg(10)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_Route, bp::serializers::JsonLazy)->Arg(10)->Arg(1000)->Arg(100000);
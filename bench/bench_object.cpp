@@ -0,0 +1,126 @@
+#include "structure.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace bp::serializable;
+
+using map_type = std::map<bp::hash_type, tree_ptr>;
+using table_type = bp::hash_table<bp::hash_type, tree_ptr>;
+
+static std::vector<bp::hash_type> make_keys(size_t _n) {
+    std::mt19937 rnd(static_cast<uint32_t>(_n));
+    std::vector<bp::hash_type> keys;
+    keys.reserve(_n);
+    for (size_t i = 0; i < _n; ++i) {
+        keys.emplace_back(static_cast<bp::hash_type::type>(rnd()));
+    }
+    return keys;
+}
+
+template<typename Container>
+static void fill(Container &_c, const std::vector<bp::hash_type> &_keys, const tree_ptr &_val) {
+    for (const auto &key: _keys) {
+        _c.emplace(key, _val);
+    }
+}
+
+template<typename Container>
+static void BM_Insert(benchmark::State &_state) {
+    auto keys = make_keys(static_cast<size_t>(_state.range(0)));
+    auto val = make_tree(nullptr, 1);
+    for (auto _: _state) {
+        Container c;
+        fill(c, keys, val);
+        benchmark::DoNotOptimize(c);
+    }
+    _state.SetItemsProcessed(_state.iterations() * _state.range(0));
+}
+
+template<typename Container>
+static void BM_Lookup(benchmark::State &_state) {
+    auto keys = make_keys(static_cast<size_t>(_state.range(0)));
+    auto val = make_tree(nullptr, 1);
+    Container c;
+    fill(c, keys, val);
+    auto order = keys;
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+    for (auto _: _state) {
+        for (const auto &key: order) {
+            benchmark::DoNotOptimize(c.find(key));
+        }
+    }
+    _state.SetItemsProcessed(_state.iterations() * _state.range(0));
+}
+
+template<typename Container>
+static void BM_Erase(benchmark::State &_state) {
+    auto keys = make_keys(static_cast<size_t>(_state.range(0)));
+    auto val = make_tree(nullptr, 1);
+    for (auto _: _state) {
+        _state.PauseTiming();
+        Container c;
+        fill(c, keys, val);
+        _state.ResumeTiming();
+        for (const auto &key: keys) {
+            c.erase(key);
+        }
+        benchmark::DoNotOptimize(c);
+    }
+    _state.SetItemsProcessed(_state.iterations() * _state.range(0));
+}
+
+template<typename Container>
+static void BM_Iterate(benchmark::State &_state) {
+    auto keys = make_keys(static_cast<size_t>(_state.range(0)));
+    auto val = make_tree(nullptr, 1);
+    Container c;
+    fill(c, keys, val);
+    for (auto _: _state) {
+        size_t sum = 0;
+        for (const auto &kv: c) {
+            sum += kv.first;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    _state.SetItemsProcessed(_state.iterations() * _state.range(0));
+}
+
+// destruction of document with n records. Arena skips freeing of nodes, but node destructors still
+// visit the whole tree, so teardown is linear in both modes
+template<bool Arena>
+static void BM_Teardown(benchmark::State &_state) {
+    using namespace bp::literals;
+    bp::arena arena;
+    for (auto _: _state) {
+        _state.PauseTiming();
+        std::unique_ptr<bp::structure> s(Arena ? new bp::structure(bp::structure::value_type::Array, arena) :
+                                         new bp::structure(bp::structure::value_type::Array));
+        for (int i = 0; i < static_cast<int>(_state.range(0)); ++i) {
+            s->append(bp::structure());
+            auto record = (*s)[i];
+            record["id"_h] = i;
+            record["name"_h] = "record with string longer than node capacity";
+            record["tags"_h].append(i);
+        }
+        _state.ResumeTiming();
+        s.reset();
+        arena.release();
+    }
+    _state.SetItemsProcessed(_state.iterations() * _state.range(0));
+    _state.SetComplexityN(_state.range(0));
+}
+
+#define OBJECT_BENCHMARK(bench) \
+    BENCHMARK_TEMPLATE(bench, map_type)->Arg(1000)->Arg(100000)->Arg(1000000); \
+    BENCHMARK_TEMPLATE(bench, table_type)->Arg(1000)->Arg(100000)->Arg(1000000)
+
+OBJECT_BENCHMARK(BM_Insert);
+OBJECT_BENCHMARK(BM_Lookup);
+OBJECT_BENCHMARK(BM_Erase);
+OBJECT_BENCHMARK(BM_Iterate);
+BENCHMARK_TEMPLATE(BM_Teardown, false)->RangeMultiplier(10)->Range(1000, 100000)->Complexity(benchmark::oN);
+BENCHMARK_TEMPLATE(BM_Teardown, true)->RangeMultiplier(10)->Range(1000, 100000)->Complexity(benchmark::oN);
@@ -0,0 +1,84 @@
+#ifndef BP_ARENA_HPP
+#define BP_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bp {
+
+    /**
+     * Monotonic memory arena. Memory is handed out sequentially from large blocks,
+     * deallocation of separate chunks is a no-op and whole arena memory is returned at once
+     * on release() or destruction. Arena must outlive every structure bound to it.
+     * Dropping structure bound to arena still runs destructor of every node and container, because
+     * arena nodes may refer to heap strings, interned strings or containers shared with other trees.
+     * Only freeing of node memory is skipped, so teardown stays linear in document size.
+     */
+    class arena {
+    public:
+        static constexpr size_t default_block_size = 64 * 1024;
+
+        /**
+         * Create arena
+         * @param _block_size size of memory block requested from heap when arena is exhausted
+         */
+        explicit arena(size_t _block_size = default_block_size);
+
+        arena(const arena &) = delete;
+
+        arena &operator=(const arena &) = delete;
+
+        ~arena();
+
+        /**
+         * Allocate memory chunk
+         * @param _size chunk size
+         * @param _align chunk alignment
+         * @return pointer to allocated memory or nullptr if block allocation failed in node_pool::checked_scope
+         */
+        inline void *allocate(size_t _size, size_t _align = alignof(std::max_align_t)) {
+            auto p = (reinterpret_cast<uintptr_t>(cur_) + _align - 1) & ~(static_cast<uintptr_t>(_align) - 1);
+            if (p + _size > reinterpret_cast<uintptr_t>(end_)) {
+                return allocate_slow(_size, _align);
+            }
+            cur_ = reinterpret_cast<char *>(p + _size);
+            used_ += _size;
+            return reinterpret_cast<void *>(p);
+        }
+
+        /**
+         * Return all memory to arena. Most recently allocated block is kept for reuse, others are freed.
+         * All structures bound to arena must be destroyed before release
+         */
+        void release();
+
+        /**
+         * Get amount of memory handed out since creation or last release
+         * @return used bytes
+         */
+        inline size_t used() const { return used_; }
+
+        /**
+         * Get amount of memory requested from heap
+         * @return reserved bytes
+         */
+        inline size_t capacity() const { return capacity_; }
+
+    private:
+        struct block {
+            block *next;
+            size_t size;
+        };
+
+        void *allocate_slow(size_t _size, size_t _align);
+
+        block *head_ = nullptr;
+        char *cur_ = nullptr;
+        char *end_ = nullptr;
+        size_t block_size_;
+        size_t used_ = 0;
+        size_t capacity_ = 0;
+    };
+}
+
+#endif //BP_ARENA_HPP
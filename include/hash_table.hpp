@@ -0,0 +1,435 @@
+#ifndef BP_HASH_TABLE_HPP
+#define BP_HASH_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace bp {
+
+    /**
+     * Open-addressing hash table with Robin Hood probing and backward shift deletion.
+     * Keys are expected to be hashes already (e.g. bp::hash_type), they are only mixed
+     * with a multiplicative step to pick a slot. Entries are kept in one contiguous slot
+     * array with a parallel array of probe distances. Iteration order is unspecified.
+     * @tparam Key unsigned integer-convertible key
+     * @tparam T mapped type
+     * @tparam Alloc allocator for slot arrays
+     */
+    template<typename Key, typename T, typename Alloc = std::allocator<std::pair<const Key, T>>>
+    class hash_table {
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+        using value_type = std::pair<const Key, T>;
+        using size_type = size_t;
+        using allocator_type = Alloc;
+
+    private:
+        using traits = std::allocator_traits<Alloc>;
+        using slot_allocator = typename traits::template rebind_alloc<value_type>;
+        using slot_traits = std::allocator_traits<slot_allocator>;
+        using byte_allocator = typename traits::template rebind_alloc<uint8_t>;
+        using byte_traits = std::allocator_traits<byte_allocator>;
+
+        static constexpr size_t min_capacity = 16;
+        static constexpr uint8_t max_distance = 0xff;
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+    public:
+        template<bool Const>
+        class iterator_base : public std::iterator<std::forward_iterator_tag,
+                typename std::conditional<Const, const value_type, value_type>::type> {
+            friend class hash_table;
+
+            using entry_pointer = typename std::conditional<Const, const value_type *, value_type *>::type;
+        public:
+            using reference = typename std::conditional<Const, const value_type &, value_type &>::type;
+
+            iterator_base() = default;
+
+            template<bool C, typename = typename std::enable_if<Const && !C>::type>
+            iterator_base(const iterator_base<C> &_it) : slot_(_it.slot_), dist_(_it.dist_), end_(_it.end_) {}
+
+            inline reference operator*() const { return *slot_; }
+
+            inline entry_pointer operator->() const { return slot_; }
+
+            inline iterator_base &operator++() {
+                ++slot_;
+                ++dist_;
+                skip();
+                return *this;
+            }
+
+            inline iterator_base operator++(int) {
+                iterator_base tmp(*this);
+                operator++();
+                return tmp;
+            }
+
+            inline bool operator==(const iterator_base &_rhs) const { return dist_ == _rhs.dist_; }
+
+            inline bool operator!=(const iterator_base &_rhs) const { return dist_ != _rhs.dist_; }
+
+        private:
+            template<bool> friend class iterator_base;
+
+            iterator_base(entry_pointer _slot, const uint8_t *_dist, const uint8_t *_end) :
+                    slot_(_slot), dist_(_dist), end_(_end) {}
+
+            inline void skip() {
+                while (dist_ != end_ && *dist_ == 0) {
+                    ++slot_;
+                    ++dist_;
+                }
+            }
+
+            entry_pointer slot_ = nullptr;
+            const uint8_t *dist_ = nullptr;
+            const uint8_t *end_ = nullptr;
+        };
+
+        using iterator = iterator_base<false>;
+        using const_iterator = iterator_base<true>;
+
+        explicit hash_table(const Alloc &_alloc = Alloc()) : alloc_(_alloc) {}
+
+        hash_table(const hash_table &_t) :
+                alloc_(traits::select_on_container_copy_construction(_t.alloc_)) {
+            copy_from(_t);
+        }
+
+        hash_table(const hash_table &_t, const Alloc &_alloc) : alloc_(_alloc) {
+            copy_from(_t);
+        }
+
+        hash_table(hash_table &&_t) noexcept : alloc_(_t.alloc_) {
+            steal(_t);
+        }
+
+        hash_table(hash_table &&_t, const Alloc &_alloc) : alloc_(_alloc) {
+            if (alloc_ == _t.alloc_) {
+                steal(_t);
+            } else {
+                copy_from(_t);
+                _t.clear();
+            }
+        }
+
+        hash_table &operator=(const hash_table &_t) {
+            if (this != &_t) {
+                destroy();
+                copy_from(_t);
+            }
+            return *this;
+        }
+
+        hash_table &operator=(hash_table &&_t) {
+            if (this != &_t) {
+                destroy();
+                if (alloc_ == _t.alloc_) {
+                    steal(_t);
+                } else {
+                    copy_from(_t);
+                    _t.clear();
+                }
+            }
+            return *this;
+        }
+
+        ~hash_table() { destroy(); }
+
+        inline iterator begin() {
+            iterator it(slots_, dist_, dist_ + capacity_);
+            it.skip();
+            return it;
+        }
+
+        inline iterator end() { return iterator(slots_ + capacity_, dist_ + capacity_, dist_ + capacity_); }
+
+        inline const_iterator begin() const { return const_cast<hash_table *>(this)->begin(); }
+
+        inline const_iterator end() const { return const_cast<hash_table *>(this)->end(); }
+
+        inline size_t size() const { return size_; }
+
+        inline bool empty() const { return size_ == 0; }
+
+        inline size_t capacity() const { return capacity_; }
+
+        inline Alloc get_allocator() const { return alloc_; }
+
+        inline iterator find(const Key &_key) {
+            auto i = lookup(_key);
+            return i == npos ? end() : iterator_at(i);
+        }
+
+        inline const_iterator find(const Key &_key) const { return const_cast<hash_table *>(this)->find(_key); }
+
+        inline size_t count(const Key &_key) const { return lookup(_key) == npos ? 0 : 1; }
+
+        /**
+         * Prepare table for specified number of entries without rehashing.
+         * Table is left unchanged if allocation fails in node_pool::checked_scope
+         * @param _n expected number of entries
+         */
+        void reserve(size_t _n) {
+            size_t cap = min_capacity;
+            while (cap * 7 < _n * 8) cap <<= 1;
+            if (cap > capacity_) rehash(cap);
+        }
+
+        /**
+         * Insert entry unless key is present
+         * @return entry position and true if entry was inserted,
+         *         end() and false if table could not grow in node_pool::checked_scope
+         */
+        template<typename ...Args>
+        std::pair<iterator, bool> emplace(const Key &_key, Args &&..._args) {
+            auto i = lookup(_key);
+            if (i != npos) {
+                return std::make_pair(iterator_at(i), false);
+            }
+            if ((size_ + 1) * 8 > capacity_ * 7 && !rehash(capacity_ ? capacity_ * 2 : min_capacity)) {
+                return std::make_pair(end(), false);
+            }
+            ++size_;
+            i = insert_unique(value_type(std::piecewise_construct, std::forward_as_tuple(_key),
+                                         std::forward_as_tuple(std::forward<Args>(_args)...)));
+            if (i == npos) {
+                i = lookup(_key);
+                if (i == npos) {
+                    return std::make_pair(end(), false);
+                }
+            }
+            return std::make_pair(iterator_at(i), true);
+        }
+
+        template<typename ...Args>
+        inline iterator emplace_hint(const_iterator, const Key &_key, Args &&..._args) {
+            return emplace(_key, std::forward<Args>(_args)...).first;
+        }
+
+        T &operator[](const Key &_key) {
+            return emplace(_key).first->second;
+        }
+
+        size_t erase(const Key &_key) {
+            auto i = lookup(_key);
+            if (i == npos) return 0;
+            erase_at(i);
+            return 1;
+        }
+
+        iterator erase(const_iterator _pos) {
+            auto i = static_cast<size_t>(_pos.dist_ - dist_);
+            erase_at(i);
+            auto it = iterator_at(i);
+            it.skip();
+            return it;
+        }
+
+        void clear() {
+            for (size_t i = 0; i < capacity_; ++i) {
+                if (dist_[i]) {
+                    slots_[i].~value_type();
+                    dist_[i] = 0;
+                }
+            }
+            size_ = 0;
+        }
+
+    private:
+        inline iterator iterator_at(size_t _i) { return iterator(slots_ + _i, dist_ + _i, dist_ + capacity_); }
+
+        inline size_t slot_of(const Key &_key) const {
+            return static_cast<size_t>((static_cast<uint64_t>(_key) * 0x9E3779B97F4A7C15ull) >> shift_);
+        }
+
+        inline size_t lookup(const Key &_key) const {
+            if (!size_) return npos;
+            auto mask = capacity_ - 1;
+            auto i = slot_of(_key);
+            for (uint8_t d = 1;; ++d) {
+                auto sd = dist_[i];
+                if (sd < d) return npos;
+                if (sd == d && slots_[i].first == _key) return i;
+                i = (i + 1) & mask;
+            }
+        }
+
+        /**
+         * Insert entry which is known to be absent. Entry must be counted in size already
+         * @return slot index or npos if table was rehashed during insertion
+         */
+        size_t insert_unique(value_type &&_val) {
+            typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type hand, tmp;
+            auto hand_ptr = reinterpret_cast<value_type *>(&hand);
+            auto tmp_ptr = reinterpret_cast<value_type *>(&tmp);
+            new(hand_ptr) value_type(std::move(_val));
+
+            size_t result = npos;
+            bool rehashed = false;
+            auto mask = capacity_ - 1;
+            auto i = slot_of(hand_ptr->first);
+            uint8_t d = 1;
+            while (true) {
+                if (dist_[i] == 0) {
+                    new(slots_ + i) value_type(std::move(*hand_ptr));
+                    hand_ptr->~value_type();
+                    dist_[i] = d;
+                    if (result == npos) result = i;
+                    break;
+                }
+                if (dist_[i] < d) {
+                    new(tmp_ptr) value_type(std::move(slots_[i]));
+                    slots_[i].~value_type();
+                    new(slots_ + i) value_type(std::move(*hand_ptr));
+                    hand_ptr->~value_type();
+                    new(hand_ptr) value_type(std::move(*tmp_ptr));
+                    tmp_ptr->~value_type();
+                    std::swap(d, dist_[i]);
+                    if (result == npos) result = i;
+                }
+                i = (i + 1) & mask;
+                if (++d == max_distance) {
+                    // pathological probe sequence, spread entries over a larger table
+                    rehashed = true;
+                    if (!rehash(capacity_ * 2)) {
+                        // no memory in node_pool::checked_scope: entry in hand is dropped, scope reports failure
+                        hand_ptr->~value_type();
+                        --size_;
+                        break;
+                    }
+                    mask = capacity_ - 1;
+                    i = slot_of(hand_ptr->first);
+                    d = 1;
+                }
+            }
+            return rehashed ? npos : result;
+        }
+
+        void erase_at(size_t _i) {
+            auto mask = capacity_ - 1;
+            slots_[_i].~value_type();
+            auto next = (_i + 1) & mask;
+            while (dist_[next] > 1) {
+                new(slots_ + _i) value_type(std::move(slots_[next]));
+                slots_[next].~value_type();
+                dist_[_i] = static_cast<uint8_t>(dist_[next] - 1);
+                _i = next;
+                next = (next + 1) & mask;
+            }
+            dist_[_i] = 0;
+            --size_;
+        }
+
+        /**
+         * Allocate empty slots. Table is left unchanged if allocation fails in node_pool::checked_scope
+         */
+        bool allocate(size_t _capacity) {
+            slot_allocator sa(alloc_);
+            byte_allocator ba(alloc_);
+            auto slots = slot_traits::allocate(sa, _capacity);
+            if (!slots) return false;
+            auto dist = byte_traits::allocate(ba, _capacity);
+            if (!dist) {
+                slot_traits::deallocate(sa, slots, _capacity);
+                return false;
+            }
+            slots_ = slots;
+            dist_ = dist;
+            std::memset(dist_, 0, _capacity);
+            capacity_ = _capacity;
+            shift_ = 64;
+            for (size_t c = _capacity; c > 1; c >>= 1) --shift_;
+            return true;
+        }
+
+        void deallocate() {
+            if (!capacity_) return;
+            slot_allocator sa(alloc_);
+            byte_allocator ba(alloc_);
+            slot_traits::deallocate(sa, slots_, capacity_);
+            byte_traits::deallocate(ba, dist_, capacity_);
+            slots_ = nullptr;
+            dist_ = nullptr;
+            capacity_ = 0;
+        }
+
+        /**
+         * Move entries into slot array of specified capacity
+         * @return false if allocation failed in node_pool::checked_scope, table is left unchanged then
+         */
+        bool rehash(size_t _capacity) {
+            auto old_slots = slots_;
+            auto old_dist = dist_;
+            auto old_capacity = capacity_;
+            if (!allocate(_capacity)) return false;
+            for (size_t i = 0; i < old_capacity; ++i) {
+                if (old_dist[i]) {
+                    insert_unique(std::move(old_slots[i]));
+                    old_slots[i].~value_type();
+                }
+            }
+            if (old_capacity) {
+                slot_allocator sa(alloc_);
+                byte_allocator ba(alloc_);
+                slot_traits::deallocate(sa, old_slots, old_capacity);
+                byte_traits::deallocate(ba, old_dist, old_capacity);
+            }
+            return true;
+        }
+
+        void destroy() {
+            clear();
+            deallocate();
+        }
+
+        void copy_from(const hash_table &_t) {
+            if (!_t.size_ || !allocate(_t.capacity_)) return;
+            for (size_t i = 0; i < capacity_; ++i) {
+                if (_t.dist_[i]) {
+                    new(slots_ + i) value_type(_t.slots_[i]);
+                    dist_[i] = _t.dist_[i];
+                }
+            }
+            size_ = _t.size_;
+        }
+
+        void steal(hash_table &_t) {
+            slots_ = _t.slots_;
+            dist_ = _t.dist_;
+            capacity_ = _t.capacity_;
+            size_ = _t.size_;
+            shift_ = _t.shift_;
+            _t.slots_ = nullptr;
+            _t.dist_ = nullptr;
+            _t.capacity_ = 0;
+            _t.size_ = 0;
+        }
+
+        Alloc alloc_;
+        value_type *slots_ = nullptr;
+        uint8_t *dist_ = nullptr;
+        size_t capacity_ = 0;
+        size_t size_ = 0;
+        unsigned shift_ = 64;
+    };
+
+    template<typename Key, typename T, typename Alloc>
+    constexpr size_t hash_table<Key, T, Alloc>::min_capacity;
+    template<typename Key, typename T, typename Alloc>
+    constexpr uint8_t hash_table<Key, T, Alloc>::max_distance;
+    template<typename Key, typename T, typename Alloc>
+    constexpr size_t hash_table<Key, T, Alloc>::npos;
+}
+
+#endif //BP_HASH_TABLE_HPP
@@ -0,0 +1,204 @@
+#ifndef BP_INTRUSIVE_PTR_HPP
+#define BP_INTRUSIVE_PTR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "arena.hpp"
+#include "node_pool.hpp"
+
+#ifndef BP_SINGLE_THREADED
+#include <atomic>
+#endif
+
+namespace bp {
+
+    /**
+     * Reference counter embedded into counted object. Counter is atomic for heap objects and plain
+     * for objects allocated in arena: arena documents are owned by single thread. Define
+     * BP_SINGLE_THREADED to make all counters plain
+     */
+    class ref_count {
+    public:
+        ref_count() noexcept : count_(0) {}
+
+        // copy of counted object starts unreferenced
+        ref_count(const ref_count &) noexcept : count_(0) {}
+
+        ref_count &operator=(const ref_count &) noexcept { return *this; }
+
+        /**
+         * Bind counter to allocation origin. Called once before first reference is taken
+         * @param _in_arena true if object memory belongs to arena
+         */
+        inline void init(bool _in_arena) const noexcept {
+            store(_in_arena ? arena_bit : 0);
+        }
+
+        /**
+         * Check whether object memory belongs to arena and must not be freed
+         */
+        inline bool in_arena() const noexcept { return (load() & arena_bit) != 0; }
+
+        inline void add_ref() const noexcept {
+#ifndef BP_SINGLE_THREADED
+            if (!in_arena()) {
+                count_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+#endif
+            store(load() + 1);
+        }
+
+        /**
+         * Drop reference
+         * @return true if last reference was dropped
+         */
+        inline bool release() const noexcept {
+#ifndef BP_SINGLE_THREADED
+            if (!in_arena()) {
+                return count_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+            }
+#endif
+            auto count = load() - 1;
+            store(count);
+            return (count & ~arena_bit) == 0;
+        }
+
+        inline uint32_t use_count() const noexcept { return load() & ~arena_bit; }
+
+    private:
+        static constexpr uint32_t arena_bit = 0x80000000u;
+
+#ifdef BP_SINGLE_THREADED
+        inline uint32_t load() const noexcept { return count_; }
+
+        inline void store(uint32_t _v) const noexcept { count_ = _v; }
+
+        mutable uint32_t count_;
+#else
+        inline uint32_t load() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+        inline void store(uint32_t _v) const noexcept { count_.store(_v, std::memory_order_relaxed); }
+
+        mutable std::atomic<uint32_t> count_;
+#endif
+    };
+
+    /**
+     * Single-pointer handle to object with embedded ref_count. Counted type provides
+     * `const ref_count &refs() const`. Objects are created with make_intrusive
+     * @tparam T counted type
+     */
+    template<typename T>
+    class intrusive_ptr {
+        template<typename U> friend class intrusive_ptr;
+    public:
+        using element_type = T;
+
+        intrusive_ptr() noexcept = default;
+
+        intrusive_ptr(std::nullptr_t) noexcept {}
+
+        explicit intrusive_ptr(T *_p) noexcept : p_(_p) {
+            if (p_) p_->refs().add_ref();
+        }
+
+        intrusive_ptr(const intrusive_ptr &_p) noexcept : intrusive_ptr(_p.p_) {}
+
+        intrusive_ptr(intrusive_ptr &&_p) noexcept : p_(_p.p_) { _p.p_ = nullptr; }
+
+        template<typename U, typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+        intrusive_ptr(const intrusive_ptr<U> &_p) noexcept : intrusive_ptr(_p.p_) {}
+
+        template<typename U, typename = typename std::enable_if<std::is_convertible<U *, T *>::value>::type>
+        intrusive_ptr(intrusive_ptr<U> &&_p) noexcept : p_(_p.p_) { _p.p_ = nullptr; }
+
+        ~intrusive_ptr() { release(); }
+
+        intrusive_ptr &operator=(const intrusive_ptr &_p) noexcept {
+            intrusive_ptr(_p).swap(*this);
+            return *this;
+        }
+
+        intrusive_ptr &operator=(intrusive_ptr &&_p) noexcept {
+            intrusive_ptr(std::move(_p)).swap(*this);
+            return *this;
+        }
+
+        intrusive_ptr &operator=(std::nullptr_t) noexcept {
+            reset();
+            return *this;
+        }
+
+        inline void reset() noexcept { intrusive_ptr().swap(*this); }
+
+        inline void swap(intrusive_ptr &_p) noexcept { std::swap(p_, _p.p_); }
+
+        inline T *get() const noexcept { return p_; }
+
+        inline T &operator*() const noexcept { return *p_; }
+
+        inline T *operator->() const noexcept { return p_; }
+
+        inline explicit operator bool() const noexcept { return p_ != nullptr; }
+
+        inline uint32_t use_count() const noexcept { return p_ ? p_->refs().use_count() : 0; }
+
+        template<typename U>
+        inline bool operator==(const intrusive_ptr<U> &_p) const noexcept { return p_ == _p.p_; }
+
+        template<typename U>
+        inline bool operator!=(const intrusive_ptr<U> &_p) const noexcept { return p_ != _p.p_; }
+
+        inline bool operator==(std::nullptr_t) const noexcept { return p_ == nullptr; }
+
+        inline bool operator!=(std::nullptr_t) const noexcept { return p_ != nullptr; }
+
+    private:
+        inline void release() noexcept {
+            if (p_ && p_->refs().release()) {
+                using object_type = typename std::remove_const<T>::type;
+                auto p = const_cast<object_type *>(p_);
+                bool in_arena = p->refs().in_arena();
+                p->~object_type();
+                if (!in_arena) {
+                    bp::node_deallocate(p);
+                }
+            }
+        }
+
+        T *p_ = nullptr;
+    };
+
+    /**
+     * Allocate counted object in arena or on heap (node pool in pool builds)
+     * @param _arena arena to allocate object from or nullptr for heap
+     * @param _args object constructor arguments
+     * @return object handle, empty if allocation failed in node_pool::checked_scope
+     */
+    template<typename T, typename ...Args>
+    inline intrusive_ptr<T> make_intrusive(bp::arena *_arena, Args &&..._args) {
+        void *mem = _arena ? _arena->allocate(sizeof(T), alignof(T)) : bp::node_allocate(sizeof(T));
+        if (!mem) {
+            return intrusive_ptr<T>();
+        }
+#if defined(__EXCEPTIONS) || defined(_MSC_VER)
+        T *p;
+        try {
+            p = new(mem) T(std::forward<Args>(_args)...);
+        } catch (...) {
+            if (!_arena) bp::node_deallocate(mem);
+            throw;
+        }
+#else
+        T *p = new(mem) T(std::forward<Args>(_args)...);
+#endif
+        p->refs().init(_arena != nullptr);
+        return intrusive_ptr<T>(p);
+    }
+}
+
+#endif //BP_INTRUSIVE_PTR_HPP
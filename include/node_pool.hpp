@@ -0,0 +1,215 @@
+#ifndef BP_NODE_POOL_HPP
+#define BP_NODE_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#if defined(ARDUINO) && !defined(BP_SINGLE_THREADED)
+#define BP_SINGLE_THREADED
+#endif
+
+#ifndef BP_SINGLE_THREADED
+#include <mutex>
+#endif
+
+namespace bp {
+
+    /**
+     * Fixed-capacity allocator for tree nodes, container storage and strings. Memory is split into pages,
+     * every page serves blocks of one size class, larger requests take runs of adjacent pages. Blocks
+     * carry no header, page returns to the pool once its last block is freed and may then serve any class
+     * or run. Pages still holding live blocks stay with their class, so pool fragments when long-lived
+     * blocks are scattered over many pages.
+     *
+     * Define BP_NODE_POOL_SIZE to route all node memory that is not taken from arena into static pool of that
+     * size instead of heap. Exhausted pool throws std::bad_alloc, exceptionless builds call exhausted handler
+     * unless allocation is made in checked_scope
+     */
+    class node_pool {
+    public:
+        static constexpr size_t page_size = 256;
+
+        /**
+         * Create pool managing memory. Page table is placed at the beginning of memory
+         * @param _memory memory to manage, aligned to max_align_t
+         * @param _size memory size
+         */
+        node_pool(void *_memory, size_t _size) noexcept;
+
+        node_pool(const node_pool &) = delete;
+
+        node_pool &operator=(const node_pool &) = delete;
+
+        /**
+         * Allocate block
+         * @param _size block size
+         * @return pointer aligned to max_align_t or nullptr if pool is exhausted
+         */
+        void *allocate(size_t _size) noexcept;
+
+        /**
+         * Return block to pool
+         * @param _p block allocated from this pool or nullptr
+         */
+        void deallocate(void *_p) noexcept;
+
+        /**
+         * Check whether block belongs to pool
+         */
+        inline bool owns(const void *_p) const noexcept {
+            return _p >= static_cast<const void *>(pages_) && _p < static_cast<const void *>(pages_ + page_count_ * page_size);
+        }
+
+        /**
+         * Get memory available for blocks
+         * @return pool size without page table
+         */
+        inline size_t capacity() const noexcept { return page_count_ * page_size; }
+
+        /**
+         * Get size of blocks currently allocated, rounded up to their size classes
+         */
+        inline size_t used() const noexcept { return used_; }
+
+        /**
+         * Get max of used() since creation
+         */
+        inline size_t high_water() const noexcept { return high_water_; }
+
+        /**
+         * Get number of allocations failed because pool was exhausted
+         */
+        inline size_t failures() const noexcept { return failures_; }
+
+#ifdef BP_NODE_POOL_SIZE
+        using exhausted_handler = void (*)(size_t _size);
+
+        /**
+         * Get pool serving node memory
+         */
+        static node_pool &instance() noexcept;
+
+        /**
+         * Set function called in exceptionless builds when node can not be allocated. Handler must not return,
+         * e.g. it resets device after saving status. Default handler aborts
+         * @param _handler function receiving size of failed request
+         */
+        static void set_exhausted_handler(exhausted_handler _handler) noexcept;
+
+        /**
+         * Report failed node allocation: throw std::bad_alloc or call exhausted handler.
+         * Returns in checked_scope of exceptionless builds, so that allocation yields nullptr
+         */
+        static void exhausted(size_t _size);
+#endif
+
+        /**
+         * Scope of current thread in which exceptionless builds get nullptr from failed node allocations instead
+         * of calling exhausted handler. Code opening the scope checks whether allocations failed and reports
+         * failure by itself, e.g. parsers return false. Containers are left unchanged by failed reserve,
+         * failed emplace returns end() and false
+         */
+        class checked_scope {
+        public:
+#ifdef BP_NODE_POOL_SIZE
+            checked_scope() noexcept;
+
+            ~checked_scope();
+
+            /**
+             * Check whether node allocation failed since scope was opened
+             */
+            bool failed() const noexcept;
+#else
+            checked_scope() noexcept = default;
+
+            inline bool failed() const noexcept { return false; }
+#endif
+
+            checked_scope(const checked_scope &) = delete;
+
+            checked_scope &operator=(const checked_scope &) = delete;
+
+#ifdef BP_NODE_POOL_SIZE
+        private:
+            size_t failures_;
+#endif
+        };
+
+    private:
+        static constexpr size_t class_count = 8;
+        static constexpr uint8_t free_page = 0;
+        static constexpr uint8_t run_head = 0xFE;
+        static constexpr uint8_t run_tail = 0xFF;
+
+        struct page_info {
+            // run length at run head, next page with free blocks of the same class + 1 at class page
+            uint32_t next;
+            // previous page with free blocks of the same class + 1
+            uint32_t prev;
+            // size class index + 1, free_page, run_head or run_tail
+            uint8_t kind;
+            // allocated blocks of class page
+            uint8_t live;
+            // first free block of class page + 1 or 0 if page is full. Free block keeps next one in first byte
+            uint8_t free;
+        };
+
+        void *allocate_run(size_t _pages) noexcept;
+
+        void add_used(size_t _size) noexcept;
+
+        /**
+         * Put class page to the list of pages with free blocks
+         */
+        void link(size_t _cls, size_t _page) noexcept;
+
+        /**
+         * Take class page off the list of pages with free blocks
+         */
+        void unlink(size_t _cls, size_t _page) noexcept;
+
+        page_info *info_;
+        char *pages_;
+        size_t page_count_;
+        // first page with free blocks + 1 per size class
+        uint32_t partial_[class_count] = {};
+        size_t used_ = 0;
+        size_t high_water_ = 0;
+        size_t failures_ = 0;
+#ifndef BP_SINGLE_THREADED
+        std::mutex mutex_;
+#endif
+    };
+
+    /**
+     * Allocate memory for tree node, container storage or string
+     * @param _size block size
+     * @return block from node pool in pool builds, from heap otherwise. Can be nullptr only in checked_scope
+     */
+    inline void *node_allocate(size_t _size) {
+#ifdef BP_NODE_POOL_SIZE
+        auto p = node_pool::instance().allocate(_size);
+        if (!p) {
+            node_pool::exhausted(_size);
+        }
+        return p;
+#else
+        return ::operator new(_size);
+#endif
+    }
+
+    /**
+     * Free memory taken by node_allocate
+     */
+    inline void node_deallocate(void *_p) noexcept {
+#ifdef BP_NODE_POOL_SIZE
+        node_pool::instance().deallocate(_p);
+#else
+        ::operator delete(_p);
+#endif
+    }
+}
+
+#endif //BP_NODE_POOL_HPP
@@ -0,0 +1,125 @@
+#ifndef BP_NUMBERS_HPP
+#define BP_NUMBERS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bp {
+
+    /**
+     * Buffer size enough for any number written by format functions
+     */
+    constexpr size_t max_number_chars = 32;
+
+    /**
+     * Number text split into decimal significand and exponent
+     */
+    struct decimal_number {
+        /**
+         * First 19 significant digits
+         */
+        uint64_t mantissa = 0;
+        /**
+         * Power of ten mantissa is scaled by
+         */
+        int32_t exponent = 0;
+        bool negative = false;
+        /**
+         * Number has fraction or exponent part
+         */
+        bool fractional = false;
+        /**
+         * Number has more significant digits than mantissa holds
+         */
+        bool truncated = false;
+    };
+
+    /**
+     * Write unsigned integer
+     * @param _out buffer of at least max_number_chars bytes
+     * @param _val value
+     * @return end of written text
+     */
+    char *format_uint(char *_out, uint64_t _val);
+
+    /**
+     * Write signed integer
+     * @param _out buffer of at least max_number_chars bytes
+     * @param _val value
+     * @return end of written text
+     */
+    char *format_int(char *_out, int64_t _val);
+
+    /**
+     * Write shortest decimal reading back as the same double. Fixed notation is used for moderate
+     * exponents, scientific otherwise. Integral values have no fraction part, NaN and infinity are written
+     * as "nan", "inf" and "-inf"
+     * @param _out buffer of at least max_number_chars bytes
+     * @param _val value
+     * @return end of written text
+     */
+    char *format_double(char *_out, double _val);
+
+    /**
+     * Write shortest decimal reading back as the same float
+     * @param _out buffer of at least max_number_chars bytes
+     * @param _val value
+     * @return end of written text
+     */
+    char *format_float(char *_out, float _val);
+
+    /**
+     * Scan number in JSON grammar: optional minus, integer part without leading zeros, optional fraction
+     * and exponent
+     * @param _begin start of text
+     * @param _end end of text
+     * @param _out scanned number
+     * @return end of number or nullptr if text does not start with valid number
+     */
+    const char *scan_number(const char *_begin, const char *_end, decimal_number &_out);
+
+    /**
+     * Convert scanned number to nearest double. Exactly representable numbers are converted with
+     * single multiplication, others fall back to strtod
+     * @param _num scanned number
+     * @param _begin start of number text
+     * @param _end end of number text
+     * @return nearest double
+     */
+    double to_double(const decimal_number &_num, const char *_begin, const char *_end);
+
+    /**
+     * Convert number to string with format_* functions
+     * @param _val value
+     * @return number text
+     */
+    template<typename T>
+    std::string number_to_string(T _val);
+
+    template<>
+    inline std::string number_to_string(uint64_t _val) {
+        char buf[max_number_chars];
+        return std::string(buf, format_uint(buf, _val));
+    }
+
+    template<>
+    inline std::string number_to_string(int64_t _val) {
+        char buf[max_number_chars];
+        return std::string(buf, format_int(buf, _val));
+    }
+
+    template<>
+    inline std::string number_to_string(double _val) {
+        char buf[max_number_chars];
+        return std::string(buf, format_double(buf, _val));
+    }
+
+    template<>
+    inline std::string number_to_string(float _val) {
+        char buf[max_number_chars];
+        return std::string(buf, format_float(buf, _val));
+    }
+}
+
+#endif //BP_NUMBERS_HPP
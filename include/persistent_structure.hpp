@@ -0,0 +1,295 @@
+#ifndef BP_PERSISTENT_STRUCTURE_HPP
+#define BP_PERSISTENT_STRUCTURE_HPP
+
+#include <functional>
+#include <initializer_list>
+#include <vector>
+#include "structure.hpp"
+
+namespace bp {
+
+    namespace persistent {
+        struct node;
+        using node_ptr = std::shared_ptr<const node>;
+
+        /**
+         * Bits of key or index consumed by each trie level
+         */
+        constexpr unsigned level_bits = 5;
+        constexpr unsigned level_width = 1u << level_bits;
+        constexpr unsigned level_mask = level_width - 1;
+
+        /**
+         * Hash array mapped trie node. Keys are dispatched by 5-bit chunks of hash,
+         * entries kept in this node are marked in datamap, subtries in nodemap
+         */
+        struct map_node {
+            uint32_t datamap = 0;
+            uint32_t nodemap = 0;
+            std::vector<std::pair<bp::hash_type, node_ptr>> entries;
+            std::vector<std::shared_ptr<const map_node>> children;
+        };
+        using map_ptr = std::shared_ptr<const map_node>;
+
+        /**
+         * Vector trie node. Leaves hold up to 32 items, inner nodes up to 32 subtries
+         */
+        struct vector_node {
+            std::vector<node_ptr> items;
+            std::vector<std::shared_ptr<const vector_node>> children;
+        };
+        using vector_ptr = std::shared_ptr<const vector_node>;
+
+        /**
+         * Immutable value. Scalars are kept in tree node, containers in tries
+         */
+        struct node {
+            structure::value_type type = structure::value_type::Null;
+            serializable::tree scalar;
+            map_ptr map;
+            vector_ptr vector;
+            size_t size = 0;
+            unsigned shift = 0;
+        };
+    }
+
+    /**
+     * Immutable structure. Every update returns new version sharing all untouched paths
+     * with the previous one: objects are hash array mapped tries keyed by bp::hash_type,
+     * arrays are tries of 32-item chunks. Versions never change after creation, so they
+     * may be passed to and read from other threads without locking
+     */
+    class persistent_structure {
+    public:
+        using value_type = structure::value_type;
+
+        /**
+         * Diff path element: object key or array index
+         */
+        struct path_item {
+            bool is_index;
+            bp::hash_type key;
+            size_t index;
+        };
+        using path = std::vector<path_item>;
+
+        /**
+         * Diff callback. Called with path of changed value, old and new values. Added and removed
+         * values are reported with null counterpart
+         */
+        using diff_callback = std::function<void(const path &, const persistent_structure &,
+                                                 const persistent_structure &)>;
+
+        /**
+         * Create null structure
+         */
+        persistent_structure();
+
+        /**
+         * Create structure with primitive value
+         * @tparam T serializable type
+         * @param _val primitive value
+         */
+        template<typename T, typename = serializable::enable_if_serializable_t<T>>
+        persistent_structure(T &&_val) : node_(make_scalar(serializable::tree(std::forward<T>(_val)))) {}
+
+        /**
+         * Snapshot mutable structure
+         * @param _s structure to copy
+         */
+        explicit persistent_structure(const structure &_s);
+
+        static persistent_structure create_object();
+
+        static persistent_structure create_array();
+
+        /**
+         * Convert to mutable structure
+         * @return structure copy
+         */
+        structure to_structure() const;
+
+        /**
+         * Convert to mutable structure allocated in arena
+         * @param _arena arena to allocate structure from
+         * @return structure copy
+         */
+        structure to_structure(bp::arena &_arena) const;
+
+        inline value_type type() const { return node_->type; }
+
+        inline bool is_null() const { return node_->type == value_type::Null; }
+
+        inline bool is_int() const { return node_->type == value_type::Int; }
+
+        inline bool is_float() const { return node_->type == value_type::Float; }
+
+        inline bool is_bool() const { return node_->type == value_type::Bool; }
+
+        inline bool is_string() const { return node_->type == value_type::String; }
+
+        inline bool is_object() const { return node_->type == value_type::Object; }
+
+        inline bool is_array() const { return node_->type == value_type::Array; }
+
+        /**
+         * Get number of items in object or array
+         * @return item count or 0 for primitive values
+         */
+        inline size_t size() const { return node_->size; }
+
+        inline bool empty() const { return node_->size == 0; }
+
+        /**
+         * Get primitive value
+         * @tparam ValueType serializable primitive value
+         * @return value or default-constructed value in case of type mismatch
+         */
+        template<typename ValueType,
+                typename = typename std::enable_if<serializable::is_serializable<ValueType>::value>::type>
+        inline ValueType as() const {
+            return node_->scalar.as<ValueType>();
+        }
+
+        bool has_key(const bp::hash_type &_key) const;
+
+        /**
+         * Access object item. Throws type_error for types other than object and std::out_of_range
+         * if key not found
+         * @param _key object key
+         * @return object item or null structure in exceptionless mode
+         */
+        persistent_structure at(const bp::hash_type &_key) const
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error, std::out_of_range));
+
+        /**
+         * Access array item. Throws type_error for types other than array and std::out_of_range
+         * if index is out of bounds
+         * @param _index array index
+         * @return array item or null structure in exceptionless mode
+         */
+        persistent_structure at(int _index) const
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error, std::out_of_range));
+
+        /**
+         * Create version with object item set. Null structure is turned into object.
+         * Throws type_error for other types
+         * @param _key object key
+         * @param _val value to set
+         * @return new version
+         */
+        persistent_structure set(const bp::hash_type &_key, const persistent_structure &_val) const
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error));
+
+        /**
+         * Create version with array item replaced. Throws type_error for types other than array and
+         * std::out_of_range if index is out of bounds
+         * @param _index array index
+         * @param _val value to set
+         * @return new version
+         */
+        persistent_structure set(int _index, const persistent_structure &_val) const
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error, std::out_of_range));
+
+        /**
+         * Create version with nested object item set. Missing and null intermediate items are
+         * created as objects
+         * @param _path keys of nested item
+         * @param _val value to set
+         * @return new version
+         */
+        persistent_structure set_in(std::initializer_list<bp::hash_type> _path, const persistent_structure &_val) const
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error));
+
+        /**
+         * Create version without object item
+         * @param _key object key
+         * @return new version or this version if key not found
+         */
+        persistent_structure erase(const bp::hash_type &_key) const
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error));
+
+        /**
+         * Create version with value appended to array. Null structure is turned into array.
+         * Throws type_error for other types
+         * @param _val value to append
+         * @return new version
+         */
+        persistent_structure append(const persistent_structure &_val) const
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error));
+
+        /**
+         * Iterate object items in unspecified order
+         * @param _f callable accepting key and value
+         */
+        template<typename F>
+        void for_each_item(F &&_f) const {
+            if (node_->map) for_each_item(*node_->map, _f);
+        }
+
+        /**
+         * Iterate array items in order
+         * @param _f callable accepting value
+         */
+        template<typename F>
+        void for_each_element(F &&_f) const {
+            if (node_->vector) for_each_element(*node_->vector, _f);
+        }
+
+        /**
+         * Check whether both structures are the same version. Constant time
+         * @return true if versions are identical
+         */
+        inline bool same(const persistent_structure &_s) const { return node_ == _s.node_; }
+
+        bool operator==(const persistent_structure &_s) const;
+
+        inline bool operator!=(const persistent_structure &_s) const { return !operator==(_s); }
+
+        /**
+         * Report differences between versions. Paths shared by both versions are skipped without traversal
+         * @param _from old version
+         * @param _to new version
+         * @param _cb callback to report changes to
+         */
+        static void diff(const persistent_structure &_from, const persistent_structure &_to, const diff_callback &_cb);
+
+    private:
+        explicit persistent_structure(persistent::node_ptr _node) : node_(std::move(_node)) {}
+
+        static persistent::node_ptr make_scalar(serializable::tree &&_val);
+
+        static void diff_nodes(path &_path, const persistent::node_ptr &_from, const persistent::node_ptr &_to,
+                               const diff_callback &_cb);
+
+        static void diff_maps(path &_path, const persistent::map_node *_from, const persistent::map_node *_to,
+                              const diff_callback &_cb);
+
+        static void diff_vectors(path &_path, const persistent::vector_node *_from, const persistent::vector_node *_to,
+                                 unsigned _shift, size_t _base, size_t _limit, const diff_callback &_cb);
+
+        template<typename F>
+        static void for_each_item(const persistent::map_node &_node, F &_f) {
+            for (const auto &entry: _node.entries) {
+                _f(entry.first, persistent_structure(entry.second));
+            }
+            for (const auto &child: _node.children) {
+                for_each_item(*child, _f);
+            }
+        }
+
+        template<typename F>
+        static void for_each_element(const persistent::vector_node &_node, F &_f) {
+            for (const auto &item: _node.items) {
+                _f(persistent_structure(item));
+            }
+            for (const auto &child: _node.children) {
+                for_each_element(*child, _f);
+            }
+        }
+
+        persistent::node_ptr node_;
+    };
+}
+
+#endif //BP_PERSISTENT_STRUCTURE_HPP
@@ -2,17 +2,214 @@
 #define SERIALIZERS_DCM_BUF_HPP
 
 #include <binelpro/symbol.hpp>
+#include <string>
+#include <vector>
 #include "../structure.hpp"
+#include "../structure_view.hpp"
+#include "push_status.hpp"
 
 namespace bp {
     namespace serializers {
         using namespace bp::literals;
         constexpr symbol::hash_type Dcm = "dcm"_hash;
+
+        /**
+         * Receiver of Dcm message produced by writer, e.g. socket or UART
+         */
+        class dcm_sink {
+        public:
+            virtual ~dcm_sink() = default;
+
+            /**
+             * Take next piece of message
+             * @param _data message bytes
+             * @param _size number of bytes
+             * @return false to stop writing
+             */
+            virtual bool write(const char *_data, size_t _size) = 0;
+        };
+
+        /**
+         * Dcm encoder writing whole message into single buffer. Size of message is computed by measure() in one
+         * pass over tree, then entries are written in place without temporary strings
+         */
+        class dcm_writer {
+        public:
+            /**
+             * Create writer filling buffer
+             * @param _buf buffer of at least measure() bytes
+             */
+            explicit dcm_writer(char *_buf);
+
+            /**
+             * Create writer passing message to sink. Entries are collected in small buffer which is handed to sink
+             * when it grows over flush size, long strings are passed to sink directly
+             * @param _sink message receiver, must outlive writer
+             * @param _flush_size buffered bytes to pass to sink at
+             */
+            explicit dcm_writer(dcm_sink &_sink, size_t _flush_size = 256);
+
+            dcm_writer(const dcm_writer &) = delete;
+
+            dcm_writer &operator=(const dcm_writer &) = delete;
+
+            /**
+             * Write value as Dcm message. Sink receives all buffered bytes before return
+             * @param _v value to write
+             * @return false if sink refused message
+             */
+            bool write(const structure_view &_v);
+
+            /**
+             * Compute exact size of Dcm message of value
+             * @param _v value to measure
+             * @return size in bytes
+             */
+            static size_t measure(const structure_view &_v);
+
+        private:
+            void write_value(const structure_view &_v);
+
+            template<typename T>
+            inline void put_num(T _val) {
+                put(reinterpret_cast<const char *>(&_val), sizeof(T));
+            }
+
+            void put(const char *_data, size_t _size);
+
+            /**
+             * Pass buffered bytes to sink
+             */
+            void flush();
+
+            char *out_ = nullptr;
+            // bytes waiting for sink
+            std::string buffer_;
+            dcm_sink *sink_ = nullptr;
+            size_t flush_size_ = 0;
+            bool failed_ = false;
+        };
+
+        /**
+         * Serialize value to Dcm message in caller's buffer
+         * @param _v value to serialize
+         * @param _buf output buffer
+         * @param _size buffer size
+         * @return message size. Nothing is written if it exceeds buffer size
+         */
+        size_t to_dcm(const structure_view &_v, char *_buf, size_t _size);
+
+        /**
+         * Resumable Dcm parser fed with chunks of input as they arrive, e.g. from socket. Tree is built entry
+         * by entry, so only unfinished field is buffered instead of whole message. Chunk boundary may fall
+         * anywhere, including inside size field or numeric value
+         */
+        class dcm_push_parser {
+        public:
+            /**
+             * Create parser
+             * @param _arena arena to allocate nodes from or nullptr for heap
+             * @param _pool pool to intern string values in or nullptr
+             */
+            explicit dcm_push_parser(bp::arena *_arena = nullptr, bp::string_pool *_pool = nullptr);
+
+            dcm_push_parser(const dcm_push_parser &) = delete;
+
+            dcm_push_parser &operator=(const dcm_push_parser &) = delete;
+
+            /**
+             * Parse next chunk of message. Parsing stops at the end of message, rest of chunk is left for
+             * the next one (see consumed()). Throws structure::parse_error on unknown entry type
+             * @param _chunk bytes of input, not referenced after call
+             * @return NeedMore if message continues in next chunk, Complete if it is finished
+             * or Error on failure in exceptionless mode
+             */
+            push_status feed(const bp::string_view &_chunk) ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error));
+
+            /**
+             * Move completed message into structure and start next one. Nodes are allocated from parser's arena
+             * @param _out structure to put message into
+             * @return false if message is not complete
+             */
+            bool take(structure &_out);
+
+            /**
+             * Drop partially parsed message and error
+             */
+            void reset();
+
+            /**
+             * Get number of bytes of last chunk consumed by parser
+             * @return chunk size unless message is complete or failed in the middle of chunk
+             */
+            inline size_t consumed() const { return consumed_; }
+
+            /**
+             * Get description of failure
+             * @return error message or empty string
+             */
+            inline const std::string &error() const { return error_; }
+
+        private:
+            enum class state : uint8_t {
+                Tag,
+                Scalar,
+                Size,
+                String,
+                KeySize,
+                Key,
+                Done,
+                Failed
+            };
+
+            struct frame {
+                serializable::object_ptr object;
+                serializable::array_ptr array;
+                uint32_t remaining;
+                bp::hash_type key;
+            };
+
+            /**
+             * Handle complete field of current state
+             * @param _field field bytes
+             * @param _at position of field end in chunk
+             * @return false on malformed entry
+             */
+            bool step(const char *_field, const char *_at);
+
+            /**
+             * Attach finished value to innermost container, closing containers it completes
+             */
+            void put(serializable::tree_ptr _val);
+
+            /**
+             * Expect next entry of innermost container
+             */
+            void next();
+
+            bool fail(const char *_msg, const char *_at);
+
+            bp::arena *arena_;
+            bp::string_pool *pool_;
+            state state_ = state::Tag;
+            // bytes of field read by current state and entry tag
+            size_t need_ = 1;
+            char tag_ = 0;
+            std::vector<frame> frames_;
+            serializable::tree_ptr root_;
+            // field started in previous chunk
+            std::string pending_;
+            const char *chunk_ = nullptr;
+            // bytes of message consumed before current chunk
+            size_t offset_ = 0;
+            size_t consumed_ = 0;
+            std::string error_;
+        };
     }
     template<>
-    std::string structure::stringify<serializers::Dcm>() const;
+    std::string structure::serialize<serializers::Dcm>() const;
     template<>
-    void structure::parse<serializers::Dcm>(const std::string &_str);
+    bool structure::parse<serializers::Dcm>(const bp::string_view &_str);
 }
 
 #endif //SERIALIZERS_DCM_BUF_HPP
@@ -8,10 +8,35 @@ namespace bp {
     namespace serializers {
         using namespace bp::literals;
         constexpr bp::hash_type Json = "json"_h;
+        /**
+         * JSON serializer producing indented output. Parses as Json
+         */
+        constexpr bp::hash_type JsonPretty = "json_pretty"_h;
+        /**
+         * JSON serializer parsing through jsoncpp DOM
+         */
+        constexpr bp::hash_type JsonCpp = "jsoncpp"_h;
+        /**
+         * JSON serializer parsing lazily: document is validated and indexed, containers are materialized
+         * on first access. Untouched containers are serialized by copying their source text. Serializes as Json
+         */
+        constexpr bp::hash_type JsonLazy = "json_lazy"_h;
     }
     template<>
     std::string structure::serialize<serializers::Json>() const;
     template<>
-    bool structure::parse<serializers::Json>(const std::string &_str);
+    bool structure::parse<serializers::Json>(const bp::string_view &_str);
+    template<>
+    std::string structure::serialize<serializers::JsonPretty>() const;
+    template<>
+    bool structure::parse<serializers::JsonPretty>(const bp::string_view &_str);
+    template<>
+    std::string structure::serialize<serializers::JsonLazy>() const;
+    template<>
+    bool structure::parse<serializers::JsonLazy>(const bp::string_view &_str);
+    template<>
+    std::string structure::serialize<serializers::JsonCpp>() const;
+    template<>
+    bool structure::parse<serializers::JsonCpp>(const bp::string_view &_str);
 }
 #endif //SERIALIZERS_JSON_HPP
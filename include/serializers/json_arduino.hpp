@@ -2,6 +2,7 @@
 #define FARMBRAIN_SERIALIZERS_JSON_HPP
 
 #include "../structure.hpp"
+#include "json_in_situ.hpp"
 
 namespace bp {
     namespace serializers {
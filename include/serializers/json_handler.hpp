@@ -0,0 +1,66 @@
+#ifndef SERIALIZERS_JSON_HANDLER_HPP
+#define SERIALIZERS_JSON_HANDLER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "symbol.hpp"
+#include "util.hpp"
+
+namespace bp {
+    namespace serializers {
+
+        /**
+         * Receiver of JSON parse events. Default implementation ignores every event, so handler overrides only
+         * events it is interested in. String views passed to handler are valid only during the call
+         */
+        class json_handler {
+        public:
+            virtual ~json_handler() = default;
+
+            /**
+             * Object is opened
+             * @return false to skip whole object. Neither its contents nor end_object are reported then
+             */
+            virtual bool start_object() { return true; }
+
+            virtual void end_object() {}
+
+            /**
+             * Array is opened
+             * @return false to skip whole array. Neither its contents nor end_array are reported then
+             */
+            virtual bool start_array() { return true; }
+
+            virtual void end_array() {}
+
+            /**
+             * Object key is read
+             * @param _hash key hash
+             * @param _name key as written in document after unescaping
+             * @return false to skip value of this key
+             */
+            virtual bool key(bp::hash_type _hash, const bp::string_view &_name) {
+                (void) _hash;
+                (void) _name;
+                return true;
+            }
+
+            virtual void null_value() {}
+
+            virtual void bool_value(bool _val) { (void) _val; }
+
+            /**
+             * Integer value. Non-negative integers above INT64_MAX are reported by uint_value
+             */
+            virtual void int_value(int64_t _val) { (void) _val; }
+
+            virtual void uint_value(uint64_t _val) { (void) _val; }
+
+            virtual void double_value(double _val) { (void) _val; }
+
+            virtual void string_value(const bp::string_view &_val) { (void) _val; }
+        };
+    }
+}
+
+#endif //SERIALIZERS_JSON_HANDLER_HPP
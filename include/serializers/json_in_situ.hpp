@@ -0,0 +1,158 @@
+#ifndef SERIALIZERS_JSON_IN_SITU_HPP
+#define SERIALIZERS_JSON_IN_SITU_HPP
+
+#include <string>
+#include <vector>
+#include "../structure.hpp"
+#include "key_cache.hpp"
+
+namespace bp {
+    namespace serializers {
+
+        /**
+         * Memory taken by parse of one document
+         */
+        struct json_parse_stats {
+            /**
+             * Number of tree nodes built
+             */
+            size_t nodes = 0;
+            /**
+             * Deepest nesting of containers
+             */
+            size_t depth = 0;
+            /**
+             * Size of parser stack of unfinished containers. Stack keeps its capacity between documents
+             */
+            size_t stack_bytes = 0;
+            /**
+             * Memory taken by tree from arena or node pool. Not tracked for nodes allocated on plain heap
+             */
+            size_t tree_bytes = 0;
+
+            /**
+             * Get memory high-water mark of parse
+             */
+            inline size_t high_water() const { return stack_bytes + tree_bytes; }
+        };
+
+        /**
+         * JSON parser for memory-constrained devices. Document is parsed in caller's mutable buffer: strings are
+         * decoded in place, so input is not copied and nothing but resulting tree is built. Nesting is tracked
+         * on heap stack reserved from input length instead of call stack, any value is accepted as root
+         */
+        class json_in_situ_parser {
+        public:
+            /**
+             * Max nesting level of arrays and objects
+             */
+            static constexpr size_t max_depth = 512;
+
+            /**
+             * Create parser
+             * @param _arena arena to allocate nodes from or nullptr for heap
+             * @param _pool pool to intern string values in or nullptr
+             */
+            explicit json_in_situ_parser(bp::arena *_arena = nullptr, bp::string_pool *_pool = nullptr);
+
+            /**
+             * Parse JSON document into tree. Buffer contents are undefined after parse.
+             * Throws structure::parse_error on malformed input. Exhausted node pool fails parse
+             * with "out of memory" error in exceptionless builds
+             * @param _buf JSON text, modified by parser
+             * @param _size text size
+             * @return root node or nullptr on failure in exceptionless mode
+             */
+            serializable::tree_ptr parse(char *_buf, size_t _size)
+                    ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error));
+
+            /**
+             * Parse JSON document into structure. Throws structure::parse_error on malformed input
+             * @param _buf JSON text, modified by parser
+             * @param _size text size
+             * @param _out structure to put document into, left untouched on failure
+             * @return false on failure in exceptionless mode
+             */
+            bool parse(char *_buf, size_t _size, structure &_out)
+                    ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error));
+
+            /**
+             * Get memory statistics of last parsed document
+             */
+            inline const json_parse_stats &stats() const { return stats_; }
+
+            /**
+             * Get description of last parse error
+             * @return error message or empty string
+             */
+            inline const std::string &error() const { return error_; }
+
+            /**
+             * Make parsed trees refer to string values in buffer instead of copying them. Escaped strings are
+             * decoded in place and referenced as well. Buffer must outlive parsed tree
+             * @param _enable true to enable zero-copy strings
+             */
+            inline void set_zero_copy(bool _enable) { zero_copy_ = _enable; }
+
+        private:
+            struct frame {
+                bool object;
+                // sizes of items_ and names_ when container started
+                size_t items;
+                size_t names;
+            };
+
+            bool run();
+
+            bool parse_scalar();
+
+            bool parse_key();
+
+            /**
+             * Decode string at current position in place
+             * @param _out decoded contents, pointing into buffer
+             * @return false on malformed string
+             */
+            bool parse_string(bp::string_view &_out);
+
+            bool parse_literal(const char *_literal, size_t _size);
+
+            /**
+             * Replace items of innermost container with container node
+             * @return false if node memory is exhausted
+             */
+            bool close();
+
+            inline void skip_ws() {
+                while (cur_ != end_ && (*cur_ == ' ' || *cur_ == '\t' || *cur_ == '\n' || *cur_ == '\r')) ++cur_;
+            }
+
+            /**
+             * Put finished value onto stack
+             * @return false if node memory is exhausted
+             */
+            bool push(serializable::tree_ptr &&_node);
+
+            bool fail(const char *_msg);
+
+            bp::arena *arena_;
+            bp::string_pool *pool_;
+            char *begin_ = nullptr;
+            char *cur_ = nullptr;
+            char *end_ = nullptr;
+            // finished values and keys of open containers
+            std::vector<serializable::tree_ptr> items_;
+            std::vector<bp::hash_type> names_;
+            std::vector<frame> frames_;
+            key_cache keys_;
+            json_parse_stats stats_;
+            // allocation scope of running parse
+            const bp::node_pool::checked_scope *alloc_ = nullptr;
+            bool zero_copy_ = false;
+            bool failed_ = false;
+            std::string error_;
+        };
+    }
+}
+
+#endif //SERIALIZERS_JSON_IN_SITU_HPP
@@ -0,0 +1,110 @@
+#ifndef SERIALIZERS_JSON_INDEX_HPP
+#define SERIALIZERS_JSON_INDEX_HPP
+
+#include <cstdint>
+#include <vector>
+#include "util.hpp"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BP_JSON_SIMD_X86
+#endif
+
+namespace bp {
+    namespace serializers {
+
+        /**
+         * Structural index of JSON document. Input is classified in 64-byte blocks and offsets of every token
+         * are collected: structural characters, opening and closing quotes and first characters of numbers and
+         * literals. Contents of strings and whitespace never get into index
+         */
+        class structural_index {
+        public:
+            /**
+             * Block classification implementation
+             */
+            enum class kernel {
+                Scalar,
+                Sse42,
+                Avx2
+            };
+
+            /**
+             * Get fastest kernel supported by current CPU
+             * @return kernel
+             */
+            static kernel best_kernel();
+
+            /**
+             * Check if kernel can run on current CPU
+             * @param _k kernel
+             * @return true if kernel is supported
+             */
+            static bool supported(kernel _k);
+
+            /**
+             * Create index builder
+             * @param _k kernel to classify blocks with. Must be supported by current CPU
+             */
+            explicit structural_index(kernel _k = best_kernel());
+
+            /**
+             * Build index of document. Fails on unterminated string, control character inside string
+             * or document larger than 4 GiB
+             * @param _s JSON text
+             * @return false on failure
+             */
+            bool build(const bp::string_view &_s);
+
+            /**
+             * Token offsets in order of appearance. Valid after successful build
+             */
+            inline const uint32_t *begin() const { return positions_.data(); }
+
+            inline const uint32_t *end() const { return positions_.data() + count_; }
+
+            inline size_t size() const { return count_; }
+
+            /**
+             * Get description of last build error
+             * @return error message or nullptr
+             */
+            inline const char *error() const { return error_; }
+
+            /**
+             * Get offset of last build error
+             * @return offset in document
+             */
+            inline size_t error_offset() const { return error_offset_; }
+
+        private:
+            struct block_masks {
+                uint64_t quote;
+                uint64_t backslash;
+                uint64_t whitespace;
+                uint64_t structural;
+                uint64_t control;
+            };
+
+            typedef void (*classify_fn)(const uint8_t *_block, block_masks &_masks);
+
+            static void classify_scalar(const uint8_t *_block, block_masks &_masks);
+
+#ifdef BP_JSON_SIMD_X86
+            static void classify_sse42(const uint8_t *_block, block_masks &_masks);
+
+            static void classify_avx2(const uint8_t *_block, block_masks &_masks);
+#endif
+
+            bool fail(const char *_msg, size_t _offset);
+
+            classify_fn classify_;
+            // grows on demand and is reused by subsequent builds
+            std::vector<uint32_t> positions_;
+            size_t count_ = 0;
+            const char *error_ = nullptr;
+            size_t error_offset_ = 0;
+        };
+    }
+}
+
+#endif //SERIALIZERS_JSON_INDEX_HPP
@@ -0,0 +1,354 @@
+#ifndef SERIALIZERS_JSON_READER_HPP
+#define SERIALIZERS_JSON_READER_HPP
+
+#include <string>
+#include <vector>
+#include "../structure.hpp"
+#include "json_handler.hpp"
+#include "json_index.hpp"
+#include "key_cache.hpp"
+#include "push_status.hpp"
+
+namespace bp {
+    namespace serializers {
+
+        /**
+         * Handler building tree from parse events. Containers are sized once on close
+         */
+        class tree_builder : public json_handler {
+        public:
+            /**
+             * Create builder
+             * @param _arena arena to allocate nodes from or nullptr for heap
+             * @param _pool pool to intern string values in or nullptr
+             */
+            explicit tree_builder(bp::arena *_arena = nullptr, bp::string_pool *_pool = nullptr);
+
+            bool start_object() override;
+
+            void end_object() override;
+
+            bool start_array() override;
+
+            void end_array() override;
+
+            bool key(bp::hash_type _hash, const bp::string_view &_name) override;
+
+            void null_value() override;
+
+            void bool_value(bool _val) override;
+
+            void int_value(int64_t _val) override;
+
+            void uint_value(uint64_t _val) override;
+
+            void double_value(double _val) override;
+
+            void string_value(const bp::string_view &_val) override;
+
+            /**
+             * Take root of built tree and reset builder
+             * @return root node or nullptr if no value was built
+             */
+            serializable::tree_ptr release();
+
+            /**
+             * Drop partially built tree
+             */
+            void clear();
+
+            /**
+             * Set buffer string values may be borrowed from. String values lying in it are referenced
+             * instead of copied
+             * @param _source parsed buffer or empty view to copy all strings
+             */
+            inline void set_source(const bp::string_view &_source) { source_ = _source; }
+
+        private:
+            bp::arena *arena_;
+            bp::string_pool *pool_;
+            bp::string_view source_;
+            // items and keys of open containers
+            std::vector<serializable::tree_ptr> items_;
+            std::vector<bp::hash_type> keys_;
+            // sizes of items_ and keys_ when each open container started
+            std::vector<std::pair<size_t, size_t>> frames_;
+        };
+
+        /**
+         * Recursive descent JSON parser driven by structural index. Reports document to json_handler as it goes,
+         * keys are hashed in place and strings without escapes are passed as views into input buffer
+         */
+        class json_reader {
+        public:
+            /**
+             * Max nesting level of arrays and objects
+             */
+            static constexpr size_t max_depth = 512;
+
+            /**
+             * Create parser
+             * @param _arena arena to allocate nodes from or nullptr for heap
+             * @param _pool pool to intern string values in or nullptr
+             */
+            explicit json_reader(bp::arena *_arena = nullptr, bp::string_pool *_pool = nullptr);
+
+            /**
+             * Parse JSON document into tree. Throws structure::parse_error on malformed input
+             * @param _s JSON text
+             * @return root node or nullptr on failure in exceptionless mode
+             */
+            serializable::tree_ptr parse(const bp::string_view &_s)
+                    ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error));
+
+            /**
+             * Parse JSON document reporting it to handler. Subtrees skipped by handler are only checked
+             * for bracket balance. Throws structure::parse_error on malformed input
+             * @param _s JSON text
+             * @param _handler event receiver
+             * @return false on failure in exceptionless mode
+             */
+            bool parse(const bp::string_view &_s, json_handler &_handler)
+                    ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error));
+
+            /**
+             * Get description of last parse error
+             * @return error message or empty string
+             */
+            inline const std::string &error() const { return error_; }
+
+            /**
+             * Get structural index of last parsed document
+             * @return token offsets of document
+             */
+            inline const structural_index &index() const { return index_; }
+
+            /**
+             * Get cache of object keys seen by parser. Cache is kept between documents
+             * @return key cache with hit counters
+             */
+            inline const key_cache &keys() const { return keys_; }
+
+            /**
+             * Make parsed trees refer to string values in input instead of copying them. Strings with escapes
+             * are decoded into copies. Input must outlive parsed tree
+             * @param _enable true to enable zero-copy strings
+             */
+            inline void set_zero_copy(bool _enable) { zero_copy_ = _enable; }
+
+        private:
+            bool parse_value(size_t _depth);
+
+            bool parse_object(size_t _depth);
+
+            bool parse_array(size_t _depth);
+
+            bool parse_number();
+
+            bool parse_literal(const char *_literal, size_t _size);
+
+            /**
+             * Read string token at current index position. Result points into input if string has no escapes
+             * or into scratch buffer otherwise
+             * @param _out string contents
+             * @return false on malformed string
+             */
+            bool parse_string(bp::string_view &_out);
+
+            /**
+             * Jump over value at current index position without reporting it
+             * @return false on unbalanced brackets
+             */
+            bool skip_value();
+
+            /**
+             * Move to next token not before current position. Only whitespace is skipped: scalars are checked
+             * to end at delimiter and strings consume their closing quote
+             */
+            inline void skip_ws() {
+                auto offset = static_cast<uint32_t>(cur_ - begin_);
+                while (tok_ != tok_end_ && *tok_ < offset) ++tok_;
+                cur_ = tok_ != tok_end_ ? begin_ + *tok_ : end_;
+            }
+
+            /**
+             * Check that scalar token ends at whitespace, structural character, quote or end of input
+             */
+            bool at_delimiter() const;
+
+            bool fail(const char *_msg);
+
+            const char *begin_ = nullptr;
+            const char *cur_ = nullptr;
+            const char *end_ = nullptr;
+            structural_index index_;
+            const uint32_t *tok_ = nullptr;
+            const uint32_t *tok_end_ = nullptr;
+            json_handler *handler_ = nullptr;
+            key_cache keys_;
+            tree_builder builder_;
+            bool failed_ = false;
+            bool zero_copy_ = false;
+            std::string error_;
+            std::string scratch_;
+        };
+
+        /**
+         * Resumable JSON parser fed with chunks of input as they arrive, e.g. from socket. Parser keeps its state
+         * between chunks and reports document to json_handler as it goes, so only unfinished string or number
+         * token is buffered instead of whole document. Chunk boundary may fall anywhere, including inside
+         * escape sequence or UTF-8 character
+         */
+        class json_push_parser {
+        public:
+            /**
+             * Create parser building trees
+             * @param _arena arena to allocate nodes from or nullptr for heap
+             * @param _pool pool to intern string values in or nullptr
+             */
+            explicit json_push_parser(bp::arena *_arena = nullptr, bp::string_pool *_pool = nullptr);
+
+            /**
+             * Create parser reporting documents to handler. Handler must outlive parser
+             * @param _handler event receiver
+             */
+            explicit json_push_parser(json_handler &_handler);
+
+            json_push_parser(const json_push_parser &) = delete;
+
+            json_push_parser &operator=(const json_push_parser &) = delete;
+
+            /**
+             * Parse next chunk of document. Parsing stops at the end of document, rest of chunk is left for
+             * the next one (see consumed()). Throws structure::parse_error on malformed input
+             * @param _chunk bytes of input, not referenced after call
+             * @return NeedMore if document continues in next chunk, Complete if it is finished
+             * or Error on failure in exceptionless mode
+             */
+            push_status feed(const bp::string_view &_chunk) ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error));
+
+            /**
+             * Signal end of input. Completes top-level number which has no delimiter after it.
+             * Throws structure::parse_error if document is cut
+             * @return Complete if document is finished, NeedMore if no document was started
+             * or Error on failure in exceptionless mode
+             */
+            push_status finish() ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error));
+
+            /**
+             * Move completed document into structure and start next one. Nodes are allocated from parser's arena
+             * @param _out structure to put document into
+             * @return false if document is not complete or parser reports to external handler
+             */
+            bool take(structure &_out);
+
+            /**
+             * Drop partially parsed document and error
+             */
+            void reset();
+
+            /**
+             * Get number of bytes of last chunk consumed by parser
+             * @return chunk size unless document is complete or failed in the middle of chunk
+             */
+            inline size_t consumed() const { return consumed_; }
+
+            /**
+             * Get description of failure
+             * @return error message or empty string
+             */
+            inline const std::string &error() const { return error_; }
+
+            /**
+             * Get cache of object keys seen by parser. Cache is kept between documents
+             * @return key cache with hit counters
+             */
+            inline const key_cache &keys() const { return keys_; }
+
+        private:
+            enum class state : uint8_t {
+                Value,
+                ArrayFirst,
+                ObjectFirst,
+                Key,
+                Colon,
+                AfterValue,
+                String,
+                Number,
+                Literal,
+                Done,
+                Failed
+            };
+
+            /**
+             * Run state machine over input
+             * @return position after last consumed byte
+             */
+            const char *run(const char *_it, const char *_end);
+
+            /**
+             * Open container at bracket
+             */
+            bool open(const char *_at);
+
+            /**
+             * Close innermost container
+             */
+            void close();
+
+            bool end_string(const char *_end);
+
+            bool end_number(const char *_end);
+
+            /**
+             * Get contents of finished token. Token is either in current chunk or buffered from previous ones
+             */
+            bp::string_view token(const char *_end);
+
+            /**
+             * Check whether current value is skipped by handler
+             */
+            inline bool quiet() const { return skip_value_ || frames_.size() >= skip_depth_; }
+
+            /**
+             * Value is finished, move to the next one
+             */
+            void end_value();
+
+            bool fail(const char *_msg, const char *_at);
+
+            push_status status() ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error));
+
+            json_handler *handler_;
+            bp::arena *arena_;
+            tree_builder builder_;
+            key_cache keys_;
+            state state_ = state::Value;
+            // open containers: '{' or '['
+            std::string frames_;
+            // containers at this depth and deeper are skipped by handler
+            size_t skip_depth_ = SIZE_MAX;
+            // next value is skipped by handler
+            bool skip_value_ = false;
+            // unfinished token is object key
+            bool key_ = false;
+            // last byte of string was backslash
+            bool escape_ = false;
+            // string has escape sequences
+            bool escaped_ = false;
+            const char *literal_ = nullptr;
+            size_t literal_pos_ = 0;
+            // start of token in current chunk or nullptr if token started in previous chunk
+            const char *mark_ = nullptr;
+            const char *chunk_ = nullptr;
+            std::string token_;
+            std::string scratch_;
+            // bytes of document consumed before current chunk
+            size_t offset_ = 0;
+            size_t consumed_ = 0;
+            std::string error_;
+        };
+    }
+}
+
+#endif //SERIALIZERS_JSON_READER_HPP
@@ -0,0 +1,72 @@
+#ifndef SERIALIZERS_JSON_TAPE_HPP
+#define SERIALIZERS_JSON_TAPE_HPP
+
+#include <string>
+#include <vector>
+#include "../structure.hpp"
+#include "json_reader.hpp"
+
+namespace bp {
+    namespace serializers {
+
+        /**
+         * Validated JSON document kept as text and tape of token offsets. Containers are materialized
+         * one level at a time when accessed, nested containers stay raw until accessed in turn
+         */
+        class json_tape : public serializable::raw_source {
+        public:
+            /**
+             * Validate document and create its root node. Root container is left raw.
+             * Throws structure::parse_error on malformed input
+             * @param _s JSON text, copied into tape unless zero-copy is requested
+             * @param _arena arena to allocate materialized nodes from or nullptr for heap
+             * @param _pool pool to intern string values in or nullptr
+             * @param _zero_copy refer to text and its string values instead of copying them,
+             * text must outlive all nodes
+             * @return root node or nullptr on failure in exceptionless mode
+             */
+            static serializable::tree_ptr parse(const bp::string_view &_s, bp::arena *_arena = nullptr,
+                                                bp::string_pool *_pool = nullptr, bool _zero_copy = false)
+                    ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error));
+
+            /**
+             * Create empty tape. Use parse() to create tapes
+             */
+            json_tape(bp::arena *_arena, bp::string_pool *_pool);
+
+            void materialize(uint32_t _index, serializable::tree &_out) const override;
+
+            bp::string_view text(uint32_t _index) const override;
+
+            bp::hash_type format() const override;
+
+        private:
+            /**
+             * Create node for value at token. Containers are left raw
+             * @param _index token index, moved past value
+             * @return value node
+             */
+            serializable::tree_ptr value(uint32_t &_index) const;
+
+            bp::hash_type key(uint32_t _index) const;
+
+            inline char token(uint32_t _index) const { return text_[offsets_[_index]]; }
+
+            bp::arena *arena_;
+            bp::string_pool *pool_;
+            bool zero_copy_ = false;
+            // copy of document text, empty in zero-copy mode
+            std::string copy_;
+            const char *text_ = nullptr;
+            size_t size_ = 0;
+            std::vector<uint32_t> offsets_;
+            // index of matching closing bracket for tokens opening containers
+            std::vector<uint32_t> jumps_;
+            // parses scalars with escapes or numbers
+            mutable json_reader reader_;
+            mutable key_cache keys_;
+        };
+    }
+}
+
+#endif //SERIALIZERS_JSON_TAPE_HPP
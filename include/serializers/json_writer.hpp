@@ -0,0 +1,137 @@
+#ifndef SERIALIZERS_JSON_WRITER_HPP
+#define SERIALIZERS_JSON_WRITER_HPP
+
+#include <string>
+#include "../structure_view.hpp"
+
+namespace bp {
+    namespace serializers {
+
+        /**
+         * Receiver of JSON text produced by writer, e.g. socket or UART
+         */
+        class json_sink {
+        public:
+            virtual ~json_sink() = default;
+
+            /**
+             * Take next piece of text. Pieces are not split inside scalar values
+             * @param _data text
+             * @param _size text length
+             * @return false to stop writing
+             */
+            virtual bool write(const char *_data, size_t _size) = 0;
+        };
+
+        /**
+         * Streaming JSON writer. Walks structure once and appends JSON text straight into output string or passes
+         * it to sink piece by piece. Strings are read from tree storage without copying
+         */
+        class json_writer {
+        public:
+            enum class style {
+                /**
+                 * No whitespace between tokens
+                 */
+                Compact,
+                /**
+                 * One item per line, nested items indented
+                 */
+                Pretty
+            };
+
+            /**
+             * Create writer
+             * @param _out string to append JSON to
+             * @param _style output style
+             * @param _indent number of spaces per nesting level in pretty style
+             */
+            explicit json_writer(std::string &_out, style _style = style::Compact, unsigned _indent = 4);
+
+            /**
+             * Create writer passing text to sink. Text is collected in small buffer which is handed to sink
+             * when it grows over flush size, so memory use does not depend on document size
+             * @param _sink text receiver, must outlive writer
+             * @param _style output style
+             * @param _indent number of spaces per nesting level in pretty style
+             * @param _flush_size buffered bytes to pass to sink at
+             */
+            explicit json_writer(json_sink &_sink, style _style = style::Compact, unsigned _indent = 4,
+                                 size_t _flush_size = 256);
+
+            json_writer(const json_writer &) = delete;
+
+            json_writer &operator=(const json_writer &) = delete;
+
+            /**
+             * Append value as JSON. Output string is reserved for estimated size first, sink receives
+             * all buffered text before return
+             * @param _v value to write
+             * @return false if sink refused text
+             */
+            bool write(const structure_view &_v);
+
+            /**
+             * Estimate JSON size of value without formatting it
+             * @param _v value to estimate
+             * @return approximate size in bytes
+             */
+            static size_t estimate_size(const structure_view &_v);
+
+            /**
+             * Compute exact length of compact JSON of value. Numbers are formatted to count their digits,
+             * nothing is allocated
+             * @param _v value to measure
+             * @return length in bytes
+             */
+            static size_t measure(const structure_view &_v);
+
+        private:
+            void write_value(const structure_view &_v, unsigned _level);
+
+            void write_string(const char *_data, size_t _size);
+
+            void write_number(const structure_view &_v);
+
+            /**
+             * Pass buffered text to sink
+             */
+            void flush();
+
+            inline void new_line(unsigned _level) {
+                if (style_ == style::Pretty) {
+                    out_ += '\n';
+                    out_.append(_level * indent_, ' ');
+                }
+            }
+
+            // text waiting for sink
+            std::string buffer_;
+            std::string &out_;
+            style style_;
+            unsigned indent_;
+            json_sink *sink_ = nullptr;
+            size_t flush_size_ = 0;
+            bool failed_ = false;
+        };
+
+        /**
+         * Serialize value to JSON
+         * @param _v value to serialize
+         * @param _style output style
+         * @return JSON text
+         */
+        std::string to_json(const structure_view &_v, json_writer::style _style = json_writer::style::Compact);
+
+        /**
+         * Serialize value to compact JSON in caller's buffer. Text is not null-terminated
+         * @param _v value to serialize
+         * @param _buf output buffer
+         * @param _size buffer size
+         * @return JSON length. Nothing is written if it exceeds buffer size
+         */
+        size_t to_json(const structure_view &_v, char *_buf, size_t _size);
+    }
+}
+
+#endif //SERIALIZERS_JSON_WRITER_HPP
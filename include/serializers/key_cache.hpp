@@ -0,0 +1,111 @@
+#ifndef SERIALIZERS_KEY_CACHE_HPP
+#define SERIALIZERS_KEY_CACHE_HPP
+
+#include <cstring>
+#include <memory>
+#include <binelpro/symbol.hpp>
+
+namespace bp {
+    namespace serializers {
+
+        /**
+         * Direct-mapped cache of recently seen object keys and their symbol hashes. Slot is picked by length
+         * and first and last eight bytes of key, so lookup cost does not depend on key length. Key is hashed
+         * and registered as symbol only on miss, repeated keys in arrays of similar objects are found in cache
+         */
+        class key_cache {
+        public:
+            static constexpr size_t default_slots = 128;
+
+            /**
+             * Longer keys are not cached
+             */
+            static constexpr size_t max_key_size = 32;
+
+            /**
+             * Create cache. Slots are allocated on first miss
+             * @param _slots number of slots, rounded up to power of two
+             */
+            explicit key_cache(size_t _slots = default_slots);
+
+            key_cache(key_cache &&) = default;
+
+            key_cache &operator=(key_cache &&) = default;
+
+            /**
+             * Get symbol hash of key
+             * @param _key key bytes
+             * @return hash of key
+             */
+            inline bp::hash_type hash(const bp::string_view &_key) {
+                if (slots_ && _key.size() <= max_key_size) {
+                    auto &e = slots_[slot(_key)];
+                    if (e.size == _key.size() && std::memcmp(e.key, _key.data(), _key.size()) == 0) {
+                        ++hits_;
+                        return e.hash;
+                    }
+                }
+                return insert(_key);
+            }
+
+            /**
+             * Get number of keys found in cache
+             */
+            inline uint64_t hits() const { return hits_; }
+
+            /**
+             * Get number of keys hashed, including keys too long to cache
+             */
+            inline uint64_t misses() const { return misses_; }
+
+            /**
+             * Get share of keys found in cache
+             * @return hit rate in [0, 1], 0 if no keys were looked up
+             */
+            double hit_rate() const;
+
+            /**
+             * Reset hit and miss counters
+             */
+            void reset_stats();
+
+            /**
+             * Drop cached keys
+             */
+            void clear();
+
+        private:
+            struct entry {
+                // max_key_size + 1 marks empty slot
+                uint32_t size;
+                bp::hash_type hash;
+                char key[max_key_size];
+            };
+
+            inline size_t slot(const bp::string_view &_key) const {
+                uint64_t head = 0, tail = _key.size();
+                if (_key.size() >= 8) {
+                    std::memcpy(&head, _key.data(), 8);
+                    std::memcpy(&tail, _key.data() + _key.size() - 8, 8);
+                } else {
+                    std::memcpy(&head, _key.data(), _key.size());
+                }
+                auto h = (head ^ (tail * 0x9E3779B97F4A7C15ULL) ^ _key.size()) * 0xFF51AFD7ED558CCDULL;
+                return static_cast<size_t>(h >> shift_);
+            }
+
+            /**
+             * Hash key and put it into its slot
+             */
+            bp::hash_type insert(const bp::string_view &_key);
+
+            std::unique_ptr<entry[]> slots_;
+            size_t size_;
+            unsigned shift_;
+            uint64_t hits_ = 0;
+            uint64_t misses_ = 0;
+        };
+    }
+}
+
+#endif //SERIALIZERS_KEY_CACHE_HPP
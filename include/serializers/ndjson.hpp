@@ -0,0 +1,191 @@
+#ifndef SERIALIZERS_NDJSON_HPP
+#define SERIALIZERS_NDJSON_HPP
+
+#include <cstdio>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../structure.hpp"
+#include "../structure_view.hpp"
+#include "json_reader.hpp"
+
+namespace bp {
+    namespace serializers {
+
+        /**
+         * Record framing of JSON stream
+         */
+        enum class json_framing {
+            /**
+             * Newline-delimited JSON: one document per line
+             */
+            Lines,
+            /**
+             * JSON text sequence (RFC 7464): every document is prefixed with RS (0x1E) and followed by newline
+             */
+            Sequence
+        };
+
+        /**
+         * Streaming reader of newline-delimited JSON and JSON text sequences. Input is read through bounded buffer,
+         * records are parsed into reader's arena which is recycled between records, so memory use does not
+         * depend on stream size
+         */
+        class ndjson_reader {
+        public:
+            static constexpr size_t default_buffer_size = 64 * 1024;
+            static constexpr size_t default_max_record_size = 16 * 1024 * 1024;
+
+            /**
+             * Read from file descriptor. Descriptor is not closed by reader
+             * @param _fd file descriptor
+             * @param _buffer_size initial buffer size
+             * @param _max_record_size max record length, buffer never grows beyond it
+             */
+            explicit ndjson_reader(int _fd, size_t _buffer_size = default_buffer_size,
+                                   size_t _max_record_size = default_max_record_size);
+
+            /**
+             * Read from stdio file. File is not closed by reader
+             */
+            explicit ndjson_reader(FILE *_file, size_t _buffer_size = default_buffer_size,
+                                   size_t _max_record_size = default_max_record_size);
+
+            /**
+             * Read from input stream
+             */
+            explicit ndjson_reader(std::istream &_stream, size_t _buffer_size = default_buffer_size,
+                                   size_t _max_record_size = default_max_record_size);
+
+            ndjson_reader(const ndjson_reader &) = delete;
+
+            ndjson_reader &operator=(const ndjson_reader &) = delete;
+
+            /**
+             * Read next record. Empty lines and RS separators are skipped. Record is valid until next call,
+             * its nodes are allocated from reader's arena. Throws structure::parse_error on malformed record,
+             * record longer than max size or read failure
+             * @param _out structure to put record into
+             * @return false at the end of stream or on failure in exceptionless mode
+             */
+            bool next(structure &_out) ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error));
+
+            /**
+             * Set pool record string values are interned in. Pool must outlive records
+             * @param _pool string pool or nullptr to disable interning
+             */
+            void set_string_pool(bp::string_pool *_pool);
+
+            /**
+             * Get number of lines consumed so far
+             * @return line number of last read record
+             */
+            inline size_t line() const { return line_; }
+
+            /**
+             * Get description of last failure
+             * @return error message or empty string
+             */
+            inline const std::string &error() const { return error_; }
+
+            /**
+             * Get cache of object keys seen in records
+             * @return key cache with hit counters
+             */
+            inline const key_cache &keys() const { return reader_.keys(); }
+
+        private:
+            ndjson_reader(size_t _buffer_size, size_t _max_record_size);
+
+            /**
+             * Read more input into buffer, growing it if it is full
+             * @return false at the end of input or on failure
+             */
+            bool fill();
+
+            bool fail(const std::string &_msg);
+
+            int fd_ = -1;
+            FILE *file_ = nullptr;
+            std::istream *stream_ = nullptr;
+            std::vector<char> buffer_;
+            size_t begin_ = 0;
+            size_t end_ = 0;
+            // bytes after begin_ already searched for newline
+            size_t scanned_ = 0;
+            size_t max_record_size_;
+            bool eof_ = false;
+            size_t line_ = 0;
+            std::string error_;
+            bp::arena arena_;
+            json_reader reader_;
+        };
+
+        /**
+         * Streaming writer of newline-delimited JSON and JSON text sequences. Records are formatted into
+         * buffer flushed to sink when it grows over flush threshold
+         */
+        class ndjson_writer {
+        public:
+            static constexpr size_t default_flush_size = 64 * 1024;
+
+            /**
+             * Write to file descriptor. Descriptor is not closed by writer
+             * @param _fd file descriptor
+             * @param _framing record framing
+             * @param _flush_size buffered bytes to flush at
+             */
+            explicit ndjson_writer(int _fd, json_framing _framing = json_framing::Lines,
+                                   size_t _flush_size = default_flush_size);
+
+            /**
+             * Write to stdio file. File is not closed by writer
+             */
+            explicit ndjson_writer(FILE *_file, json_framing _framing = json_framing::Lines,
+                                   size_t _flush_size = default_flush_size);
+
+            /**
+             * Write to output stream
+             */
+            explicit ndjson_writer(std::ostream &_stream, json_framing _framing = json_framing::Lines,
+                                   size_t _flush_size = default_flush_size);
+
+            ndjson_writer(const ndjson_writer &) = delete;
+
+            ndjson_writer &operator=(const ndjson_writer &) = delete;
+
+            /**
+             * Flush buffered records. Write errors are ignored, call flush() to detect them
+             */
+            ~ndjson_writer();
+
+            /**
+             * Append record. Throws structure::structure_error on write failure
+             * @param _record record to write
+             * @return false on write failure in exceptionless mode
+             */
+            bool write(const structure_view &_record) ENABLE_IF_HAS_EXCEPTIONS(throw (structure::structure_error));
+
+            /**
+             * Write buffered records to sink. Throws structure::structure_error on write failure
+             * @return false on write failure in exceptionless mode
+             */
+            bool flush() ENABLE_IF_HAS_EXCEPTIONS(throw (structure::structure_error));
+
+        private:
+            ndjson_writer(json_framing _framing, size_t _flush_size);
+
+            bool write_out() noexcept;
+
+            int fd_ = -1;
+            FILE *file_ = nullptr;
+            std::ostream *stream_ = nullptr;
+            json_framing framing_;
+            size_t flush_size_;
+            std::string buffer_;
+        };
+    }
+}
+
+#endif //SERIALIZERS_NDJSON_HPP
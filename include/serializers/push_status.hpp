@@ -0,0 +1,27 @@
+#ifndef SERIALIZERS_PUSH_STATUS_HPP
+#define SERIALIZERS_PUSH_STATUS_HPP
+
+namespace bp {
+    namespace serializers {
+
+        /**
+         * Result of feeding chunk of input to push parser
+         */
+        enum class push_status {
+            /**
+             * Whole chunk is consumed, document is not complete yet
+             */
+            NeedMore,
+            /**
+             * Document is complete. Bytes of chunk after it are not consumed
+             */
+            Complete,
+            /**
+             * Input is malformed. Reported only in exceptionless mode, parse_error is thrown otherwise
+             */
+            Error
+        };
+    }
+}
+
+#endif //SERIALIZERS_PUSH_STATUS_HPP
@@ -0,0 +1,359 @@
+#ifndef BP_SMALL_MAP_HPP
+#define BP_SMALL_MAP_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "hash_table.hpp"
+
+namespace bp {
+
+    /**
+     * Associative container keeping up to N entries inline in a flat array sorted by key.
+     * Lookups in small mode are a linear scan over contiguous keys. Once the map grows
+     * over inline capacity, entries are moved to an open-addressing bp::hash_table.
+     * Iteration order is ascending key order in small mode and unspecified in large mode: it depends on
+     * capacity and on history of insertions and erasures. Serializers restore ascending key order with
+     * structure_view::for_each_sorted, so equal objects are written as the same bytes.
+     * @tparam Key key type, must be cheap to compare and convertible to an unsigned integer
+     * @tparam T mapped type
+     * @tparam N inline capacity
+     * @tparam Alloc allocator for the hash table
+     */
+    template<typename Key, typename T, size_t N,
+             typename Alloc = std::allocator<std::pair<const Key, T>>>
+    class small_map {
+        using large_type = hash_table<Key, T, Alloc>;
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+        using value_type = std::pair<const Key, T>;
+        using size_type = size_t;
+        using allocator_type = Alloc;
+
+        static constexpr size_t inline_capacity = N;
+
+        template<bool Const>
+        class iterator_base : public std::iterator<std::forward_iterator_tag,
+                typename std::conditional<Const, const value_type, value_type>::type> {
+            friend class small_map;
+
+            using entry_pointer = typename std::conditional<Const, const value_type *, value_type *>::type;
+            using large_iterator = typename std::conditional<Const, typename large_type::const_iterator,
+                    typename large_type::iterator>::type;
+        public:
+            using reference = typename std::conditional<Const, const value_type &, value_type &>::type;
+
+            iterator_base() = default;
+
+            template<bool C, typename = typename std::enable_if<Const && !C>::type>
+            iterator_base(const iterator_base<C> &_it) : small_(_it.small_), ptr_(_it.ptr_), it_(_it.it_) {}
+
+            inline reference operator*() const { return small_ ? *ptr_ : *it_; }
+
+            inline entry_pointer operator->() const { return &operator*(); }
+
+            inline iterator_base &operator++() {
+                if (small_) ++ptr_; else ++it_;
+                return *this;
+            }
+
+            inline iterator_base operator++(int) {
+                iterator_base tmp(*this);
+                operator++();
+                return tmp;
+            }
+
+            inline bool operator==(const iterator_base &_rhs) const {
+                return small_ ? ptr_ == _rhs.ptr_ : it_ == _rhs.it_;
+            }
+
+            inline bool operator!=(const iterator_base &_rhs) const { return !operator==(_rhs); }
+
+        private:
+            template<bool> friend class iterator_base;
+
+            explicit iterator_base(entry_pointer _ptr) : small_(true), ptr_(_ptr) {}
+
+            explicit iterator_base(large_iterator _it) : small_(false), it_(_it) {}
+
+            bool small_ = true;
+            entry_pointer ptr_ = nullptr;
+            large_iterator it_;
+        };
+
+        using iterator = iterator_base<false>;
+        using const_iterator = iterator_base<true>;
+
+        explicit small_map(const Alloc &_alloc = Alloc()) : alloc_(_alloc) {}
+
+        small_map(const small_map &_m) :
+                alloc_(std::allocator_traits<Alloc>::select_on_container_copy_construction(_m.alloc_)) {
+            copy_from(_m);
+        }
+
+        small_map(const small_map &_m, const Alloc &_alloc) : alloc_(_alloc) {
+            copy_from(_m);
+        }
+
+        small_map(small_map &&_m) : alloc_(_m.alloc_) {
+            move_from(std::move(_m));
+        }
+
+        small_map &operator=(const small_map &_m) {
+            if (this != &_m) {
+                clear();
+                copy_from(_m);
+            }
+            return *this;
+        }
+
+        small_map &operator=(small_map &&_m) {
+            if (this != &_m) {
+                clear();
+                move_from(std::move(_m));
+            }
+            return *this;
+        }
+
+        ~small_map() { clear(); }
+
+        inline iterator begin() { return small_ ? iterator(entries()) : iterator(large_.begin()); }
+
+        inline iterator end() { return small_ ? iterator(entries() + size_) : iterator(large_.end()); }
+
+        inline const_iterator begin() const {
+            return small_ ? const_iterator(entries()) : const_iterator(large_.begin());
+        }
+
+        inline const_iterator end() const {
+            return small_ ? const_iterator(entries() + size_) : const_iterator(large_.end());
+        }
+
+        inline size_t size() const { return small_ ? size_ : large_.size(); }
+
+        inline bool empty() const { return size() == 0; }
+
+        inline Alloc get_allocator() const { return alloc_; }
+
+        /**
+         * Check whether entries are kept in inline storage
+         * @return true if map is in small mode
+         */
+        inline bool is_inline() const { return small_; }
+
+        /**
+         * Prepare map for specified number of entries. Map switches to hash table at once
+         * if entries do not fit into inline storage
+         * @param _n expected number of entries
+         */
+        void reserve(size_t _n) {
+            if (!small_) {
+                large_.reserve(_n);
+            } else if (_n > N) {
+                grow(_n);
+            }
+        }
+
+        inline iterator find(const Key &_key) {
+            if (!small_) return iterator(large_.find(_key));
+            auto e = entries();
+            for (size_t i = 0; i < size_; ++i) {
+                if (!(e[i].first < _key)) {
+                    return e[i].first == _key ? iterator(e + i) : end();
+                }
+            }
+            return end();
+        }
+
+        inline const_iterator find(const Key &_key) const {
+            return const_cast<small_map *>(this)->find(_key);
+        }
+
+        inline size_t count(const Key &_key) const {
+            return find(_key) != end() ? 1 : 0;
+        }
+
+#if defined(__EXCEPTIONS) || defined(_MSC_VER)
+        /**
+         * Get mapped value. Not available in exceptionless builds, find() is used there
+         * @throw std::out_of_range if key is missing
+         */
+        T &at(const Key &_key) {
+            auto it = find(_key);
+            if (it == end()) {
+                throw std::out_of_range("small_map::at");
+            }
+            return it->second;
+        }
+
+        inline const T &at(const Key &_key) const {
+            return const_cast<small_map *>(this)->at(_key);
+        }
+#endif
+
+        /**
+         * Insert entry unless key is present
+         * @return entry position and true if entry was inserted,
+         *         end() and false if map could not grow in node_pool::checked_scope
+         */
+        template<typename ...Args>
+        std::pair<iterator, bool> emplace(const Key &_key, Args &&..._args) {
+            if (!small_) {
+                return large_emplace(_key, std::forward<Args>(_args)...);
+            }
+            auto pos = small_lower_bound(_key);
+            auto e = entries();
+            if (pos < size_ && e[pos].first == _key) {
+                return std::make_pair(iterator(e + pos), false);
+            }
+            if (size_ == N) {
+                if (!grow(N * 2)) {
+                    return std::make_pair(end(), false);
+                }
+                return large_emplace(_key, std::forward<Args>(_args)...);
+            }
+            for (size_t i = size_; i > pos; --i) {
+                new(e + i) value_type(std::move(e[i - 1]));
+                e[i - 1].~value_type();
+            }
+            new(e + pos) value_type(std::piecewise_construct, std::forward_as_tuple(_key),
+                                    std::forward_as_tuple(std::forward<Args>(_args)...));
+            ++size_;
+            return std::make_pair(iterator(e + pos), true);
+        }
+
+        template<typename ...Args>
+        inline iterator emplace_hint(const_iterator, const Key &_key, Args &&..._args) {
+            return emplace(_key, std::forward<Args>(_args)...).first;
+        }
+
+        T &operator[](const Key &_key) {
+            return emplace(_key).first->second;
+        }
+
+        size_t erase(const Key &_key) {
+            if (!small_) return large_.erase(_key);
+            auto it = find(_key);
+            if (it == end()) return 0;
+            erase_small(static_cast<size_t>(it.ptr_ - entries()));
+            return 1;
+        }
+
+        iterator erase(const_iterator _pos) {
+            if (!small_) return iterator(large_.erase(_pos.it_));
+            auto pos = static_cast<size_t>(_pos.ptr_ - entries());
+            erase_small(pos);
+            return iterator(entries() + pos);
+        }
+
+        void clear() {
+            if (small_) {
+                auto e = entries();
+                for (size_t i = 0; i < size_; ++i) {
+                    e[i].~value_type();
+                }
+                size_ = 0;
+            } else {
+                large_.~large_type();
+                small_ = true;
+                size_ = 0;
+            }
+        }
+
+    private:
+        inline value_type *entries() { return reinterpret_cast<value_type *>(&inline_); }
+
+        inline const value_type *entries() const { return reinterpret_cast<const value_type *>(&inline_); }
+
+        inline size_t small_lower_bound(const Key &_key) const {
+            auto e = entries();
+            size_t i = 0;
+            while (i < size_ && e[i].first < _key) ++i;
+            return i;
+        }
+
+        template<typename ...Args>
+        inline std::pair<iterator, bool> large_emplace(const Key &_key, Args &&..._args) {
+            auto r = large_.emplace(_key, std::forward<Args>(_args)...);
+            return std::make_pair(iterator(r.first), r.second);
+        }
+
+        /**
+         * Move entries into hash table
+         * @return false if allocation failed in node_pool::checked_scope, map stays in small mode then
+         */
+
+        void erase_small(size_t _pos) {
+            auto e = entries();
+            e[_pos].~value_type();
+            for (size_t i = _pos + 1; i < size_; ++i) {
+                new(e + i - 1) value_type(std::move(e[i]));
+                e[i].~value_type();
+            }
+            --size_;
+        }
+
+        bool grow(size_t _capacity) {
+            large_type large(alloc_);
+            large.reserve(_capacity);
+            if (!large.capacity()) return false;
+            auto e = entries();
+            for (size_t i = 0; i < size_; ++i) {
+                large.emplace(e[i].first, std::move(e[i].second));
+                e[i].~value_type();
+            }
+            new(&large_) large_type(std::move(large));
+            small_ = false;
+            size_ = 0;
+            return true;
+        }
+
+        void copy_from(const small_map &_m) {
+            if (_m.small_) {
+                auto e = entries();
+                auto src = _m.entries();
+                for (size_t i = 0; i < _m.size_; ++i) {
+                    new(e + i) value_type(src[i]);
+                }
+                size_ = _m.size_;
+            } else {
+                new(&large_) large_type(_m.large_, alloc_);
+                small_ = false;
+            }
+        }
+
+        void move_from(small_map &&_m) {
+            if (_m.small_) {
+                auto e = entries();
+                auto src = _m.entries();
+                for (size_t i = 0; i < _m.size_; ++i) {
+                    new(e + i) value_type(std::move(src[i]));
+                }
+                size_ = _m.size_;
+            } else {
+                new(&large_) large_type(std::move(_m.large_), alloc_);
+                small_ = false;
+            }
+            _m.clear();
+        }
+
+        Alloc alloc_;
+        bool small_ = true;
+        size_t size_ = 0;
+        union {
+            typename std::aligned_storage<sizeof(value_type) * N, alignof(value_type)>::type inline_;
+            large_type large_;
+        };
+    };
+
+    template<typename Key, typename T, size_t N, typename Alloc>
+    constexpr size_t small_map<Key, T, N, Alloc>::inline_capacity;
+}
+
+#endif //BP_SMALL_MAP_HPP
@@ -0,0 +1,214 @@
+#ifndef BP_SMALL_VECTOR_HPP
+#define BP_SMALL_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace bp {
+
+    /**
+     * Vector keeping up to N elements inline. Elements are moved to allocator-provided
+     * buffer once the vector grows over inline capacity
+     * @tparam T element type
+     * @tparam N inline capacity
+     * @tparam Alloc allocator for spilled elements
+     */
+    template<typename T, size_t N, typename Alloc = std::allocator<T>>
+    class small_vector {
+        using traits = std::allocator_traits<Alloc>;
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T &;
+        using const_reference = const T &;
+        using pointer = T *;
+        using const_pointer = const T *;
+        using iterator = T *;
+        using const_iterator = const T *;
+        using allocator_type = Alloc;
+
+        static constexpr size_t inline_capacity = N;
+
+        explicit small_vector(const Alloc &_alloc = Alloc()) : alloc_(_alloc) {}
+
+        small_vector(const small_vector &_v) :
+                alloc_(traits::select_on_container_copy_construction(_v.alloc_)) {
+            reserve(_v.size_);
+            for (const auto &item: _v) {
+                new(data_ + size_) T(item);
+                ++size_;
+            }
+        }
+
+        small_vector(const small_vector &_v, const Alloc &_alloc) : alloc_(_alloc) {
+            reserve(_v.size_);
+            for (const auto &item: _v) {
+                new(data_ + size_) T(item);
+                ++size_;
+            }
+        }
+
+        small_vector(small_vector &&_v) noexcept : alloc_(std::move(_v.alloc_)) {
+            steal(std::move(_v));
+        }
+
+        small_vector &operator=(const small_vector &_v) {
+            if (this != &_v) {
+                clear();
+                reserve(_v.size_);
+                for (const auto &item: _v) {
+                    new(data_ + size_) T(item);
+                    ++size_;
+                }
+            }
+            return *this;
+        }
+
+        small_vector &operator=(small_vector &&_v) {
+            if (this != &_v) {
+                clear();
+                if (alloc_ == _v.alloc_) {
+                    release();
+                    steal(std::move(_v));
+                } else {
+                    reserve(_v.size_);
+                    for (auto &item: _v) {
+                        new(data_ + size_) T(std::move(item));
+                        ++size_;
+                    }
+                    _v.clear();
+                }
+            }
+            return *this;
+        }
+
+        ~small_vector() {
+            clear();
+            release();
+        }
+
+        inline iterator begin() { return data_; }
+
+        inline iterator end() { return data_ + size_; }
+
+        inline const_iterator begin() const { return data_; }
+
+        inline const_iterator end() const { return data_ + size_; }
+
+        inline size_t size() const { return size_; }
+
+        inline size_t capacity() const { return capacity_; }
+
+        inline bool empty() const { return size_ == 0; }
+
+        inline T *data() { return data_; }
+
+        inline const T *data() const { return data_; }
+
+        inline T &operator[](size_t _i) { return data_[_i]; }
+
+        inline const T &operator[](size_t _i) const { return data_[_i]; }
+
+        inline T &back() { return data_[size_ - 1]; }
+
+        inline const T &back() const { return data_[size_ - 1]; }
+
+        inline Alloc get_allocator() const { return alloc_; }
+
+        /**
+         * Check whether elements are kept in inline storage
+         * @return true if no heap buffer is used
+         */
+        inline bool is_inline() const { return data_ == inline_data(); }
+
+        void reserve(size_t _n) {
+            if (_n <= capacity_) return;
+            T *buf = traits::allocate(alloc_, _n);
+            if (!buf) return;
+            for (size_t i = 0; i < size_; ++i) {
+                new(buf + i) T(std::move(data_[i]));
+                data_[i].~T();
+            }
+            release();
+            data_ = buf;
+            capacity_ = _n;
+        }
+
+        template<typename ...Args>
+        inline T &emplace_back(Args &&..._args) {
+            if (size_ == capacity_) {
+                reserve(capacity_ * 2);
+            }
+            new(data_ + size_) T(std::forward<Args>(_args)...);
+            return data_[size_++];
+        }
+
+        inline void push_back(const T &_val) { emplace_back(_val); }
+
+        inline void push_back(T &&_val) { emplace_back(std::move(_val)); }
+
+        inline void pop_back() {
+            data_[--size_].~T();
+        }
+
+        iterator erase(const_iterator _pos) {
+            auto pos = const_cast<iterator>(_pos);
+            std::move(pos + 1, end(), pos);
+            pop_back();
+            return pos;
+        }
+
+        void clear() {
+            for (size_t i = 0; i < size_; ++i) {
+                data_[i].~T();
+            }
+            size_ = 0;
+        }
+
+    private:
+        inline T *inline_data() { return reinterpret_cast<T *>(&inline_); }
+
+        inline const T *inline_data() const { return reinterpret_cast<const T *>(&inline_); }
+
+        inline void release() {
+            if (!is_inline()) {
+                traits::deallocate(alloc_, data_, capacity_);
+                data_ = inline_data();
+                capacity_ = N;
+            }
+        }
+
+        void steal(small_vector &&_v) {
+            if (_v.is_inline()) {
+                for (size_t i = 0; i < _v.size_; ++i) {
+                    new(data_ + i) T(std::move(_v.data_[i]));
+                }
+                size_ = _v.size_;
+                _v.clear();
+            } else {
+                data_ = _v.data_;
+                size_ = _v.size_;
+                capacity_ = _v.capacity_;
+                _v.data_ = _v.inline_data();
+                _v.size_ = 0;
+                _v.capacity_ = N;
+            }
+        }
+
+        Alloc alloc_;
+        T *data_ = inline_data();
+        size_t size_ = 0;
+        size_t capacity_ = N;
+        typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type inline_;
+    };
+
+    template<typename T, size_t N, typename Alloc>
+    constexpr size_t small_vector<T, N, Alloc>::inline_capacity;
+}
+
+#endif //BP_SMALL_VECTOR_HPP
@@ -0,0 +1,127 @@
+#ifndef BP_STRING_POOL_HPP
+#define BP_STRING_POOL_HPP
+
+#include <vector>
+#include "structure.hpp"
+
+namespace bp {
+
+    /**
+     * Deduplicating pool of immutable strings. Each distinct string is stored once and shared
+     * by all values referring to it, interned values equal only if they point to the same string.
+     * Strings are reference counted: they are kept while pool or any value refers to them and
+     * may be dropped from pool with collect(). If pool is bound to arena, strings are allocated
+     * from it and arena must outlive all values referring to them. Pool is not thread safe
+     */
+    class string_pool {
+    public:
+        static constexpr size_t default_max_length = 64;
+
+        /**
+         * Create pool
+         * @param _max_length max length of strings parsers intern automatically
+         * @param _arena arena to allocate strings from or nullptr for heap
+         */
+        explicit string_pool(size_t _max_length = default_max_length, bp::arena *_arena = nullptr);
+
+        string_pool(const string_pool &) = delete;
+
+        string_pool &operator=(const string_pool &) = delete;
+
+        /**
+         * Get interned string, adding it to pool if not found
+         * @param _s string to intern
+         * @return shared string
+         */
+        serializable::string_ptr intern(const bp::string_view &_s);
+
+        /**
+         * Find interned string
+         * @param _s string to look for
+         * @return shared string or nullptr if string is not interned
+         */
+        serializable::string_ptr find(const bp::string_view &_s) const;
+
+        /**
+         * Drop strings referenced by pool only
+         * @return number of dropped strings
+         */
+        size_t collect();
+
+        /**
+         * Check whether parsers should intern string of specified length. Short strings are kept
+         * inside nodes and are never interned
+         * @param _size string length
+         * @return true if string should be interned
+         */
+        inline bool should_intern(size_t _size) const {
+            return _size > serializable::tree::short_string_capacity && _size <= max_length_;
+        }
+
+        inline size_t size() const { return size_; }
+
+        inline size_t max_length() const { return max_length_; }
+
+        /**
+         * Get id marking strings interned in this pool
+         * @return pool id
+         */
+        inline uint32_t id() const { return id_; }
+
+    private:
+        static uint32_t hash(const bp::string_view &_s);
+
+        size_t find_slot(const bp::string_view &_s, uint32_t _hash) const;
+
+        void grow();
+
+        struct slot {
+            uint32_t hash;
+            serializable::string_ptr str;
+        };
+
+        std::vector<slot> slots_;
+        size_t size_ = 0;
+        size_t max_length_;
+        bp::arena *arena_;
+        uint32_t id_;
+    };
+
+    namespace serializable {
+        /**
+         * Create string value. String not fitting into node is borrowed if requested,
+         * otherwise it is interned if pool is specified and accepts its length
+         * @param _arena arena to allocate string characters from or nullptr for heap
+         * @param _pool pool to intern string in or nullptr
+         * @param _s string value
+         * @param _borrow refer to string characters instead of copying them
+         * @return string value
+         */
+        inline tree make_string_value(bp::arena *_arena, bp::string_pool *_pool, const bp::string_view &_s,
+                                      bool _borrow = false) {
+            if (_borrow && _s.size() > tree::short_string_capacity) {
+                return tree(borrowed_string{_s});
+            }
+            if (_pool && _pool->should_intern(_s.size())) {
+                return tree(_pool->intern(_s));
+            }
+            return tree(_s, _arena);
+        }
+
+        /**
+         * Create string node for parsed string. String not fitting into node is borrowed if requested,
+         * otherwise it is interned if pool is specified and accepts its length
+         * @param _arena arena to allocate node from or nullptr for heap
+         * @param _pool pool to intern string in or nullptr
+         * @param _s string value
+         * @param _borrow refer to string characters instead of copying them
+         * @return node pointer
+         */
+        inline tree_ptr make_string_tree(bp::arena *_arena, bp::string_pool *_pool, const bp::string_view &_s,
+                                         bool _borrow = false) {
+            return make_tree(_arena, make_string_value(_arena, _pool, _s, _borrow));
+        }
+    }
+}
+
+#endif //BP_STRING_POOL_HPP
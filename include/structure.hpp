@@ -6,9 +6,14 @@
 #include <vector>
 #include <memory>
 #include <cstdint>
+#include <cstring>
 #include "symbol.hpp"
 #include "util.hpp"
 #include "variant.hpp"
+#include "arena.hpp"
+#include "intrusive_ptr.hpp"
+#include "small_map.hpp"
+#include "small_vector.hpp"
 
 #if defined( __EXCEPTIONS) || defined( _MSC_VER)
 #define HAS_EXCEPTIONS
@@ -34,22 +39,198 @@ namespace bp {
 
     using namespace bp::literals;
 
+    class string_pool;
+
     // TODO: generic tree to allow custom types
 
     namespace serializable {
 
         using value = bp::variant<SERIALIZABLE_TYPES>;
-        using value_ptr = std::shared_ptr<value>;
+
+        /**
+         * Allocator for tree nodes and containers. Takes memory from arena if bound to it or from heap
+         * (node pool in pool builds) otherwise
+         */
+        template<typename T>
+        class allocator {
+        public:
+            using value_type = T;
+
+            allocator(bp::arena *_arena = nullptr) noexcept : arena_(_arena) {}
+
+            template<typename U>
+            allocator(const allocator<U> &_a) noexcept : arena_(_a.get_arena()) {}
+
+            inline T *allocate(size_t _n) {
+                if (arena_) {
+                    return static_cast<T *>(arena_->allocate(_n * sizeof(T), alignof(T)));
+                }
+                return static_cast<T *>(bp::node_allocate(_n * sizeof(T)));
+            }
+
+            inline void deallocate(T *_p, size_t) noexcept {
+                if (!arena_) {
+                    bp::node_deallocate(_p);
+                }
+            }
+
+            inline bp::arena *get_arena() const { return arena_; }
+
+            template<typename U>
+            inline bool operator==(const allocator<U> &_a) const { return arena_ == _a.get_arena(); }
+
+            template<typename U>
+            inline bool operator!=(const allocator<U> &_a) const { return arena_ != _a.get_arena(); }
+
+        private:
+            bp::arena *arena_;
+        };
 
         class tree;
 
-        using tree_ptr = std::shared_ptr<tree>;
+        /**
+         * Node handle. Nodes, containers and long strings carry embedded reference counters,
+         * so handles are a single pointer
+         */
+        using tree_ptr = bp::intrusive_ptr<tree>;
+
+        /**
+         * Object keeps up to object_inline_capacity keys in a flat hash-sorted array
+         */
+        constexpr size_t object_inline_capacity = 8;
+
+        class object : public bp::small_map<bp::hash_type, tree_ptr, object_inline_capacity,
+                                            allocator<std::pair<const bp::hash_type, tree_ptr>>> {
+            using base = bp::small_map<bp::hash_type, tree_ptr, object_inline_capacity,
+                                       allocator<std::pair<const bp::hash_type, tree_ptr>>>;
+        public:
+            using base::base;
+
+            object() = default;
 
-        using object = std::map<bp::hash_type, tree_ptr>;
-        using object_ptr = std::shared_ptr<object>;
+            inline const bp::ref_count &refs() const { return refs_; }
 
-        using array = std::vector<tree_ptr>;
-        using array_ptr = std::shared_ptr<array>;
+        private:
+            bp::ref_count refs_;
+        };
+        using object_ptr = bp::intrusive_ptr<object>;
+
+        /**
+         * Array keeps up to array_inline_capacity element handles without separate buffer
+         */
+        constexpr size_t array_inline_capacity = 4;
+
+        class array : public bp::small_vector<tree_ptr, array_inline_capacity, allocator<tree_ptr>> {
+            using base = bp::small_vector<tree_ptr, array_inline_capacity, allocator<tree_ptr>>;
+        public:
+            using base::base;
+
+            array() = default;
+
+            inline const bp::ref_count &refs() const { return refs_; }
+
+        private:
+            bp::ref_count refs_;
+        };
+        using array_ptr = bp::intrusive_ptr<array>;
+
+        /**
+         * Immutable string with characters placed right after the header
+         */
+        class string_node {
+        public:
+            inline const char *data() const { return reinterpret_cast<const char *>(this + 1); }
+
+            inline size_t size() const { return size_; }
+
+            inline bp::string_view view() const { return bp::string_view(data(), size_); }
+
+            /**
+             * Get id of string pool this string is interned in
+             * @return pool id or 0 if string is not interned
+             */
+            inline uint32_t pool_id() const { return pool_id_; }
+
+            inline const bp::ref_count &refs() const { return refs_; }
+
+            /**
+             * Create string
+             * @param _data string characters
+             * @param _size string length
+             * @param _arena arena to allocate string from or nullptr for heap
+             * @param _pool_id id of pool string is interned in
+             * @return string handle, empty if allocation failed in node_pool::checked_scope
+             */
+            static bp::intrusive_ptr<const string_node> create(const char *_data, size_t _size, bp::arena *_arena,
+                                                               uint32_t _pool_id = 0) {
+                auto bytes = sizeof(string_node) + _size;
+                void *mem = _arena ? _arena->allocate(bytes, alignof(string_node)) : bp::node_allocate(bytes);
+                if (!mem) {
+                    return nullptr;
+                }
+                auto node = new(mem) string_node(_size, _pool_id);
+                std::memcpy(reinterpret_cast<char *>(node + 1), _data, _size);
+                node->refs_.init(_arena != nullptr);
+                return bp::intrusive_ptr<const string_node>(node);
+            }
+
+        private:
+            string_node(size_t _size, uint32_t _pool_id) : size_(_size), pool_id_(_pool_id) {}
+
+            size_t size_;
+            uint32_t pool_id_;
+            bp::ref_count refs_;
+        };
+        using string_ptr = bp::intrusive_ptr<const string_node>;
+
+        inline string_ptr make_string(const char *_data, size_t _size, bp::arena *_arena = nullptr) {
+            return string_node::create(_data, _size, _arena);
+        }
+
+        /**
+         * Source of lazily parsed containers. Raw node refers to container in source by index and is replaced
+         * with materialized node on first access to its contents. Materialization mutates shared nodes, so raw
+         * trees must not be read from several threads at once
+         */
+        class raw_source {
+        public:
+            virtual ~raw_source() = default;
+
+            /**
+             * Build container at index. Nested containers may be left raw
+             * @param _index container index in source
+             * @param _out node to build container in
+             */
+            virtual void materialize(uint32_t _index, tree &_out) const = 0;
+
+            /**
+             * Get source text of container
+             * @param _index container index in source
+             * @return container text as written in source
+             */
+            virtual bp::string_view text(uint32_t _index) const = 0;
+
+            /**
+             * Get id of serializer source text is written in
+             * @return serializer type hash
+             */
+            virtual bp::hash_type format() const = 0;
+
+            inline const bp::ref_count &refs() const { return refs_; }
+
+        private:
+            bp::ref_count refs_;
+        };
+
+        using raw_ptr = bp::intrusive_ptr<const raw_source>;
+
+        /**
+         * String characters owned by someone else, e.g. buffer document was parsed from.
+         * Node created from it refers to characters without copying them
+         */
+        struct borrowed_string {
+            bp::string_view str;
+        };
 
 
         template<typename T>
@@ -58,7 +239,7 @@ namespace bp {
         using enable_if_serializable_t = typename std::enable_if<is_serializable<T>::value>::type;
 
         template<typename T>
-        using enable_if_variant_ptr_type_t = typename std::enable_if<bp::is_any_of<T, array_ptr, object_ptr, value_ptr>::value>::type;
+        using enable_if_variant_ptr_type_t = typename std::enable_if<bp::is_any_of<T, array_ptr, object_ptr, string_ptr>::value>::type;
 
         template<typename T>
         using is_variant_type = bp::is_any_of<std::remove_cv_t<std::remove_reference_t<T>>, value, object, array>;
@@ -73,71 +254,526 @@ namespace bp {
         template<typename T>
         using plain_type_t = std::remove_reference_t<std::remove_cv_t<T>>;
 
-        namespace {
-            // TODO: DRY
-            template<typename ValueType>
-            struct serializable_trait {
-                using type = value;
-            };
-            template<>
-            struct serializable_trait<value> {
-                using type = value;
-            };
-            template<>
-            struct serializable_trait<object> {
-                using type = object;
-            };
-            template<>
-            struct serializable_trait<array> {
-                using type = array;
-            };
+        /**
+         * Get minimal byte width of signed integer encoding
+         * @param _val integer value
+         * @return 1, 2, 4 or 8
+         */
+        inline uint8_t int_width(int64_t _val) {
+            return _val >= INT8_MIN && _val <= INT8_MAX ? 1 :
+                   _val >= INT16_MIN && _val <= INT16_MAX ? 2 :
+                   _val >= INT32_MIN && _val <= INT32_MAX ? 4 : 8;
+        }
+
+        /**
+         * Get minimal byte width of floating point encoding. Width describes storage only: double which
+         * happens to be exact float is still a double and must be printed with double precision
+         * @param _val floating point value
+         * @return 4 if value is exactly representable as float, 8 otherwise
+         */
+        inline uint8_t float_width(double _val) {
+            return static_cast<double>(static_cast<float>(_val)) == _val || _val != _val ? 4 : 8;
         }
 
-        class tree : public bp::variant<value_ptr, object_ptr, array_ptr> {
-            using base = bp::variant<value_ptr, object_ptr, array_ptr>;
+        /**
+         * Tagged tree node. Null, bool, numbers and short strings are stored inline,
+         * only containers and long strings are kept on the heap. Integers are kept in 64-bit lane,
+         * floating point numbers in double lane, both tagged with minimal width of their encoding
+         */
+        class tree {
         public:
-            tree() : base(std::make_shared<value>(nullptr)) {}
-            tree(int8_t _val) : base(std::make_shared<value>(static_cast<int>(_val))) {}
-            tree(uint8_t _val) : base(std::make_shared<value>(static_cast<int>(_val))) {}
-            tree(int16_t _val) : base(std::make_shared<value>(static_cast<int>(_val))) {}
-            tree(uint16_t _val) : base(std::make_shared<value>(static_cast<int>(_val))) {}
-            tree(int32_t _val) : base(std::make_shared<value>(static_cast<int>(_val))) {}
-            tree(uint32_t _val) : base(std::make_shared<value>(static_cast<int>(_val))) {}
+            /**
+             * Node payload kind
+             */
+            enum class kind : uint8_t {
+                Null,
+                Bool,
+                Int,
+                UInt,
+                Float,
+                ShortString,
+                String,
+                Interned,
+                Object,
+                Array,
+                /**
+                 * Object or array not materialized from raw_source yet
+                 */
+                Raw,
+                /**
+                 * String referring to characters outside of node, see borrowed_string
+                 */
+                StringView
+            };
 
-            tree(const bp::string_view &_val) : base( std::make_shared<value>(std::string(_val))) {}
-            tree(const char* _val) : base( _val?std::make_shared<value>(std::string(_val, const_length(_val))): nullptr) {}
+            /**
+             * Max length of string kept inside node without heap allocation
+             */
+            static constexpr size_t short_string_capacity = 16;
+
+            tree() noexcept : kind_(kind::Null) {}
+            tree(nullptr_t) noexcept : kind_(kind::Null) {}
+            tree(bool _val) noexcept : kind_(kind::Bool) { bool_ = _val; }
+            tree(float _val) noexcept : kind_(kind::Float), width_(4) { double_ = _val; }
+            tree(double _val) noexcept : kind_(kind::Float), width_(float_width(_val)) { double_ = _val; }
+
+            template<typename T, typename = typename std::enable_if<std::is_integral<T>::value &&
+                                                                    !std::is_same<T, bool>::value>::type>
+            tree(T _val) noexcept : kind_(kind::Int) {
+                if (std::is_unsigned<T>::value && static_cast<uint64_t>(_val) > static_cast<uint64_t>(INT64_MAX)) {
+                    kind_ = kind::UInt;
+                    width_ = 8;
+                    uint_ = static_cast<uint64_t>(_val);
+                } else {
+                    int_ = static_cast<int64_t>(_val);
+                    width_ = int_width(int_);
+                }
+            }
 
-            template<typename ValueType, typename = enable_if_serializable_or_var_t<ValueType>>
-            tree(ValueType &&_val) :
-                    base(
-                            std::make_shared<typename serializable_trait<std::remove_reference_t<ValueType>>::type>(
-                                    std::forward<ValueType>(_val))
-                    ) {};
+            tree(const char *_val) : kind_(kind::Null) {
+                if (_val) assign_string(_val, std::strlen(_val));
+            }
+            tree(const bp::string_view &_val) : kind_(kind::Null) { assign_string(_val.data(), _val.size()); }
 
-            template<typename ValueType, typename = enable_if_variant_type_t<ValueType>>
-            tree(std::shared_ptr<ValueType> _val) : base(_val) {}
+            /**
+             * Create string node. Long string is placed into arena if specified
+             */
+            tree(const bp::string_view &_val, bp::arena *_arena) : kind_(kind::Null) {
+                assign_string(_val.data(), _val.size(), _arena);
+            }
 
-            inline array_ptr as_array() const {
-                return bp::get<array_ptr>(*this);
+            template<typename T, typename = typename std::enable_if<std::is_same<typename std::decay<T>::type, std::string>::value>::type>
+            tree(const T &_val) : kind_(kind::Null) {
+                assign_string(_val.data(), _val.size());
             }
 
-            inline object_ptr as_object() const {
-                return bp::get<object_ptr>(*this);
+            tree(const value &_val);
+
+            tree(const object &_val) : kind_(kind::Object) {
+                new(&object_) object_ptr(bp::make_intrusive<object>(_val.get_allocator().get_arena(), _val));
+            }
+            tree(object &&_val) : kind_(kind::Object) {
+                new(&object_) object_ptr(bp::make_intrusive<object>(_val.get_allocator().get_arena(), std::move(_val)));
+            }
+            tree(const array &_val) : kind_(kind::Array) {
+                new(&array_) array_ptr(bp::make_intrusive<array>(_val.get_allocator().get_arena(), _val));
+            }
+            tree(array &&_val) : kind_(kind::Array) {
+                new(&array_) array_ptr(bp::make_intrusive<array>(_val.get_allocator().get_arena(), std::move(_val)));
+            }
+
+            /**
+             * Create string node sharing string. Strings from string_pool become interned
+             */
+            tree(string_ptr _val) noexcept : kind_(kind::Null) {
+                if (_val) {
+                    kind_ = _val->pool_id() ? kind::Interned : kind::String;
+                    new(&string_) string_ptr(std::move(_val));
+                }
+            }
+
+            /**
+             * Create string node referring to characters without copying them. Characters must outlive node
+             * and all its copies
+             */
+            tree(const borrowed_string &_val) noexcept : kind_(kind::StringView) {
+                view_ = view_ref{_val.str.data(), _val.str.size()};
+            }
+
+            tree(object_ptr _val) noexcept : kind_(_val ? kind::Object : kind::Null) {
+                if (_val) new(&object_) object_ptr(std::move(_val));
+            }
+            tree(array_ptr _val) noexcept : kind_(_val ? kind::Array : kind::Null) {
+                if (_val) new(&array_) array_ptr(std::move(_val));
+            }
+
+            /**
+             * Create raw container node
+             * @param _source source container is parsed from
+             * @param _index container index in source
+             * @param _kind container kind, Object or Array
+             */
+            tree(raw_ptr _source, uint32_t _index, kind _kind) noexcept : kind_(kind::Raw),
+                                                                          width_(static_cast<uint8_t>(_kind)) {
+                new(&raw_) raw_ref{std::move(_source), _index};
+            }
+
+            tree(const tree &_t) : kind_(kind::Null) { copy_from(_t); }
+            tree(tree &&_t) noexcept : kind_(kind::Null) { move_from(std::move(_t)); }
+
+            tree &operator=(const tree &_t) {
+                if (this != &_t) {
+                    tree tmp(_t);
+                    reset();
+                    move_from(std::move(tmp));
+                }
+                return *this;
+            }
+
+            tree &operator=(tree &&_t) noexcept {
+                if (this != &_t) {
+                    // source may be owned by this node (e.g. assigning a child to its parent)
+                    tree tmp(std::move(_t));
+                    reset();
+                    move_from(std::move(tmp));
+                }
+                return *this;
+            }
+
+            ~tree() { reset(); }
+
+            /**
+             * Get node payload kind. Raw containers report their kind without being materialized
+             * @return payload kind
+             */
+            inline kind get_kind() const { return kind_ == kind::Raw ? static_cast<kind>(width_) : kind_; }
+
+            /**
+             * Check whether node is container not materialized from its source yet
+             * @return true if node is raw
+             */
+            inline bool is_raw() const { return kind_ == kind::Raw; }
+
+            /**
+             * Get source text of raw container
+             * @return container text or empty string if node is not raw
+             */
+            inline bp::string_view raw_text() const {
+                return kind_ == kind::Raw ? raw_.source->text(raw_.index) : bp::string_view();
+            }
+
+            /**
+             * Get id of serializer raw container is written in
+             * @return serializer type hash or 0 if node is not raw
+             */
+            inline bp::hash_type raw_format() const {
+                return kind_ == kind::Raw ? raw_.source->format() : bp::hash_type(0);
+            }
+
+            inline bool is_string() const {
+                return kind_ == kind::ShortString || kind_ == kind::String || kind_ == kind::Interned ||
+                       kind_ == kind::StringView;
+            }
+
+            inline bool is_integer() const { return kind_ == kind::Int || kind_ == kind::UInt; }
+
+            /**
+             * Get minimal byte width of numeric value encoding. Integers take 1, 2, 4 or 8 bytes,
+             * floating point numbers 4 if exactly representable as float or 8 otherwise. Width is a hint
+             * for binary encoders only, it does not tell whether value originated as float
+             * @return byte width or 0 if node is not a number
+             */
+            inline uint8_t num_width() const {
+                return kind_ == kind::Int || kind_ == kind::UInt || kind_ == kind::Float ? width_ : 0;
+            }
+
+            inline const array_ptr &as_array() const {
+                if (kind_ == kind::Raw) resolve();
+                return kind_ == kind::Array ? array_ : null_array();
+            }
+
+            inline const object_ptr &as_object() const {
+                if (kind_ == kind::Raw) resolve();
+                return kind_ == kind::Object ? object_ : null_object();
+            }
+
+            /**
+             * Get pointer to string characters. Not null-terminated for short strings
+             * @return string data or nullptr if node is not a string
+             */
+            inline const char *str_data() const {
+                switch (kind_) {
+                    case kind::ShortString:
+                        return short_;
+                    case kind::String:
+                    case kind::Interned:
+                        return string_->data();
+                    case kind::StringView:
+                        return view_.data;
+                    default:
+                        return nullptr;
+                }
             }
 
-            inline value_ptr as_value() const {
-                return bp::get<value_ptr>(*this);
+            /**
+             * Get string length
+             * @return string length or 0 if node is not a string
+             */
+            inline size_t str_size() const {
+                switch (kind_) {
+                    case kind::ShortString:
+                        return width_;
+                    case kind::String:
+                    case kind::Interned:
+                        return string_->size();
+                    case kind::StringView:
+                        return view_.size;
+                    default:
+                        return 0;
+                }
             }
 
             template<typename T>
             T as() const {
-                if (bp::holds_alternative<value_ptr>(*this)) {
-                    return bp::get<T>(*this->as_value());
+                return T();
+            }
+
+            bool operator==(const tree &_t) const;
+            inline bool operator!=(const tree &_t) const { return !operator==(_t); }
+
+            /**
+             * Check whether node container is shared with a copy-on-write copy
+             * @return true if container must be detached before modification
+             */
+            inline bool is_shared() const { return (flags_ & flag_shared) != 0; }
+
+            /**
+             * Make node container exclusive before modification. Only one level is copied,
+             * children of detached container become shared in turn
+             * @param _arena arena to allocate copied container and child nodes from
+             */
+            inline void detach(bp::arena *_arena) {
+                if (flags_ & flag_shared) detach_slow(_arena);
+            }
+
+            /**
+             * Create copy-on-write copy of node. Container is shared by both nodes
+             * until one of them is detached, so both are marked shared
+             * @param _node node to copy
+             * @param _arena arena to allocate copy from
+             * @return node copy
+             */
+            static tree_ptr share(const tree_ptr &_node, bp::arena *_arena);
+
+            /**
+             * Create copy-on-write copy of subtree. Levels holding nodes that are reachable from outside
+             * of the subtree (aliased by structures or sharing containers by assignment) are copied,
+             * everything else is shared
+             * @param _node subtree root
+             * @param _arena arena to allocate copies from
+             * @return subtree copy
+             */
+            static tree_ptr share_tree(const tree_ptr &_node, bp::arena *_arena);
+
+        private:
+            /**
+             * Container is shared with copy-on-write copies
+             */
+            static constexpr uint8_t flag_shared = 1;
+
+            static const object_ptr &null_object();
+            static const array_ptr &null_array();
+
+            void detach_slow(bp::arena *_arena);
+
+            /**
+             * Copy levels of subtree that are reachable from outside of it
+             * @return copy or nullptr if subtree may be shared as a whole
+             */
+            static tree_ptr copy_exposed(const tree_ptr &_node, bp::arena *_arena);
+
+            /**
+             * Replace raw container with materialized one. Node identity is kept, so all aliases see the result
+             */
+            void resolve() const;
+
+            struct raw_ref {
+                raw_ptr source;
+                uint32_t index;
+            };
+
+            struct view_ref {
+                const char *data;
+                size_t size;
+            };
+
+            inline void assign_string(const char *_data, size_t _size, bp::arena *_arena = nullptr) {
+                if (_size <= short_string_capacity) {
+                    kind_ = kind::ShortString;
+                    width_ = static_cast<uint8_t>(_size);
+                    std::memcpy(short_, _data, _size);
                 } else {
-                    return T();
+                    auto s = make_string(_data, _size, _arena);
+                    // node stays null if string could not be allocated
+                    if (s) {
+                        kind_ = kind::String;
+                        new(&string_) string_ptr(std::move(s));
+                    }
+                }
+            }
+
+            inline void reset() noexcept {
+                switch (kind_) {
+                    case kind::String:
+                    case kind::Interned:
+                        string_.~string_ptr();
+                        break;
+                    case kind::Object:
+                        object_.~object_ptr();
+                        break;
+                    case kind::Array:
+                        array_.~array_ptr();
+                        break;
+                    case kind::Raw:
+                        raw_.~raw_ref();
+                        break;
+                    default:
+                        break;
+                }
+                kind_ = kind::Null;
+                if (flags_) flags_ = 0;
+            }
+
+            inline void copy_scalar(const tree &_t) noexcept {
+                switch (_t.kind_) {
+                    case kind::Null:
+                        break;
+                    case kind::Bool:
+                        bool_ = _t.bool_;
+                        break;
+                    case kind::ShortString:
+                        std::memcpy(short_, _t.short_, short_string_capacity);
+                        break;
+                    case kind::StringView:
+                        view_.data = _t.view_.data;
+                        view_.size = _t.view_.size;
+                        break;
+                    default:
+                        uint_ = _t.uint_;
+                        break;
+                }
+                width_ = _t.width_;
+            }
+
+            inline void copy_from(const tree &_t) {
+                switch (_t.kind_) {
+                    case kind::String:
+                    case kind::Interned:
+                        new(&string_) string_ptr(_t.string_);
+                        break;
+                    case kind::Object:
+                        new(&object_) object_ptr(_t.object_);
+                        break;
+                    case kind::Array:
+                        new(&array_) array_ptr(_t.array_);
+                        break;
+                    case kind::Raw:
+                        new(&raw_) raw_ref(_t.raw_);
+                        width_ = _t.width_;
+                        break;
+                    default:
+                        copy_scalar(_t);
+                        break;
+                }
+                kind_ = _t.kind_;
+                flags_ = static_cast<uint8_t>(_t.flags_);
+            }
+
+            inline void move_from(tree &&_t) noexcept {
+                switch (_t.kind_) {
+                    case kind::String:
+                    case kind::Interned:
+                        new(&string_) string_ptr(std::move(_t.string_));
+                        break;
+                    case kind::Object:
+                        new(&object_) object_ptr(std::move(_t.object_));
+                        break;
+                    case kind::Array:
+                        new(&array_) array_ptr(std::move(_t.array_));
+                        break;
+                    case kind::Raw:
+                        new(&raw_) raw_ref(std::move(_t.raw_));
+                        width_ = _t.width_;
+                        break;
+                    default:
+                        copy_scalar(_t);
+                        break;
                 }
+                kind_ = _t.kind_;
+                flags_ = static_cast<uint8_t>(_t.flags_);
+                _t.reset();
             }
+
+            union {
+                bool bool_;
+                int64_t int_;
+                uint64_t uint_;
+                double double_;
+                char short_[short_string_capacity];
+                string_ptr string_;
+                object_ptr object_;
+                array_ptr array_;
+                raw_ref raw_;
+                view_ref view_;
+            };
+            kind kind_;
+            // short string length or byte width of numeric value
+            uint8_t width_ = 0;
+#ifdef BP_SINGLE_THREADED
+            uint8_t flags_ = 0;
+#else
+            // const deepcopy() marks source nodes, which may be read by other threads meanwhile
+            std::atomic<uint8_t> flags_{0};
+#endif
+            bp::ref_count refs_;
+
+        public:
+            inline const bp::ref_count &refs() const { return refs_; }
         };
+
+        template<>
+        inline int tree::as<int>() const {
+            return kind_ == kind::Int ? static_cast<int>(int_) : kind_ == kind::UInt ? static_cast<int>(uint_) : 0;
+        }
+
+        template<>
+        inline int64_t tree::as<int64_t>() const {
+            return kind_ == kind::Int ? int_ : kind_ == kind::UInt ? static_cast<int64_t>(uint_) : 0;
+        }
+
+        template<>
+        inline uint64_t tree::as<uint64_t>() const {
+            return kind_ == kind::Int ? static_cast<uint64_t>(int_) : kind_ == kind::UInt ? uint_ : 0;
+        }
+
+        template<>
+        inline float tree::as<float>() const {
+            return kind_ == kind::Float ? static_cast<float>(double_) : 0.0f;
+        }
+
+        template<>
+        inline double tree::as<double>() const {
+            return kind_ == kind::Float ? double_ : 0.0;
+        }
+
+        template<>
+        inline bool tree::as<bool>() const {
+            return kind_ == kind::Bool && bool_;
+        }
+
+        template<>
+        inline std::string tree::as<std::string>() const {
+            return is_string() ? std::string(str_data(), str_size()) : std::string();
+        }
+
+        /**
+         * Create tree node in arena or on heap
+         * @param _arena arena to allocate node from or nullptr for heap
+         * @param _args node constructor arguments
+         * @return node pointer
+         */
+        template<typename ...Args>
+        inline tree_ptr make_tree(bp::arena *_arena, Args &&..._args) {
+            return bp::make_intrusive<tree>(_arena, std::forward<Args>(_args)...);
+        }
+
+        inline object_ptr make_object(bp::arena *_arena = nullptr) {
+            return bp::make_intrusive<object>(_arena, allocator<object::value_type>(_arena));
+        }
+
+        inline array_ptr make_array(bp::arena *_arena = nullptr) {
+            return bp::make_intrusive<array>(_arena, allocator<tree_ptr>(_arena));
+        }
     }
 
     namespace {
@@ -150,7 +786,20 @@ namespace bp {
 
     struct value_type_visitor;
 
+    namespace serializers {
+        class ndjson_reader;
+        class json_push_parser;
+        class json_in_situ_parser;
+        class dcm_push_parser;
+    }
+
     class structure {
+        friend class persistent_structure;
+        friend class structure_view;
+        friend class serializers::ndjson_reader;
+        friend class serializers::json_push_parser;
+        friend class serializers::json_in_situ_parser;
+        friend class serializers::dcm_push_parser;
     public:
 
 //        friend class structure;
@@ -200,7 +849,7 @@ namespace bp {
         // CONSTRUCTORS
 
     private:
-        structure(serializable::tree_ptr _obj);
+        structure(serializable::tree_ptr _obj, bp::arena *_arena = nullptr);
 
     public:
         /**
@@ -209,13 +858,27 @@ namespace bp {
          */
         structure(value_type _t);
 
+        /**
+         * Create null structure bound to arena. All nodes created under this structure
+         * are allocated from the arena, which must outlive the structure and all its aliases
+         * @param _arena arena to allocate nodes from
+         */
+        explicit structure(bp::arena &_arena);
+
+        /**
+         * Create structure bound to arena with root of specified type
+         * @param _t type of structure root element
+         * @param _arena arena to allocate nodes from
+         */
+        structure(value_type _t, bp::arena &_arena);
+
         /**
          * Create structure from primitive type
          * @param _val primitive value
          */
         template<typename T, typename = serializable::enable_if_serializable_t<T>>
         structure(T &&_val) : value_type_(value_type_visitor()(_val)),
-                              val_(std::make_shared<serializable::tree>(std::forward<T>(_val))) {}
+                              val_(serializable::make_tree(nullptr, std::forward<T>(_val))) {}
 
         /**
          * Create null structure
@@ -293,13 +956,14 @@ namespace bp {
         template<typename ValType,
                  typename = enable_if_convertible_t<ValType, serializable::tree>>
         structure &operator=(ValType &&_val) {
-            *val_ = serializable::tree(std::forward<ValType>(_val));
-            value_type_ = get_variant_type(_val);
+            assign(std::forward<ValType>(_val), is_string_value<ValType>());
+            value_type_ = get_variant_type(*val_);
             return *this;
         }
 
         /**
-         * Recursively check if structures are matching
+         * Recursively check if structures are matching. Containers match if they have the same size and
+         * matching items, so empty objects or arrays are equal to each other
          * @param _s structure to match
          * @return true if stuctures are equivalent
          */
@@ -338,6 +1002,20 @@ namespace bp {
          */
         structure at(int _key) const ENABLE_IF_HAS_EXCEPTIONS(throw (type_error, std::out_of_range));
 
+        /**
+         * Access object item for modification. Detaches structure shared with deepcopy() result
+         * @param _key object key to be accessed
+         * @return object item or null-typed structure in exceptionless mode
+         */
+        structure at(const bp::hash_type &_key) ENABLE_IF_HAS_EXCEPTIONS(throw (type_error, std::out_of_range));
+
+        /**
+         * Access array item for modification. Detaches structure shared with deepcopy() result
+         * @param _key array index
+         * @return array item or null-typed structure in exceptionless mode
+         */
+        structure at(int _key) ENABLE_IF_HAS_EXCEPTIONS(throw (type_error, std::out_of_range));
+
         /**
          * Get primitive value
          * @tparam ValueType serializable primitive value
@@ -365,12 +1043,55 @@ namespace bp {
 
         /**
          * Append value to array-typed structure. Throws type_error for other types.
+         * Appended structure is aliased unless this structure is bound to another arena,
+         * in this case the value is copied into this structure arena.
          * @param _val serializable value
          * @return true if inserted or false in case of failure in exceptionless mode
          */
          // TODO: use universal refs
         bool append(const bp::structure &_val);
 
+        /**
+         * Append range of serializable values to array-typed structure. Null structure is turned into array,
+         * throws type_error for other types. Array is grown once for forward ranges
+         * @param _first range begin
+         * @param _last range end
+         * @return true if appended or false in case of failure in exceptionless mode
+         */
+        template<typename InputIt, typename = serializable::enable_if_serializable_t<
+                typename std::iterator_traits<InputIt>::value_type>>
+        bool append(InputIt _first, InputIt _last) ENABLE_IF_HAS_EXCEPTIONS(throw (type_error)) {
+            if (!append_init()) {
+#ifdef HAS_EXCEPTIONS
+                throw type_error("not an array");
+#endif
+                return false;
+            }
+            auto &arr = *val_->as_array();
+            reserve_range(arr, _first, _last, typename std::iterator_traits<InputIt>::iterator_category());
+            for (; _first != _last; ++_first) {
+                arr.push_back(make_item(arena_, *_first));
+            }
+            return true;
+        }
+
+        /**
+         * Append all values of vector to array-typed structure
+         * @param _items values to append
+         * @return true if appended or false in case of failure in exceptionless mode
+         */
+        template<typename T, typename Alloc, typename = serializable::enable_if_serializable_t<T>>
+        inline bool append(const std::vector<T, Alloc> &_items) ENABLE_IF_HAS_EXCEPTIONS(throw (type_error)) {
+            return append(_items.begin(), _items.end());
+        }
+
+        /**
+         * Reserve space for array items or object keys. Throws type_error for other types
+         * @param _n expected number of items
+         * @return true if reserved or false in case of failure in exceptionless mode
+         */
+        bool reserve(size_t _n) ENABLE_IF_HAS_EXCEPTIONS(throw (type_error));
+
         /**
          * Clear array
          * @return true in success case
@@ -386,9 +1107,78 @@ namespace bp {
     private:
         inline bool emplace_init() {
             initialize_if_null(value_type::Object);
+            detach();
             return is_object();
         }
 
+        inline bool append_init() {
+            initialize_if_null(value_type::Array);
+            detach();
+            return is_array();
+        }
+
+        template<typename InputIt>
+        static void reserve_range(serializable::array &, InputIt, InputIt, std::input_iterator_tag) {}
+
+        template<typename ForwardIt>
+        static void reserve_range(serializable::array &_arr, ForwardIt _first, ForwardIt _last,
+                                  std::forward_iterator_tag) {
+            _arr.reserve(_arr.size() + static_cast<size_t>(std::distance(_first, _last)));
+        }
+
+        template<typename T>
+        using is_string_value = bp::is_any_of<typename std::decay<T>::type, std::string, const char *, char *, bp::string_view>;
+
+        template<typename T>
+        inline void assign(T &&_val, std::false_type) { *val_ = serializable::tree(std::forward<T>(_val)); }
+
+        /**
+         * Set string value. String is interned in string pool if set, otherwise long string is placed into arena
+         */
+        void assign(const bp::string_view &_val, std::true_type);
+
+        inline void assign(const std::string &_val, std::true_type) { assign(bp::string_view(_val), std::true_type()); }
+
+        inline void assign(const char *_val, std::true_type) {
+            if (_val) {
+                assign(bp::string_view(_val), std::true_type());
+            } else {
+                *val_ = serializable::tree(nullptr);
+            }
+        }
+
+        /**
+         * Create node for value. Long strings are placed into arena as well
+         */
+        template<typename T>
+        static inline serializable::tree_ptr make_item(bp::arena *_arena, const T &_val) {
+            return serializable::make_tree(_arena, _val);
+        }
+
+        static inline serializable::tree_ptr make_item(bp::arena *_arena, const std::string &_val) {
+            return serializable::make_tree(_arena, bp::string_view(_val), _arena);
+        }
+
+        static inline serializable::tree_ptr make_item(bp::arena *_arena, const char *_val) {
+            return _val ? serializable::make_tree(_arena, bp::string_view(_val), _arena) :
+                   serializable::make_tree(_arena, nullptr);
+        }
+
+        /**
+         * Copy shared container of this node before modification
+         */
+        inline void detach() const {
+            val_->detach(arena_);
+        }
+
+        /**
+         * Wrap item of this structure. Items of shared container are handed out as copies,
+         * so writes through them reach neither this structure nor its copies
+         */
+        inline structure item(const serializable::tree_ptr &_node) const {
+            return structure(val_->is_shared() ? serializable::tree::share(_node, arena_) : _node, arena_);
+        }
+
         template<typename ValType,
                  typename = typename std::enable_if<std::is_same<serializable::plain_type_t<ValType>, serializable::tree>::value>::type
         >
@@ -401,7 +1191,7 @@ namespace bp {
         >
         bool emplace_resolve(const bp::hash_type &_key, const ValType &_var) {
             return val_->as_object()->
-                    emplace(_key, std::make_shared<serializable::tree>(_var)).second;
+                    emplace(_key, serializable::make_tree(arena_, _var)).second;
         }
 
         value_type get_variant_type(const serializable::tree &_var) const;
@@ -449,26 +1239,6 @@ namespace bp {
         inline ValueType as() const {
             return ValueType();
         };
-    private:
-        /**
-         * Cast structure
-         * @tparam ValueType
-         * @return
-         */
-        template<typename T,
-                typename = typename std::enable_if<std::is_convertible<T, int>::value>::type>
-        inline T as_int() const {
-            switch (type()) {
-                case value_type::Int:
-                    return static_cast<T>(val_->as<int>());
-                case value_type::Float:
-                    return static_cast<T>(val_->as<float>());
-                case value_type::Bool:
-                    return static_cast<T>(val_->as<bool>());
-                default:
-                    return 0;
-            }
-        };
     public:
 
         /**
@@ -510,6 +1280,14 @@ namespace bp {
         //[[ deprecated("use is<> instead") ]]
         inline bool is_string() const { return value_type_ == value_type::String; }
 
+        /**
+         * Get string without copying
+         * @return string view or empty view if structure is not a string
+         */
+        inline bp::string_view str_view() const {
+            return val_ ? bp::string_view(val_->str_data(), val_->str_size()) : bp::string_view();
+        }
+
         /**
          * Check if structure is null
          * @return true if structure is null
@@ -537,7 +1315,10 @@ namespace bp {
         // MISC
 
         /**
-         * Clone structure recursively
+         * Clone structure recursively. Containers are copied lazily: clone shares them with
+         * this structure until one of structures is modified, then only modified level is copied.
+         * Levels holding items aliased by other structures are copied right away. Const access to
+         * shared structure returns copies of items
          * @return cloned structure
          */
         structure deepcopy() const;
@@ -582,6 +1363,39 @@ namespace bp {
          */
         bool empty() const;
 
+        /**
+         * Get arena structure nodes are allocated from
+         * @return arena or nullptr if structure uses heap
+         */
+        inline bp::arena *get_arena() const { return arena_; }
+
+        /**
+         * Set pool parsers and assignments intern string values in. Items taken by subscript use pool as well.
+         * Pool must outlive interned values
+         * @param _pool string pool or nullptr to disable interning
+         */
+        inline void set_string_pool(bp::string_pool *_pool) { pool_ = _pool; }
+
+        /**
+         * Get pool string values are interned in
+         * @return string pool or nullptr
+         */
+        inline bp::string_pool *get_string_pool() const { return pool_; }
+
+        /**
+         * Make parsers store string values as references into parsed buffer instead of copying them.
+         * Strings needing decoding and strings fitting into node are still copied. Buffer must outlive
+         * structure and all its copies
+         * @param _enable true to enable zero-copy strings
+         */
+        inline void set_zero_copy(bool _enable) { zero_copy_ = _enable; }
+
+        /**
+         * Check whether parsers store string values as references into parsed buffer
+         * @return true if zero-copy strings are enabled
+         */
+        inline bool get_zero_copy() const { return zero_copy_; }
+
 
     public:
 
@@ -614,6 +1428,99 @@ namespace bp {
             return s;
         };
 
+        /**
+         * Parse string into new structure bound to arena
+         * @tparam serializer_type hash of serializer type name
+         * @param _s string to parse
+         * @param _arena arena to allocate nodes from
+         * @return created structure if successfully parsed.
+         * Throws parse_error in case of failure or return null-typed structure in exceptionless mode
+         */
+        template<bp::hash_type::type serializer_type>
+        static structure create_from_string(const bp::string_view &_s, bp::arena &_arena) {
+            structure s(_arena);
+            s.parse<serializer_type>(_s);
+            return s;
+        };
+
+        /**
+         * Parse string into new structure interning string values
+         * @tparam serializer_type hash of serializer type name
+         * @param _s string to parse
+         * @param _pool pool to intern string values in
+         * @return created structure if successfully parsed.
+         * Throws parse_error in case of failure or return null-typed structure in exceptionless mode
+         */
+        template<bp::hash_type::type serializer_type>
+        static structure create_from_string(const bp::string_view &_s, bp::string_pool &_pool) {
+            structure s;
+            s.set_string_pool(&_pool);
+            s.parse<serializer_type>(_s);
+            return s;
+        };
+
+        /**
+         * Parse buffer into new structure with string values referring into buffer, see set_zero_copy()
+         * @tparam serializer_type hash of serializer type name
+         * @param _s buffer to parse, must outlive structure and all its copies
+         * @param _arena arena to allocate nodes from or nullptr for heap
+         * @return created structure if successfully parsed.
+         * Throws parse_error in case of failure or return null-typed structure in exceptionless mode
+         */
+        template<bp::hash_type::type serializer_type>
+        static structure create_in_situ(const bp::string_view &_s, bp::arena *_arena = nullptr) {
+            structure s;
+            s.arena_ = _arena;
+            s.set_zero_copy(true);
+            s.parse<serializer_type>(_s);
+            return s;
+        };
+
+        /**
+         * Builder of object-typed structure from pre-hashed keys. Object storage is allocated once
+         * for expected number of keys, keys are inserted as is without hashing their names
+         */
+        class object_builder {
+        public:
+            /**
+             * Create builder
+             * @param _size expected number of keys
+             * @param _arena arena to allocate nodes from or nullptr for heap
+             */
+            explicit object_builder(size_t _size, bp::arena *_arena = nullptr);
+
+            /**
+             * Set object item
+             * @param _key pre-hashed key
+             * @param _val serializable value
+             * @return this builder
+             */
+            template<typename T, typename = serializable::enable_if_serializable_t<T>>
+            inline object_builder &add(const bp::hash_type &_key, const T &_val) {
+                return add_node(_key, make_item(arena_, _val));
+            }
+
+            /**
+             * Set object item. Structure is aliased unless it is bound to another arena
+             * @param _key pre-hashed key
+             * @param _val structure to set
+             * @return this builder
+             */
+            object_builder &add(const bp::hash_type &_key, const structure &_val);
+
+            /**
+             * Create structure from added items. Builder is left empty
+             * @return object-typed structure
+             */
+            structure build();
+
+        private:
+            object_builder &add_node(const bp::hash_type &_key, serializable::tree_ptr &&_node);
+
+            serializable::object_ptr obj_;
+            bp::arena *arena_;
+        };
+
         // ITERATORS
 
         /**
@@ -760,29 +1667,42 @@ namespace bp {
          * Get object items iterator (forward iterator)
          * @return
          */
-        iterable<object_iterator> as_object() { return this->get_iterable<object_iterator>(); }
+        iterable<object_iterator> as_object() {
+            detach();
+            return this->get_iterable<object_iterator>();
+        }
 
         /**
          * Get object items const iterator (forward iterator)
          * @return
          */
-        const iterable<object_iterator> as_object() const { return const_cast<structure *>(this)->as_object(); }
+        const iterable<object_iterator> as_object() const {
+            return const_cast<structure *>(this)->get_iterable<object_iterator>();
+        }
 
         /**
          * Get array items iterator (random access iterator)
          * @return
          */
-        iterable<array_iterator> as_array() { return this->get_iterable<array_iterator>(); }
+        iterable<array_iterator> as_array() {
+            detach();
+            return this->get_iterable<array_iterator>();
+        }
 
         /**
          * Get array items const iterator (random access iterator)
          * @return
          */
-        const iterable<array_iterator> as_array() const { return const_cast<structure *>(this)->as_array(); }
+        const iterable<array_iterator> as_array() const {
+            return const_cast<structure *>(this)->get_iterable<array_iterator>();
+        }
 
     private:
         value_type value_type_ = value_type::Null;
         serializable::tree_ptr val_;
+        bp::arena *arena_ = nullptr;
+        bp::string_pool *pool_ = nullptr;
+        bool zero_copy_ = false;
     };
 }
 namespace bp {
@@ -802,6 +1722,10 @@ namespace bp {
     int8_t structure::as<int8_t>() const;
     template<>
     uint8_t structure::as<uint8_t>() const;
+    template<>
+    int64_t structure::as<int64_t>() const;
+    template<>
+    uint64_t structure::as<uint64_t>() const;
 
     //TODO: check portability
 #if defined(SPARK) || defined(_INT32_T_DECLARED)
@@ -812,6 +1736,9 @@ namespace bp {
     template<>
     float structure::as<float>() const;
 
+    template<>
+    double structure::as<double>() const;
+
     template<>
     bool structure::as<bool>() const;
 
@@ -821,12 +1748,15 @@ namespace bp {
 
         bp::structure::value_type operator()(nullptr_t) const { return bp::structure::value_type::Null; }
 
-        template <typename T, typename = typename std::enable_if<std::is_convertible<T, int>::value>::type>
+        template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
         bp::structure::value_type operator()(T) const { return bp::structure::value_type::Int; }
 
         bp::structure::value_type
         operator()(float) const { return bp::structure::value_type::Float; }
 
+        bp::structure::value_type
+        operator()(double) const { return bp::structure::value_type::Float; }
+
         bp::structure::value_type operator()(bool) const { return bp::structure::value_type::Bool; }
 
         bp::structure::value_type
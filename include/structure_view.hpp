@@ -0,0 +1,543 @@
+#ifndef BP_STRUCTURE_VIEW_HPP
+#define BP_STRUCTURE_VIEW_HPP
+
+#include <algorithm>
+#include <vector>
+#include "numbers.hpp"
+#include "structure.hpp"
+
+namespace bp {
+
+    /**
+     * Borrowed read-only reference into structure tree. Unlike structure, view and its
+     * child views hold plain node pointers, so reads never touch reference counts.
+     * View is valid while viewed structure is alive and not modified
+     */
+    class structure_view {
+    public:
+        using value_type = structure::value_type;
+
+        /**
+         * Create null view
+         */
+        structure_view() : node_(&null_node()) {}
+
+        /**
+         * View structure
+         * @param _s structure to view
+         */
+        structure_view(const structure &_s) : node_(_s.val_ ? _s.val_.get() : &null_node()) {}
+
+        /**
+         * View tree node
+         * @param _node node to view
+         */
+        explicit structure_view(const serializable::tree &_node) : node_(&_node) {}
+
+        // TYPES
+
+        inline value_type type() const {
+            switch (node_->get_kind()) {
+                case serializable::tree::kind::Bool:
+                    return value_type::Bool;
+                case serializable::tree::kind::Int:
+                case serializable::tree::kind::UInt:
+                    return value_type::Int;
+                case serializable::tree::kind::Float:
+                    return value_type::Float;
+                case serializable::tree::kind::ShortString:
+                case serializable::tree::kind::String:
+                case serializable::tree::kind::Interned:
+                case serializable::tree::kind::StringView:
+                    return value_type::String;
+                case serializable::tree::kind::Object:
+                    return value_type::Object;
+                case serializable::tree::kind::Array:
+                    return value_type::Array;
+                default:
+                    return value_type::Null;
+            }
+        }
+
+        template<typename ValueType,
+                typename = typename std::enable_if<serializable::is_serializable<ValueType>::value>::type>
+        inline bool is() const {
+            return type() == value_type_visitor()(ValueType());
+        };
+
+        inline bool is_int() const { return node_->is_integer(); }
+
+        inline bool is_float() const { return node_->get_kind() == serializable::tree::kind::Float; }
+
+        /**
+         * Check whether integer is above int64_t range and is kept in unsigned lane
+         */
+        inline bool is_uint64() const { return node_->get_kind() == serializable::tree::kind::UInt; }
+
+        /**
+         * Get minimal byte width of numeric value encoding. Width is a hint for binary encoders, text
+         * output always prints floating point numbers with double precision
+         * @return 1, 2, 4 or 8 for integers, 4 or 8 for floating point numbers, 0 for other types
+         */
+        inline uint8_t num_width() const { return node_->num_width(); }
+
+        inline bool is_bool() const { return node_->get_kind() == serializable::tree::kind::Bool; }
+
+        inline bool is_string() const { return node_->is_string(); }
+
+        inline bool is_null() const { return node_->get_kind() == serializable::tree::kind::Null; }
+
+        inline bool is_array() const { return node_->get_kind() == serializable::tree::kind::Array; }
+
+        inline bool is_object() const { return node_->get_kind() == serializable::tree::kind::Object; }
+
+        /**
+         * Cast viewed value. Conversion rules are the same as for structure::as
+         * @tparam ValueType
+         * @return
+         */
+        template<typename ValueType,
+                typename = typename std::enable_if<serializable::is_serializable<ValueType>::value>::type>
+        inline ValueType as() const {
+            return ValueType();
+        };
+
+        /**
+         * Get pointer to string characters without copying
+         * @return string data or nullptr if value is not a string
+         */
+        inline const char *str_data() const { return node_->str_data(); }
+
+        /**
+         * Get string length
+         * @return string length or 0 if value is not a string
+         */
+        inline size_t str_size() const { return node_->str_size(); }
+
+        /**
+         * Get string without copying. Interned strings are viewed directly in string pool
+         * @return string view or empty view if value is not a string
+         */
+        inline bp::string_view str_view() const { return bp::string_view(node_->str_data(), node_->str_size()); }
+
+        /**
+         * Get source text of container not materialized since it was lazily parsed
+         * @param _format id of serializer text must be written in
+         * @return container text or empty view if container was accessed or comes from other format
+         */
+        inline bp::string_view raw(bp::hash_type _format) const {
+            return node_->raw_format() == _format ? node_->raw_text() : bp::string_view();
+        }
+
+        // ACCESS
+
+        /**
+         * Get number of items in object or array
+         * @return item count or 0 for primitive values
+         */
+        inline size_t size() const {
+            if (is_array()) return node_->as_array()->size();
+            if (is_object()) return node_->as_object()->size();
+            return 0;
+        }
+
+        inline bool empty() const { return size() == 0; }
+
+        inline bool has_key(const bp::hash_type &_key) const {
+            return is_object() && node_->as_object()->count(_key) > 0;
+        }
+
+        /**
+         * Access object item. Throws std::out_of_range if key not found and type_error
+         * for types other than object
+         * @param _key object key to be accessed
+         * @return item view or null view in exceptionless mode
+         */
+        structure_view at(const bp::hash_type &_key) const
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error, std::out_of_range)) {
+            if (!is_object()) {
+#ifdef HAS_EXCEPTIONS
+                throw structure::type_error("not an object");
+#endif
+                return structure_view();
+            }
+            const auto &obj = *node_->as_object();
+            auto it = obj.find(_key);
+            if (it == obj.end()) {
+#ifdef HAS_EXCEPTIONS
+                throw std::out_of_range("key not found");
+#endif
+                return structure_view();
+            }
+            return structure_view(*it->second);
+        }
+
+        /**
+         * Access array item. Negative index is counted from the end. Throws type_error
+         * for types other than array
+         * @param _index array index
+         * @return item view or null view in exceptionless mode
+         */
+        structure_view at(int _index) const ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error, std::out_of_range)) {
+            if (!is_array()) {
+#ifdef HAS_EXCEPTIONS
+                throw structure::type_error("not an array");
+#endif
+                return structure_view();
+            }
+            const auto &arr = *node_->as_array();
+            if (arr.empty()) {
+#ifdef HAS_EXCEPTIONS
+                throw std::out_of_range("array is empty");
+#endif
+                return structure_view();
+            }
+            auto size = static_cast<int>(arr.size());
+            return structure_view(*arr[static_cast<size_t>((_index % size + size) % size)]);
+        }
+
+        /**
+         * Get primitive value
+         * @tparam ValueType serializable primitive value
+         * @param _key object key to get
+         * @param _default value to be used if object has no such key
+         * @return object item value or default value
+         */
+        template<typename ValueType,
+                class = enable_if_convertible_t<ValueType, serializable::tree>>
+        ValueType get(const bp::hash_type &_key, ValueType &&_default = ValueType()) const {
+            if (is_object()) {
+                const auto &obj = *node_->as_object();
+                auto it = obj.find(_key);
+                return it != obj.end() ? structure_view(*it->second).as<ValueType>() : _default;
+            }
+#ifdef HAS_EXCEPTIONS
+            throw structure::type_error("not an object");
+#endif
+            return _default;
+        };
+
+        bool operator==(const structure_view &_v) const;
+
+        inline bool operator!=(const structure_view &_v) const { return !operator==(_v); }
+
+        // ITERATORS
+
+        class object_key_iterator : public std::iterator<std::forward_iterator_tag, bp::hash_type> {
+            serializable::object::const_iterator it_;
+        public:
+            object_key_iterator() = default;
+
+            explicit object_key_iterator(serializable::object::const_iterator _it) : it_(_it) {}
+
+            inline object_key_iterator &operator++() {
+                ++it_;
+                return *this;
+            }
+
+            inline object_key_iterator operator++(int) {
+                object_key_iterator tmp(*this);
+                ++it_;
+                return tmp;
+            }
+
+            inline const bp::hash_type &operator*() const { return it_->first; }
+
+            inline bool operator==(const object_key_iterator &_rhs) const { return it_ == _rhs.it_; }
+
+            inline bool operator!=(const object_key_iterator &_rhs) const { return it_ != _rhs.it_; }
+        };
+
+        class object_iterator : public std::iterator<std::forward_iterator_tag,
+                std::pair<bp::hash_type, structure_view>> {
+            serializable::object::const_iterator it_;
+        public:
+            object_iterator() = default;
+
+            explicit object_iterator(serializable::object::const_iterator _it) : it_(_it) {}
+
+            inline object_iterator &operator++() {
+                ++it_;
+                return *this;
+            }
+
+            inline object_iterator operator++(int) {
+                object_iterator tmp(*this);
+                ++it_;
+                return tmp;
+            }
+
+            inline std::pair<bp::hash_type, structure_view> operator*() const {
+                return std::make_pair(it_->first, structure_view(*it_->second));
+            }
+
+            inline bool operator==(const object_iterator &_rhs) const { return it_ == _rhs.it_; }
+
+            inline bool operator!=(const object_iterator &_rhs) const { return it_ != _rhs.it_; }
+        };
+
+        class array_iterator : public std::iterator<std::random_access_iterator_tag, structure_view> {
+            const serializable::tree_ptr *it_ = nullptr;
+        public:
+            array_iterator() = default;
+
+            explicit array_iterator(const serializable::tree_ptr *_it) : it_(_it) {}
+
+            inline array_iterator &operator++() {
+                ++it_;
+                return *this;
+            }
+
+            inline array_iterator operator++(int) {
+                array_iterator tmp(*this);
+                ++it_;
+                return tmp;
+            }
+
+            inline array_iterator &operator--() {
+                --it_;
+                return *this;
+            }
+
+            inline array_iterator &operator+=(std::ptrdiff_t _n) {
+                it_ += _n;
+                return *this;
+            }
+
+            inline array_iterator operator+(std::ptrdiff_t _n) const { return array_iterator(it_ + _n); }
+
+            inline std::ptrdiff_t operator-(const array_iterator &_rhs) const { return it_ - _rhs.it_; }
+
+            inline structure_view operator*() const { return structure_view(**it_); }
+
+            inline structure_view operator[](std::ptrdiff_t _n) const { return structure_view(*it_[_n]); }
+
+            inline bool operator==(const array_iterator &_rhs) const { return it_ == _rhs.it_; }
+
+            inline bool operator!=(const array_iterator &_rhs) const { return it_ != _rhs.it_; }
+
+            inline bool operator<(const array_iterator &_rhs) const { return it_ < _rhs.it_; }
+        };
+
+        template<typename iterator_type>
+        class iterable {
+            iterator_type begin_;
+            iterator_type end_;
+        public:
+            iterable(iterator_type _begin, iterator_type _end) : begin_(_begin), end_(_end) {}
+
+            iterator_type begin() const { return begin_; }
+
+            iterator_type end() const { return end_; }
+        };
+
+        /**
+         * Get object keys iterator. Empty range for types other than object
+         * @return
+         */
+        iterable<object_key_iterator> keys() const {
+            const auto &obj = is_object() ? *node_->as_object() : empty_object();
+            return iterable<object_key_iterator>(object_key_iterator(obj.begin()), object_key_iterator(obj.end()));
+        }
+
+        /**
+         * Get object items iterator. Empty range for types other than object
+         * @return
+         */
+        iterable<object_iterator> as_object() const {
+            const auto &obj = is_object() ? *node_->as_object() : empty_object();
+            return iterable<object_iterator>(object_iterator(obj.begin()), object_iterator(obj.end()));
+        }
+
+        /**
+         * Call function for every object item in ascending key order. Objects over inline capacity keep items
+         * in hash table order, which depends on growth and erasure history, so serializers use this to write
+         * equal objects as the same bytes. Does nothing for types other than object
+         * @param _f function taking key and item view
+         */
+        template<typename Func>
+        void for_each_sorted(Func &&_f) const {
+            if (!is_object()) return;
+            const auto &obj = *node_->as_object();
+            if (obj.is_inline()) {
+                for (const auto &item: obj) {
+                    _f(item.first, structure_view(*item.second));
+                }
+                return;
+            }
+            std::vector<const serializable::object::value_type *> items;
+            items.reserve(obj.size());
+            for (const auto &item: obj) {
+                items.push_back(&item);
+            }
+            std::sort(items.begin(), items.end(), [](const serializable::object::value_type *_a,
+                                                     const serializable::object::value_type *_b) {
+                return _a->first < _b->first;
+            });
+            for (auto item: items) {
+                _f(item->first, structure_view(*item->second));
+            }
+        }
+
+        /**
+         * Get array items iterator. Empty range for types other than array
+         * @return
+         */
+        iterable<array_iterator> as_array() const {
+            if (!is_array()) {
+                return iterable<array_iterator>(array_iterator(), array_iterator());
+            }
+            const auto &arr = *node_->as_array();
+            return iterable<array_iterator>(array_iterator(arr.data()), array_iterator(arr.data() + arr.size()));
+        }
+
+    private:
+        static const serializable::tree &null_node() {
+            static const serializable::tree node;
+            return node;
+        }
+
+        static const serializable::object &empty_object() {
+            static const serializable::object obj;
+            return obj;
+        }
+
+        template<typename T>
+        inline T as_int() const {
+            switch (node_->get_kind()) {
+                case serializable::tree::kind::Int:
+                    return static_cast<T>(node_->as<int64_t>());
+                case serializable::tree::kind::UInt:
+                    return static_cast<T>(node_->as<uint64_t>());
+                case serializable::tree::kind::Float:
+                    return static_cast<T>(node_->as<double>());
+                case serializable::tree::kind::Bool:
+                    return static_cast<T>(node_->as<bool>());
+                default:
+                    return 0;
+            }
+        }
+
+        const serializable::tree *node_;
+    };
+
+    template<>
+    inline std::string structure_view::as<std::string>() const {
+        switch (node_->get_kind()) {
+            case serializable::tree::kind::Int:
+                return bp::number_to_string(node_->as<int64_t>());
+            case serializable::tree::kind::UInt:
+                return bp::number_to_string(node_->as<uint64_t>());
+            case serializable::tree::kind::Float:
+                return bp::number_to_string(node_->as<double>());
+            case serializable::tree::kind::Bool:
+                return node_->as<bool>() ? "true" : "false";
+            case serializable::tree::kind::ShortString:
+            case serializable::tree::kind::String:
+            case serializable::tree::kind::Interned:
+            case serializable::tree::kind::StringView:
+                return node_->as<std::string>();
+            default:
+                return "";
+        }
+    }
+
+    template<>
+    inline int32_t structure_view::as<int32_t>() const { return as_int<int32_t>(); }
+
+    template<>
+    inline uint32_t structure_view::as<uint32_t>() const { return as_int<uint32_t>(); }
+
+    template<>
+    inline int16_t structure_view::as<int16_t>() const { return as_int<int16_t>(); }
+
+    template<>
+    inline uint16_t structure_view::as<uint16_t>() const { return as_int<uint16_t>(); }
+
+    template<>
+    inline int8_t structure_view::as<int8_t>() const { return as_int<int8_t>(); }
+
+    template<>
+    inline uint8_t structure_view::as<uint8_t>() const { return as_int<uint8_t>(); }
+
+    template<>
+    inline int64_t structure_view::as<int64_t>() const { return as_int<int64_t>(); }
+
+    template<>
+    inline uint64_t structure_view::as<uint64_t>() const { return as_int<uint64_t>(); }
+
+#if defined(SPARK) || defined(_INT32_T_DECLARED)
+    template<>
+    inline int structure_view::as<int>() const { return as_int<int>(); }
+#endif
+
+    template<>
+    inline double structure_view::as<double>() const {
+        switch (node_->get_kind()) {
+            case serializable::tree::kind::Int:
+                return static_cast<double>(node_->as<int64_t>());
+            case serializable::tree::kind::UInt:
+                return static_cast<double>(node_->as<uint64_t>());
+            case serializable::tree::kind::Float:
+                return node_->as<double>();
+            default:
+                return 0;
+        }
+    }
+
+    template<>
+    inline float structure_view::as<float>() const { return static_cast<float>(as<double>()); }
+
+    template<>
+    inline bool structure_view::as<bool>() const {
+        switch (node_->get_kind()) {
+            case serializable::tree::kind::Int:
+            case serializable::tree::kind::UInt:
+                return node_->as<uint64_t>() != 0;
+            case serializable::tree::kind::Bool:
+                return node_->as<bool>();
+            case serializable::tree::kind::ShortString:
+            case serializable::tree::kind::String:
+            case serializable::tree::kind::Interned:
+            case serializable::tree::kind::StringView: {
+                auto size = node_->str_size();
+                auto data = node_->str_data();
+                return !(size == 0 || (size == 1 && data[0] == '0') ||
+                         (size == 5 && std::memcmp(data, "false", 5) == 0));
+            }
+            default:
+                return false;
+        }
+    }
+
+    inline bool structure_view::operator==(const structure_view &_v) const {
+        if (node_ == _v.node_) return true;
+        if (type() != _v.type()) return false;
+        switch (type()) {
+            case value_type::Object: {
+                if (size() != _v.size()) return false;
+                const auto &other = *_v.node_->as_object();
+                for (const auto &item: *node_->as_object()) {
+                    auto it = other.find(item.first);
+                    if (it == other.end() || structure_view(*item.second) != structure_view(*it->second)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case value_type::Array: {
+                if (size() != _v.size()) return false;
+                const auto &a = *node_->as_array();
+                const auto &b = *_v.node_->as_array();
+                for (size_t i = 0; i < a.size(); ++i) {
+                    if (structure_view(*a[i]) != structure_view(*b[i])) return false;
+                }
+                return true;
+            }
+            default:
+                return *node_ == *_v.node_;
+        }
+    }
+}
+
+#endif //BP_STRUCTURE_VIEW_HPP
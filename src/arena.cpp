@@ -0,0 +1,52 @@
+#include <new>
+#include "arena.hpp"
+#include "node_pool.hpp"
+
+constexpr size_t bp::arena::default_block_size;
+
+bp::arena::arena(size_t _block_size) : block_size_(_block_size ? _block_size : default_block_size) {}
+
+bp::arena::~arena() {
+    while (head_) {
+        auto next = head_->next;
+        bp::node_deallocate(head_);
+        head_ = next;
+    }
+}
+
+void *bp::arena::allocate_slow(size_t _size, size_t _align) {
+    // oversized chunks get a dedicated block
+    size_t size = sizeof(block) + _size + _align;
+    if (size < block_size_) {
+        size = block_size_;
+    }
+    auto b = static_cast<block *>(bp::node_allocate(size));
+    if (!b) {
+        return nullptr;
+    }
+    b->size = size;
+    b->next = head_;
+    head_ = b;
+    capacity_ += size;
+    cur_ = reinterpret_cast<char *>(b + 1);
+    end_ = reinterpret_cast<char *>(b) + size;
+    return allocate(_size, _align);
+}
+
+void bp::arena::release() {
+    if (!head_) return;
+    // keep the last allocated block which is usually the largest one
+    auto keep = head_;
+    auto b = head_->next;
+    while (b) {
+        auto next = b->next;
+        bp::node_deallocate(b);
+        b = next;
+    }
+    keep->next = nullptr;
+    head_ = keep;
+    capacity_ = keep->size;
+    cur_ = reinterpret_cast<char *>(keep + 1);
+    end_ = reinterpret_cast<char *>(keep) + keep->size;
+    used_ = 0;
+}
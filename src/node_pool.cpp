@@ -0,0 +1,218 @@
+#include <cstdlib>
+#include <cstring>
+#include "node_pool.hpp"
+
+namespace {
+    const size_t class_size[] = {16, 32, 48, 64, 96, 128, 192, 256};
+
+    inline size_t class_index(size_t _size) {
+        size_t i = 0;
+        while (class_size[i] < _size) ++i;
+        return i;
+    }
+
+    inline char *align(char *_p, size_t _align) {
+        return reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(_p) + _align - 1) & ~(static_cast<uintptr_t>(_align) - 1));
+    }
+}
+
+constexpr size_t bp::node_pool::page_size;
+constexpr size_t bp::node_pool::class_count;
+
+bp::node_pool::node_pool(void *_memory, size_t _size) noexcept {
+    static_assert(sizeof(class_size) / sizeof(class_size[0]) == class_count, "size classes do not match class count");
+    static_assert(page_size / 16 < 0xFF, "block index of page does not fit into byte");
+    auto begin = static_cast<char *>(_memory);
+    auto end = begin + _size;
+    // every page takes its descriptor besides itself
+    page_count_ = _size / (page_size + sizeof(page_info));
+    while (true) {
+        info_ = reinterpret_cast<page_info *>(align(begin, alignof(page_info)));
+        pages_ = align(reinterpret_cast<char *>(info_ + page_count_), alignof(std::max_align_t));
+        if (!page_count_ || pages_ + page_count_ * page_size <= end) break;
+        --page_count_;
+    }
+    std::memset(info_, 0, page_count_ * sizeof(page_info));
+}
+
+void *bp::node_pool::allocate(size_t _size) noexcept {
+#ifndef BP_SINGLE_THREADED
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    if (_size > page_size) {
+        auto pages = (_size + page_size - 1) / page_size;
+        auto p = allocate_run(pages);
+        if (!p) {
+            ++failures_;
+            return nullptr;
+        }
+        add_used(pages * page_size);
+        return p;
+    }
+
+    auto cls = class_index(_size);
+    if (!partial_[cls]) {
+        auto page = static_cast<char *>(allocate_run(1));
+        if (!page) {
+            ++failures_;
+            return nullptr;
+        }
+        auto i = static_cast<size_t>(page - pages_) / page_size;
+        info_[i].kind = static_cast<uint8_t>(cls + 1);
+        info_[i].live = 0;
+        info_[i].free = 1;
+        // blocks are chained in address order
+        auto count = page_size / class_size[cls];
+        for (size_t k = 0; k < count; ++k) {
+            *reinterpret_cast<uint8_t *>(page + k * class_size[cls]) = static_cast<uint8_t>(k + 1 < count ? k + 2 : 0);
+        }
+        link(cls, i);
+    }
+    auto i = partial_[cls] - 1;
+    auto &info = info_[i];
+    auto b = pages_ + i * page_size + (info.free - 1) * class_size[cls];
+    info.free = *reinterpret_cast<uint8_t *>(b);
+    ++info.live;
+    if (!info.free) {
+        unlink(cls, i);
+    }
+    add_used(class_size[cls]);
+    return b;
+}
+
+void bp::node_pool::deallocate(void *_p) noexcept {
+    if (!_p) return;
+#ifndef BP_SINGLE_THREADED
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    auto offset = static_cast<size_t>(static_cast<char *>(_p) - pages_);
+    auto page = offset / page_size;
+    auto &info = info_[page];
+    if (info.kind == run_head) {
+        auto pages = info.next;
+        for (size_t i = page; i < page + pages; ++i) {
+            info_[i].kind = free_page;
+        }
+        used_ -= pages * page_size;
+        return;
+    }
+    auto cls = static_cast<size_t>(info.kind - 1);
+    used_ -= class_size[cls];
+    bool full = !info.free;
+    if (--info.live == 0) {
+        // empty page goes back to pool
+        if (!full) {
+            unlink(cls, page);
+        }
+        info.kind = free_page;
+        return;
+    }
+    *static_cast<uint8_t *>(_p) = info.free;
+    info.free = static_cast<uint8_t>(offset % page_size / class_size[cls] + 1);
+    if (full) {
+        link(cls, page);
+    }
+}
+
+void *bp::node_pool::allocate_run(size_t _pages) noexcept {
+    // first fit packs pages at the start of pool, leaving its end to large runs
+    size_t found = 0;
+    for (size_t i = 0; i < page_count_; ++i) {
+        if (info_[i].kind != free_page) {
+            found = 0;
+            continue;
+        }
+        if (++found == _pages) {
+            auto first = i + 1 - _pages;
+            info_[first].kind = run_head;
+            info_[first].next = static_cast<uint32_t>(_pages);
+            for (size_t k = first + 1; k <= i; ++k) {
+                info_[k].kind = run_tail;
+            }
+            return pages_ + first * page_size;
+        }
+    }
+    return nullptr;
+}
+
+void bp::node_pool::link(size_t _cls, size_t _page) noexcept {
+    auto &info = info_[_page];
+    info.prev = 0;
+    info.next = partial_[_cls];
+    if (info.next) {
+        info_[info.next - 1].prev = static_cast<uint32_t>(_page + 1);
+    }
+    partial_[_cls] = static_cast<uint32_t>(_page + 1);
+}
+
+void bp::node_pool::unlink(size_t _cls, size_t _page) noexcept {
+    auto &info = info_[_page];
+    if (info.prev) {
+        info_[info.prev - 1].next = info.next;
+    } else {
+        partial_[_cls] = info.next;
+    }
+    if (info.next) {
+        info_[info.next - 1].prev = info.prev;
+    }
+}
+
+void bp::node_pool::add_used(size_t _size) noexcept {
+    used_ += _size;
+    if (used_ > high_water_) {
+        high_water_ = used_;
+    }
+}
+
+#ifdef BP_NODE_POOL_SIZE
+namespace {
+    alignas(std::max_align_t) char pool_memory[BP_NODE_POOL_SIZE];
+    alignas(bp::node_pool) char pool_storage[sizeof(bp::node_pool)];
+    bp::node_pool::exhausted_handler on_exhausted = nullptr;
+#ifdef BP_SINGLE_THREADED
+    size_t checked_depth = 0;
+    size_t checked_failures = 0;
+#else
+    thread_local size_t checked_depth = 0;
+    thread_local size_t checked_failures = 0;
+#endif
+}
+
+bp::node_pool &bp::node_pool::instance() noexcept {
+    // never destroyed: nodes of static structures may be freed after other statics are gone
+    static node_pool *pool = new(pool_storage) node_pool(pool_memory, sizeof(pool_memory));
+    return *pool;
+}
+
+void bp::node_pool::set_exhausted_handler(exhausted_handler _handler) noexcept {
+    on_exhausted = _handler;
+}
+
+void bp::node_pool::exhausted(size_t _size) {
+#if defined(__EXCEPTIONS) || defined(_MSC_VER)
+    (void) _size;
+    throw std::bad_alloc();
+#else
+    if (checked_depth) {
+        ++checked_failures;
+        return;
+    }
+    if (on_exhausted) {
+        on_exhausted(_size);
+    }
+    std::abort();
+#endif
+}
+
+bp::node_pool::checked_scope::checked_scope() noexcept : failures_(checked_failures) {
+    ++checked_depth;
+}
+
+bp::node_pool::checked_scope::~checked_scope() {
+    --checked_depth;
+}
+
+bool bp::node_pool::checked_scope::failed() const noexcept {
+    return checked_failures != failures_;
+}
+#endif
@@ -0,0 +1,521 @@
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include "numbers.hpp"
+
+namespace {
+    const char digit_pairs[] =
+            "0001020304050607080910111213141516171819"
+            "2021222324252627282930313233343536373839"
+            "4041424344454647484950515253545556575859"
+            "6061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+    const uint64_t powers_of_10[] = {
+            1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+            1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+            100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+            1000000000000000000ULL, 10000000000000000000ULL};
+
+    // doubles exactly representing powers of ten
+    const double exact_powers_of_10[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16,
+            1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    inline unsigned count_digits(uint64_t _val) {
+        // log10 estimate from bit length corrected with one comparison
+        auto t = static_cast<unsigned>((64 - __builtin_clzll(_val | 1)) * 1233) >> 12;
+        return t + (_val >= powers_of_10[t]) + (_val == 0);
+    }
+
+    /**
+     * Write digits of value ending at _end two at a time
+     */
+    inline void write_digits(char *_end, uint64_t _val) {
+        while (_val >= 100) {
+            auto pair = static_cast<size_t>(_val % 100) * 2;
+            _val /= 100;
+            _end -= 2;
+            std::memcpy(_end, digit_pairs + pair, 2);
+        }
+        if (_val >= 10) {
+            std::memcpy(_end - 2, digit_pairs + _val * 2, 2);
+        } else {
+            *--_end = static_cast<char>('0' + _val);
+        }
+    }
+
+    /**
+     * Grisu2 shortest double formatting (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+     * with Integers"). Output always reads back as the same value and is shortest for almost all inputs
+     */
+    namespace grisu {
+        // floating point value f * 2^e with 64 bit significand
+        struct diy_fp {
+            uint64_t f;
+            int e;
+        };
+
+        inline diy_fp sub(const diy_fp &_x, const diy_fp &_y) {
+            return {_x.f - _y.f, _x.e};
+        }
+
+        // upper 64 bits of product rounded to nearest
+        inline diy_fp mul(const diy_fp &_x, const diy_fp &_y) {
+#ifdef __SIZEOF_INT128__
+            auto p = static_cast<unsigned __int128>(_x.f) * _y.f;
+            auto h = static_cast<uint64_t>(p >> 64) + ((static_cast<uint64_t>(p) >> 63) & 1);
+#else
+            uint64_t u_lo = _x.f & 0xFFFFFFFFu, u_hi = _x.f >> 32;
+            uint64_t v_lo = _y.f & 0xFFFFFFFFu, v_hi = _y.f >> 32;
+            uint64_t p0 = u_lo * v_lo, p1 = u_lo * v_hi, p2 = u_hi * v_lo, p3 = u_hi * v_hi;
+            uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu) + (1ULL << 31);
+            auto h = p3 + (p1 >> 32) + (p2 >> 32) + (q >> 32);
+#endif
+            return {h, _x.e + _y.e + 64};
+        }
+
+        inline diy_fp normalize(diy_fp _x) {
+            auto shift = __builtin_clzll(_x.f);
+            return {_x.f << shift, _x.e - shift};
+        }
+
+        // value and boundaries of its rounding interval, upper one normalized, lower one scaled to the same exponent
+        struct boundaries {
+            diy_fp w;
+            diy_fp minus;
+            diy_fp plus;
+        };
+
+        template<typename Float, typename Bits>
+        boundaries compute_boundaries(Float _val) {
+            constexpr int precision = std::numeric_limits<Float>::digits;
+            constexpr int bias = std::numeric_limits<Float>::max_exponent - 1 + (precision - 1);
+            constexpr int min_exp = 1 - bias;
+            constexpr uint64_t hidden_bit = uint64_t{1} << (precision - 1);
+
+            Bits bits;
+            std::memcpy(&bits, &_val, sizeof(bits));
+            auto e = static_cast<int>(bits >> (precision - 1));
+            auto f = static_cast<uint64_t>(bits) & (hidden_bit - 1);
+
+            auto v = e == 0 ? diy_fp{f, min_exp} : diy_fp{f + hidden_bit, e - bias};
+            // at powers of two lower neighbour is twice closer
+            bool lower_closer = f == 0 && e > 1;
+            diy_fp plus{2 * v.f + 1, v.e - 1};
+            diy_fp minus = lower_closer ? diy_fp{4 * v.f - 1, v.e - 2} : diy_fp{2 * v.f - 1, v.e - 1};
+
+            auto w_plus = normalize(plus);
+            diy_fp w_minus{minus.f << (minus.e - w_plus.e), w_plus.e};
+            return {normalize(v), w_minus, w_plus};
+        }
+
+        // cached power c = f * 2^e ~ 10^k
+        struct cached_power {
+            uint64_t f;
+            int e;
+            int k;
+        };
+
+        // scaled values keep binary exponent in [alpha, gamma] so integral part fits 32 bits
+        constexpr int alpha = -60;
+        constexpr int gamma = -32;
+
+        cached_power cached_power_for(int _e) {
+            constexpr int min_dec_exp = -300;
+            constexpr int dec_step = 8;
+            static const cached_power powers[] = {
+                    {0xAB70FE17C79AC6CA, -1060, -300},
+                    {0xFF77B1FCBEBCDC4F, -1034, -292},
+                    {0xBE5691EF416BD60C, -1007, -284},
+                    {0x8DD01FAD907FFC3C, -980, -276},
+                    {0xD3515C2831559A83, -954, -268},
+                    {0x9D71AC8FADA6C9B5, -927, -260},
+                    {0xEA9C227723EE8BCB, -901, -252},
+                    {0xAECC49914078536D, -874, -244},
+                    {0x823C12795DB6CE57, -847, -236},
+                    {0xC21094364DFB5637, -821, -228},
+                    {0x9096EA6F3848984F, -794, -220},
+                    {0xD77485CB25823AC7, -768, -212},
+                    {0xA086CFCD97BF97F4, -741, -204},
+                    {0xEF340A98172AACE5, -715, -196},
+                    {0xB23867FB2A35B28E, -688, -188},
+                    {0x84C8D4DFD2C63F3B, -661, -180},
+                    {0xC5DD44271AD3CDBA, -635, -172},
+                    {0x936B9FCEBB25C996, -608, -164},
+                    {0xDBAC6C247D62A584, -582, -156},
+                    {0xA3AB66580D5FDAF6, -555, -148},
+                    {0xF3E2F893DEC3F126, -529, -140},
+                    {0xB5B5ADA8AAFF80B8, -502, -132},
+                    {0x87625F056C7C4A8B, -475, -124},
+                    {0xC9BCFF6034C13053, -449, -116},
+                    {0x964E858C91BA2655, -422, -108},
+                    {0xDFF9772470297EBD, -396, -100},
+                    {0xA6DFBD9FB8E5B88F, -369, -92},
+                    {0xF8A95FCF88747D94, -343, -84},
+                    {0xB94470938FA89BCF, -316, -76},
+                    {0x8A08F0F8BF0F156B, -289, -68},
+                    {0xCDB02555653131B6, -263, -60},
+                    {0x993FE2C6D07B7FAC, -236, -52},
+                    {0xE45C10C42A2B3B06, -210, -44},
+                    {0xAA242499697392D3, -183, -36},
+                    {0xFD87B5F28300CA0E, -157, -28},
+                    {0xBCE5086492111AEB, -130, -20},
+                    {0x8CBCCC096F5088CC, -103, -12},
+                    {0xD1B71758E219652C, -77, -4},
+                    {0x9C40000000000000, -50, 4},
+                    {0xE8D4A51000000000, -24, 12},
+                    {0xAD78EBC5AC620000, 3, 20},
+                    {0x813F3978F8940984, 30, 28},
+                    {0xC097CE7BC90715B3, 56, 36},
+                    {0x8F7E32CE7BEA5C70, 83, 44},
+                    {0xD5D238A4ABE98068, 109, 52},
+                    {0x9F4F2726179A2245, 136, 60},
+                    {0xED63A231D4C4FB27, 162, 68},
+                    {0xB0DE65388CC8ADA8, 189, 76},
+                    {0x83C7088E1AAB65DB, 216, 84},
+                    {0xC45D1DF942711D9A, 242, 92},
+                    {0x924D692CA61BE758, 269, 100},
+                    {0xDA01EE641A708DEA, 295, 108},
+                    {0xA26DA3999AEF774A, 322, 116},
+                    {0xF209787BB47D6B85, 348, 124},
+                    {0xB454E4A179DD1877, 375, 132},
+                    {0x865B86925B9BC5C2, 402, 140},
+                    {0xC83553C5C8965D3D, 428, 148},
+                    {0x952AB45CFA97A0B3, 455, 156},
+                    {0xDE469FBD99A05FE3, 481, 164},
+                    {0xA59BC234DB398C25, 508, 172},
+                    {0xF6C69A72A3989F5C, 534, 180},
+                    {0xB7DCBF5354E9BECE, 561, 188},
+                    {0x88FCF317F22241E2, 588, 196},
+                    {0xCC20CE9BD35C78A5, 614, 204},
+                    {0x98165AF37B2153DF, 641, 212},
+                    {0xE2A0B5DC971F303A, 667, 220},
+                    {0xA8D9D1535CE3B396, 694, 228},
+                    {0xFB9B7CD9A4A7443C, 720, 236},
+                    {0xBB764C4CA7A44410, 747, 244},
+                    {0x8BAB8EEFB6409C1A, 774, 252},
+                    {0xD01FEF10A657842C, 800, 260},
+                    {0x9B10A4E5E9913129, 827, 268},
+                    {0xE7109BFBA19C0C9D, 853, 276},
+                    {0xAC2820D9623BF429, 880, 284},
+                    {0x80444B5E7AA7CF85, 907, 292},
+                    {0xBF21E44003ACDD2D, 933, 300},
+                    {0x8E679C2F5E44FF8F, 960, 308},
+                    {0xD433179D9C8CB841, 986, 316},
+                    {0x9E19DB92B4E31BA9, 1013, 324}
+            };
+
+            auto f = alpha - _e - 1;
+            // ceil(f * log10(2))
+            auto k = (f * 78913) / (1 << 18) + (f > 0);
+            auto index = static_cast<size_t>((-min_dec_exp + k + (dec_step - 1)) / dec_step);
+            return powers[index];
+        }
+
+        inline int largest_pow10(uint32_t _n, uint32_t &_pow10) {
+            auto digits = count_digits(_n);
+            _pow10 = static_cast<uint32_t>(powers_of_10[digits - 1]);
+            return static_cast<int>(digits);
+        }
+
+        // move last digit closer to w while staying inside safe interval
+        inline void round_weed(char *_buf, int _len, uint64_t _dist, uint64_t _delta, uint64_t _rest, uint64_t _ten_k) {
+            while (_rest < _dist && _delta - _rest >= _ten_k &&
+                   (_rest + _ten_k < _dist || _dist - _rest > _rest + _ten_k - _dist)) {
+                --_buf[_len - 1];
+                _rest += _ten_k;
+            }
+        }
+
+        void generate_digits(char *_buf, int &_len, int &_dec_exp, diy_fp _m_minus, diy_fp _w, diy_fp _m_plus) {
+            auto delta = sub(_m_plus, _m_minus).f;
+            auto dist = sub(_m_plus, _w).f;
+
+            diy_fp one{uint64_t{1} << -_m_plus.e, _m_plus.e};
+            auto p1 = static_cast<uint32_t>(_m_plus.f >> -one.e);
+            auto p2 = _m_plus.f & (one.f - 1);
+
+            uint32_t pow10;
+            auto n = largest_pow10(p1, pow10);
+            // integral digits
+            while (n > 0) {
+                auto d = p1 / pow10;
+                p1 %= pow10;
+                _buf[_len++] = static_cast<char>('0' + d);
+                --n;
+                auto rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+                if (rest <= delta) {
+                    _dec_exp += n;
+                    round_weed(_buf, _len, dist, delta, rest, static_cast<uint64_t>(pow10) << -one.e);
+                    return;
+                }
+                pow10 /= 10;
+            }
+
+            // fractional digits
+            int m = 0;
+            while (true) {
+                p2 *= 10;
+                _buf[_len++] = static_cast<char>('0' + (p2 >> -one.e));
+                p2 &= one.f - 1;
+                ++m;
+                delta *= 10;
+                dist *= 10;
+                if (p2 <= delta) break;
+            }
+            _dec_exp -= m;
+            round_weed(_buf, _len, dist, delta, p2, one.f);
+        }
+
+        /**
+         * Generate digits of positive value
+         * @param _buf output for up to 17 digits
+         * @param _len number of digits
+         * @param _dec_exp value is digits * 10^_dec_exp
+         */
+        template<typename Float, typename Bits>
+        void grisu2(char *_buf, int &_len, int &_dec_exp, Float _val) {
+            auto b = compute_boundaries<Float, Bits>(_val);
+            auto cached = cached_power_for(b.plus.e);
+            diy_fp c{cached.f, cached.e};
+
+            auto w = mul(b.w, c);
+            auto w_minus = mul(b.minus, c);
+            auto w_plus = mul(b.plus, c);
+            // products are off by at most one ulp, shrink interval to stay inside it
+            diy_fp m_minus{w_minus.f + 1, w_minus.e};
+            diy_fp m_plus{w_plus.f - 1, w_plus.e};
+
+            _len = 0;
+            _dec_exp = -cached.k;
+            generate_digits(_buf, _len, _dec_exp, m_minus, w, m_plus);
+        }
+    }
+
+    /**
+     * Lay out digits * 10^_dec_exp in fixed or scientific notation in place
+     * @param _buf buffer holding _len digits, max_number_chars long
+     * @return end of text
+     */
+    char *format_decimal(char *_buf, int _len, int _dec_exp) {
+        // longest integral part written without exponent
+        constexpr int max_fixed = 17;
+        // value is 0.digits * 10^n
+        auto n = _len + _dec_exp;
+        if (_len <= n && n <= max_fixed) {
+            // digits000
+            std::memset(_buf + _len, '0', static_cast<size_t>(n - _len));
+            return _buf + n;
+        }
+        if (0 < n && n <= max_fixed) {
+            // dig.its
+            std::memmove(_buf + n + 1, _buf + n, static_cast<size_t>(_len - n));
+            _buf[n] = '.';
+            return _buf + _len + 1;
+        }
+        if (-4 < n && n <= 0) {
+            // 0.000digits
+            std::memmove(_buf + 2 - n, _buf, static_cast<size_t>(_len));
+            _buf[0] = '0';
+            _buf[1] = '.';
+            std::memset(_buf + 2, '0', static_cast<size_t>(-n));
+            return _buf + 2 - n + _len;
+        }
+
+        // d.igitse+x
+        if (_len > 1) {
+            std::memmove(_buf + 2, _buf + 1, static_cast<size_t>(_len - 1));
+            _buf[1] = '.';
+            _buf += _len + 1;
+        } else {
+            ++_buf;
+        }
+        *_buf++ = 'e';
+        auto e = n - 1;
+        if (e < 0) {
+            *_buf++ = '-';
+            e = -e;
+        } else {
+            *_buf++ = '+';
+        }
+        auto digits = count_digits(static_cast<uint64_t>(e));
+        write_digits(_buf + digits, static_cast<uint64_t>(e));
+        return _buf + digits;
+    }
+
+    template<typename Float, typename Bits>
+    char *format_floating(char *_out, Float _val) {
+        if (std::isnan(_val)) {
+            std::memcpy(_out, "nan", 3);
+            return _out + 3;
+        }
+        if (std::signbit(_val)) {
+            *_out++ = '-';
+            _val = -_val;
+        }
+        if (std::isinf(_val)) {
+            std::memcpy(_out, "inf", 3);
+            return _out + 3;
+        }
+        if (_val == 0) {
+            *_out = '0';
+            return _out + 1;
+        }
+        int len, dec_exp;
+        grisu::grisu2<Float, Bits>(_out, len, dec_exp, _val);
+        return format_decimal(_out, len, dec_exp);
+    }
+
+    inline bool is_digit(char _c) {
+        return static_cast<unsigned char>(_c - '0') < 10;
+    }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define BP_SWAR_DIGITS
+    inline bool is_eight_digits(uint64_t _chunk) {
+        // every byte has high nibble 3 and low nibble below 10
+        return ((_chunk & 0xF0F0F0F0F0F0F0F0ULL) |
+                (((_chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+    }
+
+    // convert eight ASCII digits loaded little endian in three multiplications
+    inline uint64_t parse_eight_digits(uint64_t _chunk) {
+        _chunk -= 0x3030303030303030ULL;
+        _chunk = _chunk * 10 + (_chunk >> 8);
+        _chunk = ((_chunk & 0x000000FF000000FFULL) * 0x000F424000000064ULL +
+                  ((_chunk >> 16) & 0x000000FF000000FFULL) * 0x0000271000000001ULL) >> 32;
+        return _chunk;
+    }
+#endif
+
+    constexpr uint64_t max_mantissa = std::numeric_limits<uint64_t>::max() / 10;
+    constexpr uint64_t max_last_digit = std::numeric_limits<uint64_t>::max() % 10;
+
+    /**
+     * Accumulate run of digits into mantissa. Digits not fitting mantissa are dropped
+     * @return end of run
+     */
+    const char *scan_digits(const char *_p, const char *_end, bp::decimal_number &_num, int &_scale, int &_dropped) {
+#ifdef BP_SWAR_DIGITS
+        while (_end - _p >= 8 && _num.mantissa < 100000000000ULL) {
+            uint64_t chunk;
+            std::memcpy(&chunk, _p, 8);
+            if (!is_eight_digits(chunk)) break;
+            _num.mantissa = _num.mantissa * 100000000 + parse_eight_digits(chunk);
+            _scale += 8;
+            _p += 8;
+        }
+#endif
+        while (_p != _end && is_digit(*_p)) {
+            auto digit = static_cast<uint64_t>(*_p - '0');
+            if (_num.mantissa < max_mantissa || (_num.mantissa == max_mantissa && digit <= max_last_digit)) {
+                _num.mantissa = _num.mantissa * 10 + digit;
+                ++_scale;
+            } else {
+                ++_dropped;
+                _num.truncated |= digit != 0;
+            }
+            ++_p;
+        }
+        return _p;
+    }
+}
+
+char *bp::format_uint(char *_out, uint64_t _val) {
+    auto end = _out + count_digits(_val);
+    write_digits(end, _val);
+    return end;
+}
+
+char *bp::format_int(char *_out, int64_t _val) {
+    if (_val < 0) {
+        *_out++ = '-';
+        return format_uint(_out, 0 - static_cast<uint64_t>(_val));
+    }
+    return format_uint(_out, static_cast<uint64_t>(_val));
+}
+
+char *bp::format_double(char *_out, double _val) {
+    return format_floating<double, uint64_t>(_out, _val);
+}
+
+char *bp::format_float(char *_out, float _val) {
+    return format_floating<float, uint32_t>(_out, _val);
+}
+
+const char *bp::scan_number(const char *_begin, const char *_end, decimal_number &_out) {
+    _out = decimal_number();
+    auto p = _begin;
+    if (p != _end && *p == '-') {
+        _out.negative = true;
+        ++p;
+    }
+    if (p == _end || !is_digit(*p)) {
+        return nullptr;
+    }
+
+    int scale = 0, dropped = 0;
+    if (*p == '0') {
+        ++p;
+    } else {
+        p = scan_digits(p, _end, _out, scale, dropped);
+    }
+    // dropped integral digits scale mantissa up
+    _out.exponent = dropped;
+
+    if (p != _end && *p == '.') {
+        _out.fractional = true;
+        ++p;
+        if (p == _end || !is_digit(*p)) {
+            return nullptr;
+        }
+        scale = 0;
+        p = scan_digits(p, _end, _out, scale, dropped);
+        _out.exponent -= scale;
+    }
+    if (p != _end && (*p == 'e' || *p == 'E')) {
+        _out.fractional = true;
+        ++p;
+        bool negative = false;
+        if (p != _end && (*p == '+' || *p == '-')) {
+            negative = *p == '-';
+            ++p;
+        }
+        if (p == _end || !is_digit(*p)) {
+            return nullptr;
+        }
+        int32_t exp = 0;
+        for (; p != _end && is_digit(*p); ++p) {
+            // far beyond double range, saturate
+            if (exp < 100000) exp = exp * 10 + (*p - '0');
+        }
+        _out.exponent += negative ? -exp : exp;
+    }
+    return p;
+}
+
+double bp::to_double(const decimal_number &_num, const char *_begin, const char *_end) {
+    if (!_num.mantissa && !_num.truncated) {
+        return _num.negative ? -0.0 : 0.0;
+    }
+#if FLT_EVAL_METHOD == 0
+    // mantissa and power of ten are both exact, single rounding gives correct result (Clinger's fast path)
+    if (!_num.truncated && _num.mantissa <= (uint64_t{1} << 53) && _num.exponent >= -22 && _num.exponent <= 22) {
+        auto val = static_cast<double>(_num.mantissa);
+        val = _num.exponent < 0 ? val / exact_powers_of_10[-_num.exponent] : val * exact_powers_of_10[_num.exponent];
+        return _num.negative ? -val : val;
+    }
+#endif
+    // number text is not null-terminated
+    char buf[64];
+    auto size = static_cast<size_t>(_end - _begin);
+    if (size < sizeof(buf)) {
+        std::memcpy(buf, _begin, size);
+        buf[size] = 0;
+        return std::strtod(buf, nullptr);
+    }
+    return std::strtod(std::string(_begin, _end).c_str(), nullptr);
+}
@@ -0,0 +1,633 @@
+#include <algorithm>
+#include "persistent_structure.hpp"
+
+using namespace bp::persistent;
+using bp::serializable::tree;
+
+namespace {
+    using entry_type = std::pair<bp::hash_type, node_ptr>;
+
+    inline unsigned popcount(uint32_t _v) {
+#if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_popcount(_v));
+#else
+        _v = _v - ((_v >> 1) & 0x55555555u);
+        _v = (_v & 0x33333333u) + ((_v >> 2) & 0x33333333u);
+        return (((_v + (_v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+#endif
+    }
+
+    inline uint32_t key_bit(const bp::hash_type &_key, unsigned _shift) {
+        return 1u << ((static_cast<bp::hash_type::type>(_key) >> _shift) & level_mask);
+    }
+
+    inline unsigned slot(uint32_t _map, uint32_t _bit) {
+        return popcount(_map & (_bit - 1));
+    }
+
+    const node_ptr &null_node() {
+        static const node_ptr node = std::make_shared<bp::persistent::node>();
+        return node;
+    }
+
+    bp::structure::value_type scalar_type(const tree &_t) {
+        switch (_t.get_kind()) {
+            case tree::kind::Bool:
+                return bp::structure::value_type::Bool;
+            case tree::kind::Int:
+            case tree::kind::UInt:
+                return bp::structure::value_type::Int;
+            case tree::kind::Float:
+                return bp::structure::value_type::Float;
+            case tree::kind::ShortString:
+            case tree::kind::String:
+            case tree::kind::Interned:
+            case tree::kind::StringView:
+                return bp::structure::value_type::String;
+            default:
+                return bp::structure::value_type::Null;
+        }
+    }
+
+    // MAP TRIE
+
+    const node_ptr *map_find(const map_node *_node, const bp::hash_type &_key) {
+        for (unsigned shift = 0; _node; shift += level_bits) {
+            auto bit = key_bit(_key, shift);
+            if (_node->datamap & bit) {
+                const auto &entry = _node->entries[slot(_node->datamap, bit)];
+                return entry.first == _key ? &entry.second : nullptr;
+            }
+            if (!(_node->nodemap & bit)) {
+                return nullptr;
+            }
+            _node = _node->children[slot(_node->nodemap, bit)].get();
+        }
+        return nullptr;
+    }
+
+    map_ptr map_pair(const entry_type &_a, const entry_type &_b, unsigned _shift) {
+        auto res = std::make_shared<map_node>();
+        auto bit_a = key_bit(_a.first, _shift);
+        auto bit_b = key_bit(_b.first, _shift);
+        if (bit_a == bit_b) {
+            res->nodemap = bit_a;
+            res->children.push_back(map_pair(_a, _b, _shift + level_bits));
+        } else {
+            res->datamap = bit_a | bit_b;
+            res->entries.push_back(bit_a < bit_b ? _a : _b);
+            res->entries.push_back(bit_a < bit_b ? _b : _a);
+        }
+        return res;
+    }
+
+    /**
+     * Set key in trie. Transient mode updates nodes in place and is used only for
+     * nodes not shared with any version yet
+     */
+    map_ptr map_set(const map_ptr &_node, const entry_type &_entry, unsigned _shift, bool &_added, bool _transient) {
+        std::shared_ptr<map_node> res;
+        if (!_node) {
+            res = std::make_shared<map_node>();
+        } else if (_transient) {
+            res = std::const_pointer_cast<map_node>(_node);
+        } else {
+            res = std::make_shared<map_node>(*_node);
+        }
+
+        auto bit = key_bit(_entry.first, _shift);
+        if (res->datamap & bit) {
+            auto i = slot(res->datamap, bit);
+            if (res->entries[i].first == _entry.first) {
+                res->entries[i].second = _entry.second;
+                _added = false;
+                return res;
+            }
+            // two keys share the chunk, push both one level down
+            auto child = map_pair(res->entries[i], _entry, _shift + level_bits);
+            res->entries.erase(res->entries.begin() + i);
+            res->datamap ^= bit;
+            res->nodemap |= bit;
+            res->children.insert(res->children.begin() + slot(res->nodemap, bit), std::move(child));
+            _added = true;
+        } else if (res->nodemap & bit) {
+            auto i = slot(res->nodemap, bit);
+            res->children[i] = map_set(res->children[i], _entry, _shift + level_bits, _added, _transient);
+        } else {
+            res->datamap |= bit;
+            res->entries.insert(res->entries.begin() + slot(res->datamap, bit), _entry);
+            _added = true;
+        }
+        return res;
+    }
+
+    /**
+     * Remove key from trie. Subtries left with single entry are inlined into parent
+     * @return new trie or nullptr if trie became empty
+     */
+    map_ptr map_erase(const map_ptr &_node, const bp::hash_type &_key, unsigned _shift, bool &_removed) {
+        _removed = false;
+        auto bit = key_bit(_key, _shift);
+        if (_node->datamap & bit) {
+            auto i = slot(_node->datamap, bit);
+            if (!(_node->entries[i].first == _key)) {
+                return _node;
+            }
+            _removed = true;
+            if (_node->entries.size() == 1 && _node->children.empty()) {
+                return nullptr;
+            }
+            auto res = std::make_shared<map_node>(*_node);
+            res->entries.erase(res->entries.begin() + i);
+            res->datamap ^= bit;
+            return res;
+        }
+        if (!(_node->nodemap & bit)) {
+            return _node;
+        }
+        auto i = slot(_node->nodemap, bit);
+        auto child = map_erase(_node->children[i], _key, _shift + level_bits, _removed);
+        if (!_removed) {
+            return _node;
+        }
+        auto res = std::make_shared<map_node>(*_node);
+        if (!child || (child->children.empty() && child->entries.size() == 1)) {
+            res->children.erase(res->children.begin() + i);
+            res->nodemap ^= bit;
+            if (child) {
+                res->datamap |= bit;
+                res->entries.insert(res->entries.begin() + slot(res->datamap, bit), child->entries.front());
+            } else if (res->entries.empty() && res->children.empty()) {
+                return nullptr;
+            }
+        } else {
+            res->children[i] = std::move(child);
+        }
+        return res;
+    }
+
+    void map_collect(const map_node *_node, std::vector<const entry_type *> &_res) {
+        for (const auto &entry: _node->entries) {
+            _res.push_back(&entry);
+        }
+        for (const auto &child: _node->children) {
+            map_collect(child.get(), _res);
+        }
+    }
+
+    // VECTOR TRIE
+
+    const node_ptr &vector_get(const vector_node *_node, unsigned _shift, size_t _index) {
+        for (; _shift > 0; _shift -= level_bits) {
+            _node = _node->children[(_index >> _shift) & level_mask].get();
+        }
+        return _node->items[_index & level_mask];
+    }
+
+    vector_ptr vector_path(unsigned _shift, const node_ptr &_val) {
+        auto res = std::make_shared<vector_node>();
+        if (_shift == 0) {
+            res->items.push_back(_val);
+        } else {
+            res->children.push_back(vector_path(_shift - level_bits, _val));
+        }
+        return res;
+    }
+
+    vector_ptr vector_push(const vector_ptr &_node, unsigned _shift, size_t _index, const node_ptr &_val,
+                           bool _transient) {
+        auto res = _transient ? std::const_pointer_cast<vector_node>(_node) : std::make_shared<vector_node>(*_node);
+        if (_shift == 0) {
+            res->items.push_back(_val);
+        } else {
+            auto i = (_index >> _shift) & level_mask;
+            if (i < res->children.size()) {
+                res->children[i] = vector_push(res->children[i], _shift - level_bits, _index, _val, _transient);
+            } else {
+                res->children.push_back(vector_path(_shift - level_bits, _val));
+            }
+        }
+        return res;
+    }
+
+    vector_ptr vector_set(const vector_ptr &_node, unsigned _shift, size_t _index, const node_ptr &_val) {
+        auto res = std::make_shared<vector_node>(*_node);
+        if (_shift == 0) {
+            res->items[_index & level_mask] = _val;
+        } else {
+            auto i = (_index >> _shift) & level_mask;
+            res->children[i] = vector_set(res->children[i], _shift - level_bits, _index, _val);
+        }
+        return res;
+    }
+
+    void vector_append(node &_node, const node_ptr &_val, bool _transient) {
+        if (!_node.vector) {
+            _node.vector = vector_path(0, _val);
+            _node.shift = 0;
+        } else if (_node.size == (static_cast<size_t>(1) << (_node.shift + level_bits))) {
+            auto root = std::make_shared<vector_node>();
+            root->children.push_back(_node.vector);
+            root->children.push_back(vector_path(_node.shift, _val));
+            _node.vector = std::move(root);
+            _node.shift += level_bits;
+        } else {
+            _node.vector = vector_push(_node.vector, _node.shift, _node.size, _val, _transient);
+        }
+        ++_node.size;
+    }
+
+    // CONVERSION
+
+    node_ptr snapshot(const tree &_t) {
+        auto res = std::make_shared<node>();
+        switch (_t.get_kind()) {
+            case tree::kind::Object: {
+                res->type = bp::structure::value_type::Object;
+                bool added;
+                for (const auto &entry: *_t.as_object()) {
+                    res->map = map_set(res->map, entry_type(entry.first, snapshot(*entry.second)), 0, added, true);
+                }
+                res->size = _t.as_object()->size();
+                break;
+            }
+            case tree::kind::Array: {
+                res->type = bp::structure::value_type::Array;
+                for (const auto &item: *_t.as_array()) {
+                    vector_append(*res, snapshot(*item), true);
+                }
+                break;
+            }
+            case tree::kind::String:
+            case tree::kind::Interned:
+            case tree::kind::StringView:
+                // long string may live in arena of source structure, string pool or parsed buffer
+                res->type = bp::structure::value_type::String;
+                res->scalar = tree(bp::string_view(_t.str_data(), _t.str_size()));
+                break;
+            default:
+                res->type = scalar_type(_t);
+                res->scalar = _t;
+                break;
+        }
+        return res;
+    }
+
+    void restore_map(const map_node &_node, bp::serializable::object &_obj, bp::arena *_arena);
+
+    void restore_vector(const vector_node &_node, bp::serializable::array &_arr, bp::arena *_arena);
+
+    bp::serializable::tree_ptr restore(const node &_n, bp::arena *_arena) {
+        using namespace bp::serializable;
+        switch (_n.type) {
+            case bp::structure::value_type::Object: {
+                auto obj = make_object(_arena);
+                if (_n.map) restore_map(*_n.map, *obj, _arena);
+                return make_tree(_arena, obj);
+            }
+            case bp::structure::value_type::Array: {
+                auto arr = make_array(_arena);
+                arr->reserve(_n.size);
+                if (_n.vector) restore_vector(*_n.vector, *arr, _arena);
+                return make_tree(_arena, arr);
+            }
+            default:
+                if (_n.scalar.get_kind() == tree::kind::String) {
+                    return make_tree(_arena, bp::string_view(_n.scalar.str_data(), _n.scalar.str_size()), _arena);
+                }
+                return make_tree(_arena, _n.scalar);
+        }
+    }
+
+    void restore_map(const map_node &_node, bp::serializable::object &_obj, bp::arena *_arena) {
+        for (const auto &entry: _node.entries) {
+            _obj.emplace(entry.first, restore(*entry.second, _arena));
+        }
+        for (const auto &child: _node.children) {
+            restore_map(*child, _obj, _arena);
+        }
+    }
+
+    void restore_vector(const vector_node &_node, bp::serializable::array &_arr, bp::arena *_arena) {
+        for (const auto &item: _node.items) {
+            _arr.push_back(restore(*item, _arena));
+        }
+        for (const auto &child: _node.children) {
+            restore_vector(*child, _arr, _arena);
+        }
+    }
+
+    bool equal(const node_ptr &_a, const node_ptr &_b);
+
+    bool equal_maps(const map_node *_a, const map_node *_b) {
+        if (_a == _b) return true;
+        std::vector<const entry_type *> entries;
+        map_collect(_a, entries);
+        for (auto entry: entries) {
+            auto other = map_find(_b, entry->first);
+            if (!other || !equal(entry->second, *other)) return false;
+        }
+        return true;
+    }
+
+    bool equal(const node_ptr &_a, const node_ptr &_b) {
+        if (_a == _b) return true;
+        if (_a->type != _b->type || _a->size != _b->size) return false;
+        switch (_a->type) {
+            case bp::structure::value_type::Object:
+                return equal_maps(_a->map.get(), _b->map.get());
+            case bp::structure::value_type::Array:
+                for (size_t i = 0; i < _a->size; ++i) {
+                    if (!equal(vector_get(_a->vector.get(), _a->shift, i),
+                               vector_get(_b->vector.get(), _b->shift, i))) {
+                        return false;
+                    }
+                }
+                return true;
+            default:
+                return _a->scalar == _b->scalar;
+        }
+    }
+
+    bp::persistent_structure set_path(const bp::persistent_structure &_s, const bp::hash_type *_begin,
+                                      const bp::hash_type *_end, const bp::persistent_structure &_val) {
+        if (_begin == _end) {
+            return _val;
+        }
+        auto child = _s.is_object() && _s.has_key(*_begin) ? _s.at(*_begin) : bp::persistent_structure();
+        return _s.set(*_begin, set_path(child, _begin + 1, _end, _val));
+    }
+}
+
+bp::persistent_structure::persistent_structure() : node_(null_node()) {}
+
+bp::persistent_structure::persistent_structure(const bp::structure &_s) : node_(snapshot(*_s.val_)) {}
+
+node_ptr bp::persistent_structure::make_scalar(bp::serializable::tree &&_val) {
+    auto res = std::make_shared<node>();
+    res->type = scalar_type(_val);
+    res->scalar = std::move(_val);
+    return res;
+}
+
+bp::persistent_structure bp::persistent_structure::create_object() {
+    auto res = std::make_shared<node>();
+    res->type = value_type::Object;
+    return persistent_structure(std::move(res));
+}
+
+bp::persistent_structure bp::persistent_structure::create_array() {
+    auto res = std::make_shared<node>();
+    res->type = value_type::Array;
+    return persistent_structure(std::move(res));
+}
+
+bp::structure bp::persistent_structure::to_structure() const {
+    return structure(restore(*node_, nullptr));
+}
+
+bp::structure bp::persistent_structure::to_structure(bp::arena &_arena) const {
+    return structure(restore(*node_, &_arena), &_arena);
+}
+
+bool bp::persistent_structure::has_key(const bp::hash_type &_key) const {
+    return map_find(node_->map.get(), _key) != nullptr;
+}
+
+bp::persistent_structure bp::persistent_structure::at(const bp::hash_type &_key) const
+        ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error, std::out_of_range)) {
+    if (!is_object()) {
+#ifdef HAS_EXCEPTIONS
+        throw structure::type_error("not an object");
+#endif
+        return persistent_structure();
+    }
+    auto res = map_find(node_->map.get(), _key);
+    if (!res) {
+#ifdef HAS_EXCEPTIONS
+        throw std::out_of_range("key not found");
+#endif
+        return persistent_structure();
+    }
+    return persistent_structure(*res);
+}
+
+bp::persistent_structure bp::persistent_structure::at(int _index) const
+        ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error, std::out_of_range)) {
+    if (!is_array()) {
+#ifdef HAS_EXCEPTIONS
+        throw structure::type_error("not an array");
+#endif
+        return persistent_structure();
+    }
+    if (_index < 0 || static_cast<size_t>(_index) >= node_->size) {
+#ifdef HAS_EXCEPTIONS
+        throw std::out_of_range("index out of range");
+#endif
+        return persistent_structure();
+    }
+    return persistent_structure(vector_get(node_->vector.get(), node_->shift, static_cast<size_t>(_index)));
+}
+
+bp::persistent_structure bp::persistent_structure::set(const bp::hash_type &_key, const persistent_structure &_val) const
+        ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error)) {
+    if (!is_object() && !is_null()) {
+#ifdef HAS_EXCEPTIONS
+        throw structure::type_error("not an object");
+#endif
+        return *this;
+    }
+    auto res = std::make_shared<node>();
+    res->type = value_type::Object;
+    bool added;
+    res->map = map_set(node_->map, entry_type(_key, _val.node_), 0, added, false);
+    res->size = node_->size + (added ? 1 : 0);
+    return persistent_structure(std::move(res));
+}
+
+bp::persistent_structure bp::persistent_structure::set(int _index, const persistent_structure &_val) const
+        ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error, std::out_of_range)) {
+    if (!is_array()) {
+#ifdef HAS_EXCEPTIONS
+        throw structure::type_error("not an array");
+#endif
+        return *this;
+    }
+    if (_index < 0 || static_cast<size_t>(_index) >= node_->size) {
+#ifdef HAS_EXCEPTIONS
+        throw std::out_of_range("index out of range");
+#endif
+        return *this;
+    }
+    auto res = std::make_shared<node>(*node_);
+    res->vector = vector_set(node_->vector, node_->shift, static_cast<size_t>(_index), _val.node_);
+    return persistent_structure(std::move(res));
+}
+
+bp::persistent_structure bp::persistent_structure::set_in(std::initializer_list<bp::hash_type> _path,
+                                                          const persistent_structure &_val) const
+        ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error)) {
+    return set_path(*this, _path.begin(), _path.end(), _val);
+}
+
+bp::persistent_structure bp::persistent_structure::erase(const bp::hash_type &_key) const
+        ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error)) {
+    if (!is_object()) {
+#ifdef HAS_EXCEPTIONS
+        if (!is_null()) throw structure::type_error("not an object");
+#endif
+        return *this;
+    }
+    if (!node_->map) {
+        return *this;
+    }
+    bool removed;
+    auto map = map_erase(node_->map, _key, 0, removed);
+    if (!removed) {
+        return *this;
+    }
+    auto res = std::make_shared<node>();
+    res->type = value_type::Object;
+    res->map = std::move(map);
+    res->size = node_->size - 1;
+    return persistent_structure(std::move(res));
+}
+
+bp::persistent_structure bp::persistent_structure::append(const persistent_structure &_val) const
+        ENABLE_IF_HAS_EXCEPTIONS(throw (structure::type_error)) {
+    if (!is_array() && !is_null()) {
+#ifdef HAS_EXCEPTIONS
+        throw structure::type_error("not an array");
+#endif
+        return *this;
+    }
+    auto res = std::make_shared<node>(*node_);
+    res->type = value_type::Array;
+    vector_append(*res, _val.node_, false);
+    return persistent_structure(std::move(res));
+}
+
+bool bp::persistent_structure::operator==(const persistent_structure &_s) const {
+    return equal(node_, _s.node_);
+}
+
+void bp::persistent_structure::diff(const persistent_structure &_from, const persistent_structure &_to,
+                                    const diff_callback &_cb) {
+    path p;
+    diff_nodes(p, _from.node_, _to.node_, _cb);
+}
+
+void bp::persistent_structure::diff_nodes(path &_path, const node_ptr &_from, const node_ptr &_to,
+                                          const diff_callback &_cb) {
+    if (_from == _to) return;
+    if (_from->type == value_type::Object && _to->type == value_type::Object) {
+        diff_maps(_path, _from->map.get(), _to->map.get(), _cb);
+        return;
+    }
+    if (_from->type == value_type::Array && _to->type == value_type::Array) {
+        auto common = std::min(_from->size, _to->size);
+        if (common > 0) {
+            if (_from->shift == _to->shift) {
+                diff_vectors(_path, _from->vector.get(), _to->vector.get(), _from->shift, 0, common, _cb);
+            } else {
+                for (size_t i = 0; i < common; ++i) {
+                    _path.push_back(path_item{true, bp::hash_type(), i});
+                    diff_nodes(_path, vector_get(_from->vector.get(), _from->shift, i),
+                               vector_get(_to->vector.get(), _to->shift, i), _cb);
+                    _path.pop_back();
+                }
+            }
+        }
+        for (size_t i = common; i < std::max(_from->size, _to->size); ++i) {
+            _path.push_back(path_item{true, bp::hash_type(), i});
+            if (i < _from->size) {
+                _cb(_path, persistent_structure(vector_get(_from->vector.get(), _from->shift, i)), persistent_structure());
+            } else {
+                _cb(_path, persistent_structure(), persistent_structure(vector_get(_to->vector.get(), _to->shift, i)));
+            }
+            _path.pop_back();
+        }
+        return;
+    }
+    if (_from->type == _to->type && _from->scalar == _to->scalar) return;
+    _cb(_path, persistent_structure(_from), persistent_structure(_to));
+}
+
+void bp::persistent_structure::diff_maps(path &_path, const map_node *_from, const map_node *_to,
+                                         const diff_callback &_cb) {
+    if (_from == _to) return;
+
+    auto report = [&](const bp::hash_type &_key, const node_ptr &_old, const node_ptr &_new) {
+        _path.push_back(path_item{false, _key, 0});
+        if (_old && _new) {
+            diff_nodes(_path, _old, _new, _cb);
+        } else {
+            _cb(_path, _old ? persistent_structure(_old) : persistent_structure(),
+                _new ? persistent_structure(_new) : persistent_structure());
+        }
+        _path.pop_back();
+    };
+
+    static const map_node empty;
+    if (!_from) _from = &empty;
+    if (!_to) _to = &empty;
+
+    for (unsigned i = 0; i < level_width; ++i) {
+        uint32_t bit = 1u << i;
+        auto from_entry = _from->datamap & bit ? &_from->entries[slot(_from->datamap, bit)] : nullptr;
+        auto to_entry = _to->datamap & bit ? &_to->entries[slot(_to->datamap, bit)] : nullptr;
+        auto from_child = _from->nodemap & bit ? _from->children[slot(_from->nodemap, bit)].get() : nullptr;
+        auto to_child = _to->nodemap & bit ? _to->children[slot(_to->nodemap, bit)].get() : nullptr;
+
+        if (from_child && to_child) {
+            diff_maps(_path, from_child, to_child, _cb);
+        } else if (from_child || to_child) {
+            // subtrie on one side may contain single entry of the other side
+            std::vector<const entry_type *> entries;
+            map_collect(from_child ? from_child : to_child, entries);
+            auto single = from_child ? to_entry : from_entry;
+            bool matched = false;
+            for (auto entry: entries) {
+                bool same_key = single && single->first == entry->first;
+                matched = matched || same_key;
+                auto other = same_key ? single->second : node_ptr();
+                if (from_child) {
+                    report(entry->first, entry->second, other);
+                } else {
+                    report(entry->first, other, entry->second);
+                }
+            }
+            if (single && !matched) {
+                if (from_child) {
+                    report(single->first, node_ptr(), single->second);
+                } else {
+                    report(single->first, single->second, node_ptr());
+                }
+            }
+        } else if (from_entry && to_entry && from_entry->first == to_entry->first) {
+            report(from_entry->first, from_entry->second, to_entry->second);
+        } else {
+            if (from_entry) report(from_entry->first, from_entry->second, node_ptr());
+            if (to_entry) report(to_entry->first, node_ptr(), to_entry->second);
+        }
+    }
+}
+
+void bp::persistent_structure::diff_vectors(path &_path, const vector_node *_from, const vector_node *_to,
+                                            unsigned _shift, size_t _base, size_t _limit, const diff_callback &_cb) {
+    if (_from == _to) return;
+    if (_shift == 0) {
+        auto count = std::min(_from->items.size(), _to->items.size());
+        for (size_t i = 0; i < count && _base + i < _limit; ++i) {
+            _path.push_back(path_item{true, bp::hash_type(), _base + i});
+            diff_nodes(_path, _from->items[i], _to->items[i], _cb);
+            _path.pop_back();
+        }
+        return;
+    }
+    auto count = std::min(_from->children.size(), _to->children.size());
+    for (size_t i = 0; i < count; ++i) {
+        diff_vectors(_path, _from->children[i].get(), _to->children[i].get(), _shift - level_bits,
+                     _base + (i << _shift), _limit, _cb);
+    }
+}
@@ -1,71 +1,267 @@
+#include <algorithm>
+#include <cstring>
 #include "structure.hpp"
 #include "serializers/dcm_buf.hpp"
+#include "string_pool.hpp"
 
 using size_block = uint32_t;
 
+namespace {
+    /**
+     * Numeric entries are tagged with minimal encoding of their value. 'i' and 'f' keep layout of value_type tags
+     */
+    enum class num_tag : char {
+        Int8 = '1',
+        Int16 = '2',
+        Int32 = 'i',
+        Int64 = '8',
+        UInt64 = 'u',
+        Float = 'f',
+        Double = 'd'
+    };
+
+    template<typename T>
+    T read_num(const char *&_it) {
+        T val;
+        std::memcpy(&val, _it, sizeof(T));
+        _it += sizeof(T);
+        return val;
+    }
+}
+
 namespace bp {
     using namespace serializable;
 
-    template<>
-    std::string structure::stringify<serializers::Dcm>() const {
-        // entry ::= <type>[len]<data>;
-        // object_entry ::= <key><val_entry>
-
-        std::string r;
-        auto tp = type();
-        value_type ntp = tp;
-        r += char(ntp);
-        size_block sz;
-        switch (tp) {
-            case value_type::Object: {
-                auto val = get_variant<bp::serializable::object_ptr>(val_);
-                sz = static_cast<size_block>(val->size());
-                r.append(reinterpret_cast<char *>(&sz), sizeof(size_block));
-
-                for (auto item: *val) {
-                    size_block key_size = static_cast<size_block >(item.first.name().size());
-                    r.append(reinterpret_cast<const char *>(&key_size), sizeof(size_block));
-                    r.append(item.first.name());
-                    r.append(structure(item.second).stringify<serializers::Dcm>());
-                }
-                break;
+    namespace serializers {
+        dcm_writer::dcm_writer(char *_buf) : out_(_buf) {}
+
+        dcm_writer::dcm_writer(dcm_sink &_sink, size_t _flush_size) : sink_(&_sink), flush_size_(_flush_size) {
+            buffer_.reserve(_flush_size);
+        }
+
+        bool dcm_writer::write(const structure_view &_v) {
+            write_value(_v);
+            if (sink_) {
+                flush();
             }
-            case value_type::Array: {
-                sz = static_cast<size_block>(this->size());
-                r.append(reinterpret_cast<char *>(&sz), sizeof(size_block));
-                for (uint i = 0; i < sz; i++) {
-                    r.append(this->at(i).stringify<serializers::Dcm>());
-                }
-                break;
+            return !failed_;
+        }
+
+        size_t dcm_writer::measure(const structure_view &_v) {
+            // entry ::= <type>[len]<data>;
+            // object_entry ::= <key><val_entry>
+            size_t size = 1;
+            switch (_v.type()) {
+                case structure::value_type::Object:
+                    size += sizeof(size_block);
+                    for (auto item: _v.as_object()) {
+                        size += sizeof(size_block) + bp::sym_name(item.first).size() + measure(item.second);
+                    }
+                    break;
+                case structure::value_type::Array:
+                    size += sizeof(size_block);
+                    for (auto item: _v.as_array()) {
+                        size += measure(item);
+                    }
+                    break;
+                case structure::value_type::String:
+                    size += sizeof(size_block) + _v.str_size();
+                    break;
+                case structure::value_type::Int:
+                    if (_v.is_uint64()) {
+                        size += sizeof(uint64_t);
+                    } else {
+                        auto width = _v.num_width();
+                        size += width == 1 || width == 2 || width == 4 ? width : sizeof(int64_t);
+                    }
+                    break;
+                case structure::value_type::Float:
+                    size += _v.num_width() == 4 ? sizeof(float) : sizeof(double);
+                    break;
+                case structure::value_type::Bool:
+                    size += 1;
+                    break;
+                default:
+                    break;
+            }
+            return size;
+        }
+
+        void dcm_writer::write_value(const structure_view &_v) {
+            if (sink_ && buffer_.size() >= flush_size_) {
+                flush();
             }
-            default: {
-                if (tp == value_type::String) {
-                    auto val = get_value<std::string>(val_);
-                    sz = static_cast<size_block>(val.size());
-                    r.append(reinterpret_cast<char *>(&sz), sizeof(size_block));
-                    r.append(val);
-                } else if (tp == value_type::Int) {
-                    auto val = get_value<serializable::int_t>(val_);
-                    r.append(reinterpret_cast<const char *>(&val), sizeof(serializable::int_t));
-                } else if (tp == value_type::Float) {
-                    auto val = get_value<serializable::float_t>(val_);
-                    r.append(reinterpret_cast<const char *>(&val), sizeof(serializable::float_t));
-                } else if (tp == value_type::Bool) {
-                    auto val = get_value<serializable::bool_t>(val_);
-                    r.append(val ? '\1' : '\0', 1);
-                } else if (is_symbol()) {
-                    auto val = get_value<serializable::symbol>(val_);
-                    size_block key_size = static_cast<size_block >(val.name().size());
-                    r.append(reinterpret_cast<const char *>(&key_size), sizeof(size_block));
-                    r.append(val.name());
+            auto tp = _v.type();
+            switch (tp) {
+                case structure::value_type::Object: {
+                    put_num(static_cast<char>(tp));
+                    put_num(static_cast<size_block>(_v.size()));
+                    _v.for_each_sorted([this](const bp::hash_type &_key, const structure_view &_item) {
+                        auto key = bp::sym_name(_key);
+                        put_num(static_cast<size_block>(key.size()));
+                        put(key.data(), key.size());
+                        write_value(_item);
+                    });
+                    break;
                 }
-                break;
+                case structure::value_type::Array: {
+                    put_num(static_cast<char>(tp));
+                    put_num(static_cast<size_block>(_v.size()));
+                    for (auto item: _v.as_array()) {
+                        write_value(item);
+                    }
+                    break;
+                }
+                case structure::value_type::String:
+                    put_num(static_cast<char>(tp));
+                    put_num(static_cast<size_block>(_v.str_size()));
+                    put(_v.str_data(), _v.str_size());
+                    break;
+                case structure::value_type::Int: {
+                    if (_v.is_uint64()) {
+                        put_num(static_cast<char>(num_tag::UInt64));
+                        put_num(_v.as<uint64_t>());
+                        break;
+                    }
+                    auto val = _v.as<int64_t>();
+                    switch (_v.num_width()) {
+                        case 1:
+                            put_num(static_cast<char>(num_tag::Int8));
+                            put_num(static_cast<int8_t>(val));
+                            break;
+                        case 2:
+                            put_num(static_cast<char>(num_tag::Int16));
+                            put_num(static_cast<int16_t>(val));
+                            break;
+                        case 4:
+                            put_num(static_cast<char>(num_tag::Int32));
+                            put_num(static_cast<int32_t>(val));
+                            break;
+                        default:
+                            put_num(static_cast<char>(num_tag::Int64));
+                            put_num(val);
+                            break;
+                    }
+                    break;
+                }
+                case structure::value_type::Float:
+                    if (_v.num_width() == 4) {
+                        put_num(static_cast<char>(num_tag::Float));
+                        put_num(_v.as<float>());
+                    } else {
+                        put_num(static_cast<char>(num_tag::Double));
+                        put_num(_v.as<double>());
+                    }
+                    break;
+                case structure::value_type::Bool:
+                    put_num(static_cast<char>(tp));
+                    put_num(static_cast<char>(_v.as<bool>() ? '\1' : '\0'));
+                    break;
+                default:
+                    put_num(static_cast<char>(tp));
+                    break;
             }
         }
+
+        void dcm_writer::put(const char *_data, size_t _size) {
+            if (!sink_) {
+                std::memcpy(out_, _data, _size);
+                out_ += _size;
+                return;
+            }
+            if (_size < flush_size_) {
+                buffer_.append(_data, _size);
+                return;
+            }
+            // long string is not copied into buffer
+            flush();
+            if (!failed_ && !sink_->write(_data, _size)) {
+                failed_ = true;
+            }
+        }
+
+        void dcm_writer::flush() {
+            if (!failed_ && !buffer_.empty() && !sink_->write(buffer_.data(), buffer_.size())) {
+                // rest of message is dropped
+                failed_ = true;
+            }
+            buffer_.clear();
+        }
+
+        size_t to_dcm(const structure_view &_v, char *_buf, size_t _size) {
+            auto size = dcm_writer::measure(_v);
+            if (size <= _size) {
+                dcm_writer(_buf).write(_v);
+            }
+            return size;
+        }
+    }
+
+    template<>
+    std::string structure::serialize<serializers::Dcm>() const {
+        // message is measured first and written into single buffer of its size
+        std::string r(serializers::dcm_writer::measure(*this), '\0');
+        serializers::dcm_writer(&r[0]).write(*this);
         return r;
     };
 
-    variant_ptr parse_variant(std::string::const_iterator &_it) {
+    namespace {
+        // max nesting level of arrays and objects in message
+        constexpr size_t max_depth = 512;
+
+        /**
+         * Report malformed message
+         * @return nullptr in exceptionless mode
+         */
+        tree_ptr malformed(const char *_msg) ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error)) {
+#ifdef HAS_EXCEPTIONS
+            throw structure::parse_error(_msg);
+#else
+            (void) _msg;
+            return nullptr;
+#endif
+        }
+
+        inline bool has(const char *_it, const char *_end, size_t _n) {
+            return static_cast<size_t>(_end - _it) >= _n;
+        }
+
+        template<typename T>
+        tree_ptr parse_num(const char *&_it, const char *_end, bp::arena *_arena) {
+            if (!has(_it, _end, sizeof(T))) {
+                return malformed("unexpected end of message");
+            }
+            return make_tree(_arena, read_num<T>(_it));
+        }
+    }
+
+    /**
+     * Parse entry of message. Every read is checked against end of message
+     * @return entry node or nullptr on malformed entry in exceptionless mode
+     */
+    tree_ptr parse_variant(const char *&_it, const char *_end, size_t _depth, bp::arena *_arena,
+                           bp::string_pool *_pool, bool _borrow) {
+        if (_it == _end) {
+            return malformed("unexpected end of message");
+        }
+        switch (static_cast<num_tag>(_it[0])) {
+            case num_tag::Int8:
+                return parse_num<int8_t>(++_it, _end, _arena);
+            case num_tag::Int16:
+                return parse_num<int16_t>(++_it, _end, _arena);
+            case num_tag::Int32:
+                return parse_num<int32_t>(++_it, _end, _arena);
+            case num_tag::Int64:
+                return parse_num<int64_t>(++_it, _end, _arena);
+            case num_tag::UInt64:
+                return parse_num<uint64_t>(++_it, _end, _arena);
+            case num_tag::Float:
+                return parse_num<float>(++_it, _end, _arena);
+            case num_tag::Double:
+                return parse_num<double>(++_it, _end, _arena);
+            default:
+                break;
+        }
 
         structure::value_type tp = static_cast<structure::value_type >(_it[0]);
         size_block sz = 0;
@@ -75,9 +271,13 @@ namespace bp {
             case structure::value_type::Object:
             case structure::value_type::Array:
             case structure::value_type::String:
-            case structure::value_type::Symbol:
-                sz = reinterpret_cast<const size_block *>(&(*_it))[0];
-                _it += sizeof(size_block);
+                if (tp != structure::value_type::String && _depth >= max_depth) {
+                    return malformed("nesting is too deep");
+                }
+                if (!has(_it, _end, sizeof(size_block))) {
+                    return malformed("unexpected end of message");
+                }
+                sz = read_num<size_block>(_it);
                 break;
             default:
                 break;
@@ -85,68 +285,303 @@ namespace bp {
 
         switch (tp) {
             case structure::value_type::Object: {
-                object_ptr obj = std::make_shared<object>();
-                for (uint i = 0; i < sz; i++) {
-                    size_block key_size = reinterpret_cast<const size_block*>(&(*_it))[0];
-                    _it+=sizeof(size_block);
-                    symbol key(std::string(_it, _it+key_size));
+                object_ptr obj = make_object(_arena);
+                for (size_block i = 0; i < sz; i++) {
+                    if (!has(_it, _end, sizeof(size_block))) {
+                        return malformed("unexpected end of message");
+                    }
+                    auto key_size = read_num<size_block>(_it);
+                    if (!has(_it, _end, key_size)) {
+                        return malformed("unexpected end of message");
+                    }
+                    auto key = bp::symbol(bp::string_view(_it, key_size)).to_hash();
                     _it += key_size;
-                    obj->emplace(key, parse_variant(_it));
+                    auto item = parse_variant(_it, _end, _depth + 1, _arena, _pool, _borrow);
+                    if (!item) {
+                        return nullptr;
+                    }
+                    obj->emplace(key, std::move(item));
                 }
-                return std::make_shared<variant>(obj);
+                return make_tree(_arena, obj);
             }
             case structure::value_type::Array: {
-                array_ptr obj = std::make_shared<array>();
-                for (uint i = 0; i < sz; i++) {
-                    obj->emplace_back(parse_variant(_it));
+                array_ptr obj = make_array(_arena);
+                // count comes from wire: every item takes at least one byte of what is left
+                obj->reserve(std::min(static_cast<size_t>(sz), static_cast<size_t>(_end - _it)));
+                for (size_block i = 0; i < sz; i++) {
+                    auto item = parse_variant(_it, _end, _depth + 1, _arena, _pool, _borrow);
+                    if (!item) {
+                        return nullptr;
+                    }
+                    obj->emplace_back(std::move(item));
                 }
-                return std::make_shared<variant>(obj);
+                return make_tree(_arena, obj);
             }
             case structure::value_type::String: {
-                value_ptr obj = std::make_shared<value>(std::string(_it, _it + sz));
+                if (!has(_it, _end, sz)) {
+                    return malformed("unexpected end of message");
+                }
+                // strings are stored unescaped, borrowed ones refer to buffer directly
+                auto obj = make_string_tree(_arena, _pool, bp::string_view(_it, sz), _borrow);
                 _it += sz;
-                return std::make_shared<variant>(obj);
-            }
-            case structure::value_type::Int: {
-                value_ptr obj = std::make_shared<value>(
-                        reinterpret_cast<const serializable::int_t *>(&(*_it))[0]);
-                _it += sizeof(serializable::int_t);
-                return std::make_shared<variant>(obj);
-            }
-            case structure::value_type::Float: {
-                value_ptr obj = std::make_shared<value>(
-                        reinterpret_cast<const serializable::float_t *>(&(*_it))[0]);
-                _it += sizeof(serializable::float_t);
-                return std::make_shared<variant>(obj);
+                return obj;
             }
             case structure::value_type::Bool: {
-                value_ptr obj = std::make_shared<value>(*_it ? true : false);
+                if (!has(_it, _end, 1)) {
+                    return malformed("unexpected end of message");
+                }
+                auto obj = make_tree(_arena, *_it ? true : false);
                 _it += 1;
-                return std::make_shared<variant>(obj);
-            }
-            case structure::value_type::Symbol: {
-                symbol key(std::string(_it, _it+sz));
-                _it += sz;
-                value_ptr obj = std::make_shared<value>(key);
-                return std::make_shared<variant>(obj);
+                return obj;
             }
             case structure::value_type::Null: {
-                return std::make_shared<variant>(nullptr);
+                return make_tree(_arena, nullptr);
             }
+            default:
+                break;
         }
-        return std::make_shared<variant>(nullptr);
+        return malformed("unknown entry type");
     }
 
     template<>
-    void structure::parse<serializers::Dcm>(const std::string &_str) {
-        val_.reset();
-        auto it = _str.begin();
-        value_type tp = static_cast<value_type >(*it);
-        set_type(tp);
+    bool structure::parse<serializers::Dcm>(const bp::string_view &_str) {
+        if (_str.empty()) {
+            reset();
+            return false;
+        }
+        const char *it = _str.data();
+        tree_ptr root;
+#ifdef HAS_EXCEPTIONS
         try {
-            val_ = parse_variant(it);
+#endif
+            root = parse_variant(it, it + _str.size(), 0, arena_, pool_, zero_copy_);
+#ifdef HAS_EXCEPTIONS
         } catch (std::exception &_e) {
             throw bp::structure::parse_error(_e.what());
         }
+#endif
+        if (!root) {
+            return false;
+        }
+        *this = structure(std::move(root), arena_);
+        return true;
     };
-}
\ No newline at end of file
+
+    namespace serializers {
+        dcm_push_parser::dcm_push_parser(bp::arena *_arena, bp::string_pool *_pool) : arena_(_arena), pool_(_pool) {}
+
+        push_status dcm_push_parser::feed(const bp::string_view &_chunk)
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error)) {
+            chunk_ = _chunk.data();
+            auto it = chunk_;
+            auto end = chunk_ + _chunk.size();
+            while (state_ != state::Done && state_ != state::Failed) {
+                const char *field;
+                if (pending_.empty() && static_cast<size_t>(end - it) >= need_) {
+                    field = it;
+                    it += need_;
+                } else {
+                    auto n = std::min(need_ - pending_.size(), static_cast<size_t>(end - it));
+                    pending_.append(it, n);
+                    it += n;
+                    if (pending_.size() < need_) {
+                        break;
+                    }
+                    field = pending_.data();
+                }
+                if (!step(field, it)) {
+                    break;
+                }
+                pending_.clear();
+            }
+            if (state_ != state::Failed) {
+                consumed_ = static_cast<size_t>(it - chunk_);
+                offset_ += consumed_;
+            }
+            chunk_ = nullptr;
+
+            switch (state_) {
+                case state::Done:
+                    return push_status::Complete;
+                case state::Failed:
+#ifdef HAS_EXCEPTIONS
+                    throw structure::parse_error(error_.c_str());
+#else
+                    return push_status::Error;
+#endif
+                default:
+                    return push_status::NeedMore;
+            }
+        }
+
+        bool dcm_push_parser::take(structure &_out) {
+            if (state_ != state::Done) {
+                return false;
+            }
+            _out = structure(std::move(root_), arena_);
+            reset();
+            return true;
+        }
+
+        void dcm_push_parser::reset() {
+            state_ = state::Tag;
+            need_ = 1;
+            frames_.clear();
+            root_ = nullptr;
+            pending_.clear();
+            offset_ = 0;
+            error_.clear();
+        }
+
+        bool dcm_push_parser::step(const char *_field, const char *_at) {
+            switch (state_) {
+                case state::Tag:
+                    tag_ = _field[0];
+                    switch (static_cast<num_tag>(tag_)) {
+                        case num_tag::Int8:
+                            need_ = sizeof(int8_t);
+                            break;
+                        case num_tag::Int16:
+                            need_ = sizeof(int16_t);
+                            break;
+                        case num_tag::Int32:
+                        case num_tag::Float:
+                            need_ = sizeof(int32_t);
+                            break;
+                        case num_tag::Int64:
+                        case num_tag::UInt64:
+                        case num_tag::Double:
+                            need_ = sizeof(int64_t);
+                            break;
+                        default:
+                            switch (static_cast<structure::value_type>(tag_)) {
+                                case structure::value_type::Object:
+                                case structure::value_type::Array:
+                                case structure::value_type::String:
+                                    state_ = state::Size;
+                                    need_ = sizeof(size_block);
+                                    return true;
+                                case structure::value_type::Bool:
+                                    need_ = 1;
+                                    break;
+                                case structure::value_type::Null:
+                                    put(make_tree(arena_, nullptr));
+                                    return true;
+                                default:
+                                    // stream can not be resynchronized after unknown entry
+                                    return fail("unknown entry type", _at - 1);
+                            }
+                    }
+                    state_ = state::Scalar;
+                    return true;
+                case state::Scalar:
+                    switch (static_cast<num_tag>(tag_)) {
+                        case num_tag::Int8:
+                            put(make_tree(arena_, read_num<int8_t>(_field)));
+                            break;
+                        case num_tag::Int16:
+                            put(make_tree(arena_, read_num<int16_t>(_field)));
+                            break;
+                        case num_tag::Int32:
+                            put(make_tree(arena_, read_num<int32_t>(_field)));
+                            break;
+                        case num_tag::Int64:
+                            put(make_tree(arena_, read_num<int64_t>(_field)));
+                            break;
+                        case num_tag::UInt64:
+                            put(make_tree(arena_, read_num<uint64_t>(_field)));
+                            break;
+                        case num_tag::Float:
+                            put(make_tree(arena_, read_num<float>(_field)));
+                            break;
+                        case num_tag::Double:
+                            put(make_tree(arena_, read_num<double>(_field)));
+                            break;
+                        default:
+                            put(make_tree(arena_, *_field ? true : false));
+                            break;
+                    }
+                    return true;
+                case state::Size: {
+                    auto sz = read_num<size_block>(_field);
+                    switch (static_cast<structure::value_type>(tag_)) {
+                        case structure::value_type::Object:
+                            if (!sz) {
+                                put(make_tree(arena_, make_object(arena_)));
+                            } else {
+                                frames_.push_back(frame{make_object(arena_), nullptr, sz, 0});
+                                next();
+                            }
+                            break;
+                        case structure::value_type::Array:
+                            // size is not trusted for reservation, message may be cut or forged
+                            if (!sz) {
+                                put(make_tree(arena_, make_array(arena_)));
+                            } else {
+                                frames_.push_back(frame{nullptr, make_array(arena_), sz, 0});
+                                next();
+                            }
+                            break;
+                        default:
+                            state_ = state::String;
+                            need_ = sz;
+                            break;
+                    }
+                    return true;
+                }
+                case state::String:
+                    put(make_string_tree(arena_, pool_, bp::string_view(_field, need_)));
+                    return true;
+                case state::KeySize:
+                    need_ = read_num<size_block>(_field);
+                    state_ = state::Key;
+                    return true;
+                case state::Key:
+                    frames_.back().key = bp::symbol(bp::string_view(_field, need_)).to_hash();
+                    state_ = state::Tag;
+                    need_ = 1;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        void dcm_push_parser::put(tree_ptr _val) {
+            while (!frames_.empty()) {
+                auto &f = frames_.back();
+                if (f.object) {
+                    f.object->emplace(f.key, std::move(_val));
+                } else {
+                    f.array->emplace_back(std::move(_val));
+                }
+                if (--f.remaining) {
+                    next();
+                    return;
+                }
+                _val = f.object ? make_tree(arena_, std::move(f.object)) : make_tree(arena_, std::move(f.array));
+                frames_.pop_back();
+            }
+            root_ = std::move(_val);
+            state_ = state::Done;
+        }
+
+        void dcm_push_parser::next() {
+            if (frames_.back().object) {
+                state_ = state::KeySize;
+                need_ = sizeof(size_block);
+            } else {
+                state_ = state::Tag;
+                need_ = 1;
+            }
+        }
+
+        bool dcm_push_parser::fail(const char *_msg, const char *_at) {
+            state_ = state::Failed;
+            consumed_ = static_cast<size_t>(_at - chunk_);
+            error_ = _msg;
+            error_ += " at offset ";
+            error_ += std::to_string(offset_ + consumed_);
+            return false;
+        }
+    }
+}
@@ -1,34 +1,41 @@
 #include <sstream>
 #include <jsoncpp/json/json.h>
 #include "structure.hpp"
+#include "structure_view.hpp"
+#include "string_pool.hpp"
 #include "serializers/json.hpp"
+#include "serializers/key_cache.hpp"
+#include "serializers/json_reader.hpp"
+#include "serializers/json_tape.hpp"
+#include "serializers/json_writer.hpp"
 
 namespace bp {
     using namespace serializable;
 
-    Json::Value build_json(const structure& root) {
+    Json::Value build_json(const structure_view &root) {
         Json::Value r;
-        auto tp = root.type();
-        switch (tp) {
+        switch (root.type()) {
             case structure::value_type::Object: {
-                for (auto item: root.keys()) {
-                    r[item]=build_json(root.at(item));
+                for (auto item: root.as_object()) {
+                    r[bp::sym_name(item.first)]=build_json(item.second);
                 }
                 break;
             }
             case structure::value_type::Array: {
-                for (uint32_t i=0; i<root.size(); ++i) {
-                    r.append(build_json(root.at(i)));
+                for (auto item: root.as_array()) {
+                    r.append(build_json(item));
                 }
                 break;
             }
             default: {
                 if (root.is_string()) {
-                    r = root.as<std::string>();
+                    r = Json::Value(root.str_data(), root.str_data() + root.str_size());
+                } else if (root.is_uint64()) {
+                    r = Json::UInt64(root.as<uint64_t>());
                 } else if (root.is_int()) {
-                    r = root.as<int>();
+                    r = Json::Int64(root.as<int64_t>());
                 } else if (root.is_float()) {
-                    r = root.as<float>();
+                    r = root.as<double>();
                 } else if (root.is_bool()) {
                     r = root.as<bool>();
                 }
@@ -41,44 +48,101 @@ namespace bp {
 
     template<>
     std::string structure::serialize<serializers::Json>() const {
+        return serializers::to_json(*this);
+    };
+
+    template<>
+    std::string structure::serialize<serializers::JsonPretty>() const {
+        return serializers::to_json(*this, serializers::json_writer::style::Pretty);
+    };
+
+    template<>
+    std::string structure::serialize<serializers::JsonCpp>() const {
         return build_json(*this).toStyledString();
     };
 
-    tree_ptr parse_variant(const Json::Value &root) {
+    tree_ptr parse_variant(const Json::Value &root, bp::arena *_arena, bp::string_pool *_pool,
+                           serializers::key_cache &_keys) {
 
         if (root.isArray()) {
-            array arr;
+            auto arr = make_array(_arena);
+            arr->reserve(root.size());
             for (int i = 0, len=root.size(); i < len; ++i)  {
-                arr.push_back(parse_variant(root[i]));
+                arr->push_back(parse_variant(root[i], _arena, _pool, _keys));
             }
-            return std::make_shared<tree>(arr);
+            return make_tree(_arena, arr);
         } else if (root.isObject()) {
-            object obj;
-            for (auto key: root.getMemberNames()) {
-                obj.emplace(bp::symbol(key).to_hash(), parse_variant(root[key]));
+            auto obj = make_object(_arena);
+            for (auto it = root.begin(); it != root.end(); ++it) {
+                const char *end;
+                auto key = it.memberName(&end);
+                obj->emplace(_keys.hash(bp::string_view(key, static_cast<size_t>(end - key))),
+                             parse_variant(*it, _arena, _pool, _keys));
             }
-            return std::make_shared<tree>(obj);
+            return make_tree(_arena, obj);
         } else if (root.isBool()) {
-            return std::make_shared<tree>(root.asBool());
-        } else if (root.isDouble()) {
-            return std::make_shared<tree>(static_cast<float>(root.asDouble()));
-        } else if (root.isIntegral()) {
-            return std::make_shared<tree>(static_cast<serializable::int_t>(root.asLargestInt()));
+            return make_tree(_arena, root.asBool());
+        } else if (root.type() == Json::realValue) {
+            return make_tree(_arena, root.asDouble());
+        } else if (root.type() == Json::uintValue) {
+            return make_tree(_arena, static_cast<uint64_t>(root.asLargestUInt()));
+        } else if (root.type() == Json::intValue) {
+            return make_tree(_arena, static_cast<int64_t>(root.asLargestInt()));
         } else if (root.isNull()) {
-            return std::make_shared<tree>(0);
+            return make_tree(_arena, nullptr);
         } else if (root.isString()) {
-            return std::make_shared<tree>(root.asString());
+            const char *begin, *end;
+            root.getString(&begin, &end);
+            return make_string_tree(_arena, _pool, bp::string_view(begin, static_cast<size_t>(end - begin)));
         }
-        return std::make_shared<tree>(0);
+        return make_tree(_arena, nullptr);
     }
 
     template<>
-    bool structure::parse<serializers::Json>(const std::string &_str) {
+    bool structure::parse<serializers::Json>(const bp::string_view &_str) {
+#ifdef JSONCPP_PARSER
+        return parse<serializers::JsonCpp>(_str);
+#else
+        serializers::json_reader reader(arena_, pool_);
+        reader.set_zero_copy(zero_copy_);
+        auto root = reader.parse(_str);
+        if (!root) {
+            return false;
+        }
+        val_ = std::move(root);
+        value_type_ = structure_view(*val_).type();
+        return true;
+#endif
+    };
+
+    template<>
+    bool structure::parse<serializers::JsonPretty>(const bp::string_view &_str) {
+        return parse<serializers::Json>(_str);
+    };
+
+    template<>
+    std::string structure::serialize<serializers::JsonLazy>() const {
+        return serialize<serializers::Json>();
+    };
+
+    template<>
+    bool structure::parse<serializers::JsonLazy>(const bp::string_view &_str) {
+        auto root = serializers::json_tape::parse(_str, arena_, pool_, zero_copy_);
+        if (!root) {
+            return false;
+        }
+        val_ = std::move(root);
+        value_type_ = structure_view(*val_).type();
+        return true;
+    };
+
+    template<>
+    bool structure::parse<serializers::JsonCpp>(const bp::string_view &_str) {
         val_.reset();
 
         Json::Value root;
         try {
-            std::stringstream ss(_str);
+            std::stringstream ss(std::string(_str.data(), _str.size()));
             ss >> root;
         } catch (Json::Exception &_e) {
             throw bp::structure::parse_error(_e.what());
@@ -90,9 +154,9 @@ namespace bp {
             value_type_ = value_type::Object;
         } else if (root.isBool()) {
             value_type_ = value_type::Bool;
-        } else if (root.isDouble()) {
+        } else if (root.type() == Json::realValue) {
             value_type_ = value_type::Float;
-        } else if (root.isIntegral()) {
+        } else if (root.type() == Json::intValue || root.type() == Json::uintValue) {
             value_type_ = value_type::Int;
         } else if (root.isNull()) {
             value_type_ = value_type::Null;
@@ -100,7 +164,8 @@ namespace bp {
             value_type_ = value_type::String;
         }
         try {
-            val_ = parse_variant(root);
+            serializers::key_cache keys;
+            val_ = parse_variant(root, arena_, pool_, keys);
         } catch (std::exception &_e) {
             throw bp::structure::parse_error(_e.what());
         }
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <cstring>
+#include "node_pool.hpp"
+#include "numbers.hpp"
+#include "serializers/json_in_situ.hpp"
+#include "string_pool.hpp"
+
+namespace bp {
+    namespace serializers {
+        using namespace serializable;
+
+        namespace {
+            // input bytes per value the stack is reserved for, denser documents grow it
+            constexpr size_t bytes_per_item = 16;
+
+            inline int hex_digit(char _c) {
+                if (_c >= '0' && _c <= '9') return _c - '0';
+                if (_c >= 'a' && _c <= 'f') return _c - 'a' + 10;
+                if (_c >= 'A' && _c <= 'F') return _c - 'A' + 10;
+                return -1;
+            }
+
+            bool read_hex(char *&_it, const char *_end, uint32_t &_cp) {
+                // _it points to 'u'
+                if (_end - _it < 5) return false;
+                _cp = 0;
+                for (int i = 1; i <= 4; ++i) {
+                    auto d = hex_digit(_it[i]);
+                    if (d < 0) return false;
+                    _cp = (_cp << 4) | static_cast<uint32_t>(d);
+                }
+                _it += 5;
+                return true;
+            }
+
+            /**
+             * Write code point as UTF-8. Encoding is never longer than escape sequence it replaces
+             * @return end of written bytes
+             */
+            char *put_utf8(char *_out, uint32_t _cp) {
+                if (_cp < 0x80) {
+                    *_out++ = static_cast<char>(_cp);
+                } else if (_cp < 0x800) {
+                    *_out++ = static_cast<char>(0xC0 | (_cp >> 6));
+                    *_out++ = static_cast<char>(0x80 | (_cp & 0x3F));
+                } else if (_cp < 0x10000) {
+                    *_out++ = static_cast<char>(0xE0 | (_cp >> 12));
+                    *_out++ = static_cast<char>(0x80 | ((_cp >> 6) & 0x3F));
+                    *_out++ = static_cast<char>(0x80 | (_cp & 0x3F));
+                } else {
+                    *_out++ = static_cast<char>(0xF0 | (_cp >> 18));
+                    *_out++ = static_cast<char>(0x80 | ((_cp >> 12) & 0x3F));
+                    *_out++ = static_cast<char>(0x80 | ((_cp >> 6) & 0x3F));
+                    *_out++ = static_cast<char>(0x80 | (_cp & 0x3F));
+                }
+                return _out;
+            }
+
+            /**
+             * Create node for scanned number. Integers are kept as such when they fit into 64 bits
+             */
+            tree_ptr make_number(bp::arena *_arena, const bp::decimal_number &_num, const char *_begin,
+                                 const char *_end) {
+                if (!_num.fractional && !_num.truncated && !_num.exponent) {
+                    if (!_num.negative) {
+                        if (_num.mantissa > static_cast<uint64_t>(INT64_MAX)) {
+                            return make_tree(_arena, _num.mantissa);
+                        }
+                        return make_tree(_arena, static_cast<int64_t>(_num.mantissa));
+                    }
+                    if (_num.mantissa <= static_cast<uint64_t>(INT64_MAX) + 1) {
+                        return make_tree(_arena, static_cast<int64_t>(0 - _num.mantissa));
+                    }
+                }
+                return make_tree(_arena, bp::to_double(_num, _begin, _end));
+            }
+        }
+
+        constexpr size_t json_in_situ_parser::max_depth;
+
+        json_in_situ_parser::json_in_situ_parser(bp::arena *_arena, bp::string_pool *_pool) :
+                arena_(_arena), pool_(_pool) {}
+
+        tree_ptr json_in_situ_parser::parse(char *_buf, size_t _size)
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error)) {
+            begin_ = cur_ = _buf;
+            end_ = _buf + _size;
+            failed_ = false;
+            error_.clear();
+            stats_ = json_parse_stats();
+            auto arena_used = arena_ ? arena_->used() : 0;
+#ifdef BP_NODE_POOL_SIZE
+            auto pool_used = bp::node_pool::instance().used();
+#endif
+            items_.reserve(_size / bytes_per_item + 1);
+            // exceptionless builds get exhausted node pool reported as parse failure
+            bp::node_pool::checked_scope alloc;
+            alloc_ = &alloc;
+
+            if (run()) {
+                skip_ws();
+                if (cur_ != end_) {
+                    fail("unexpected trailing characters");
+                }
+            }
+            alloc_ = nullptr;
+            tree_ptr root;
+            if (!failed_) {
+                root = std::move(items_.back());
+            }
+            if (arena_) {
+                stats_.tree_bytes = arena_->used() - arena_used;
+            }
+#ifdef BP_NODE_POOL_SIZE
+            else {
+                stats_.tree_bytes = bp::node_pool::instance().used() - pool_used;
+            }
+#endif
+            items_.clear();
+            names_.clear();
+            frames_.clear();
+            stats_.stack_bytes = items_.capacity() * sizeof(tree_ptr) + names_.capacity() * sizeof(bp::hash_type) +
+                                 frames_.capacity() * sizeof(frame);
+#ifdef HAS_EXCEPTIONS
+            if (failed_) {
+                throw structure::parse_error(error_.c_str());
+            }
+#endif
+            return root;
+        }
+
+        bool json_in_situ_parser::parse(char *_buf, size_t _size, structure &_out)
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error)) {
+            auto root = parse(_buf, _size);
+            if (!root) {
+                return false;
+            }
+            _out = structure(std::move(root), arena_);
+            return true;
+        }
+
+        bool json_in_situ_parser::fail(const char *_msg) {
+            if (!failed_) {
+                failed_ = true;
+                error_ = _msg;
+                error_ += " at offset ";
+                error_ += std::to_string(cur_ - begin_);
+            }
+            return false;
+        }
+
+        bool json_in_situ_parser::run() {
+            while (true) {
+                skip_ws();
+                if (cur_ == end_) {
+                    return fail("unexpected end of input");
+                }
+                if (*cur_ == '{' || *cur_ == '[') {
+                    if (frames_.size() >= max_depth) {
+                        return fail("nesting is too deep");
+                    }
+                    bool object = *cur_ == '{';
+                    frames_.push_back(frame{object, items_.size(), names_.size()});
+                    stats_.depth = std::max(stats_.depth, frames_.size());
+                    ++cur_;
+                    skip_ws();
+                    if (cur_ == end_ || *cur_ != (object ? '}' : ']')) {
+                        if (object && !parse_key()) return false;
+                        continue;
+                    }
+                    ++cur_;
+                    if (!close()) return false;
+                } else if (!parse_scalar()) {
+                    return false;
+                }
+
+                // value is finished: move to the next item or close containers ending here
+                while (!frames_.empty()) {
+                    skip_ws();
+                    auto object = frames_.back().object;
+                    if (cur_ != end_ && *cur_ == ',') {
+                        ++cur_;
+                        if (object && !parse_key()) return false;
+                        break;
+                    }
+                    if (cur_ == end_ || *cur_ != (object ? '}' : ']')) {
+                        return fail(object ? "expected ',' or '}'" : "expected ',' or ']'");
+                    }
+                    ++cur_;
+                    if (!close()) return false;
+                }
+                if (frames_.empty()) {
+                    return true;
+                }
+            }
+        }
+
+        bool json_in_situ_parser::parse_scalar() {
+            switch (*cur_) {
+                case '"': {
+                    bp::string_view s;
+                    if (!parse_string(s)) return false;
+                    return push(make_string_tree(arena_, pool_, s, zero_copy_));
+                }
+                case 't':
+                    if (!parse_literal("true", 4)) return false;
+                    return push(make_tree(arena_, true));
+                case 'f':
+                    if (!parse_literal("false", 5)) return false;
+                    return push(make_tree(arena_, false));
+                case 'n':
+                    if (!parse_literal("null", 4)) return false;
+                    return push(make_tree(arena_));
+                default: {
+                    if (*cur_ != '-' && (*cur_ < '0' || *cur_ > '9')) {
+                        return fail("unexpected character");
+                    }
+                    bp::decimal_number num;
+                    auto start = cur_;
+                    auto end = bp::scan_number(cur_, end_, num);
+                    if (!end) {
+                        return fail("invalid number");
+                    }
+                    cur_ += end - start;
+                    return push(make_number(arena_, num, start, end));
+                }
+            }
+        }
+
+        bool json_in_situ_parser::parse_key() {
+            skip_ws();
+            if (cur_ == end_ || *cur_ != '"') {
+                return fail("expected object key");
+            }
+            bp::string_view key;
+            if (!parse_string(key)) return false;
+            names_.push_back(keys_.hash(key));
+            skip_ws();
+            if (cur_ == end_ || *cur_ != ':') {
+                return fail("expected ':'");
+            }
+            ++cur_;
+            return true;
+        }
+
+        bool json_in_situ_parser::parse_string(bp::string_view &_out) {
+            auto start = ++cur_;
+            // decoded text is written over escape sequences, plain prefix stays in place
+            auto out = cur_;
+            while (cur_ != end_ && *cur_ != '"') {
+                auto c = *cur_;
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    return fail("control character in string");
+                }
+                if (c != '\\') {
+                    *out++ = c;
+                    ++cur_;
+                    continue;
+                }
+                if (++cur_ == end_) break;
+                switch (*cur_) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        *out++ = *cur_;
+                        break;
+                    case 'b':
+                        *out++ = '\b';
+                        break;
+                    case 'f':
+                        *out++ = '\f';
+                        break;
+                    case 'n':
+                        *out++ = '\n';
+                        break;
+                    case 'r':
+                        *out++ = '\r';
+                        break;
+                    case 't':
+                        *out++ = '\t';
+                        break;
+                    case 'u': {
+                        uint32_t cp;
+                        if (!read_hex(cur_, end_, cp)) {
+                            return fail("invalid unicode escape");
+                        }
+                        if (cp >= 0xD800 && cp <= 0xDBFF) {
+                            uint32_t low;
+                            if (end_ - cur_ < 2 || cur_[0] != '\\' || cur_[1] != 'u') {
+                                return fail("unpaired surrogate");
+                            }
+                            ++cur_;
+                            if (!read_hex(cur_, end_, low) || low < 0xDC00 || low > 0xDFFF) {
+                                return fail("unpaired surrogate");
+                            }
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                            return fail("unpaired surrogate");
+                        }
+                        out = put_utf8(out, cp);
+                        continue;
+                    }
+                    default:
+                        return fail("invalid escape");
+                }
+                ++cur_;
+            }
+            if (cur_ == end_) {
+                return fail("unterminated string");
+            }
+            ++cur_;
+            _out = bp::string_view(start, static_cast<size_t>(out - start));
+            return true;
+        }
+
+        bool json_in_situ_parser::parse_literal(const char *_literal, size_t _size) {
+            if (static_cast<size_t>(end_ - cur_) < _size || std::memcmp(cur_, _literal, _size) != 0) {
+                return fail("invalid literal");
+            }
+            cur_ += _size;
+            return true;
+        }
+
+        bool json_in_situ_parser::close() {
+            auto f = frames_.back();
+            frames_.pop_back();
+            if (f.object) {
+                auto obj = make_object(arena_);
+                if (!obj) return fail("out of memory");
+                obj->reserve(items_.size() - f.items);
+                if (alloc_->failed()) return fail("out of memory");
+                for (size_t i = f.items, k = f.names; i < items_.size(); ++i, ++k) {
+                    // duplicate keys: last value wins
+                    (*obj)[names_[k]] = std::move(items_[i]);
+                }
+                names_.resize(f.names);
+                items_.resize(f.items);
+                return push(make_tree(arena_, std::move(obj)));
+            }
+            auto arr = make_array(arena_);
+            if (!arr) return fail("out of memory");
+            arr->reserve(items_.size() - f.items);
+            if (alloc_->failed()) return fail("out of memory");
+            for (size_t i = f.items; i < items_.size(); ++i) {
+                arr->push_back(std::move(items_[i]));
+            }
+            items_.resize(f.items);
+            return push(make_tree(arena_, std::move(arr)));
+        }
+
+        bool json_in_situ_parser::push(tree_ptr &&_node) {
+            // failed string allocation leaves null node, so scope is checked as well
+            if (!_node || alloc_->failed()) {
+                return fail("out of memory");
+            }
+            items_.push_back(std::move(_node));
+            ++stats_.nodes;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cstring>
+#include "serializers/json_index.hpp"
+
+#ifdef BP_JSON_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace bp {
+    namespace serializers {
+
+        namespace {
+            constexpr size_t block_size = 64;
+
+            enum char_class : uint8_t {
+                Quote = 1,
+                Backslash = 2,
+                Whitespace = 4,
+                Structural = 8,
+                Control = 16
+            };
+
+            struct class_table {
+                uint8_t cls[256];
+
+                class_table() : cls() {
+                    for (int c = 0; c < 0x20; ++c) cls[c] = Control;
+                    cls[static_cast<uint8_t>('"')] = Quote;
+                    cls[static_cast<uint8_t>('\\')] = Backslash;
+                    cls[static_cast<uint8_t>(' ')] = Whitespace;
+                    cls[static_cast<uint8_t>('\t')] = Whitespace | Control;
+                    cls[static_cast<uint8_t>('\n')] = Whitespace | Control;
+                    cls[static_cast<uint8_t>('\r')] = Whitespace | Control;
+                    for (auto c: {'{', '}', '[', ']', ':', ','}) cls[static_cast<uint8_t>(c)] = Structural;
+                }
+            };
+
+            inline unsigned trailing_zeros(uint64_t _v) {
+#ifdef __GNUC__
+                return static_cast<unsigned>(__builtin_ctzll(_v));
+#else
+                unsigned n = 0;
+                while (!(_v & 1)) {
+                    _v >>= 1;
+                    ++n;
+                }
+                return n;
+#endif
+            }
+
+            // bit i is set if odd number of bits at positions 0..i are set
+            inline uint64_t prefix_xor(uint64_t _v) {
+                _v ^= _v << 1;
+                _v ^= _v << 2;
+                _v ^= _v << 4;
+                _v ^= _v << 8;
+                _v ^= _v << 16;
+                _v ^= _v << 32;
+                return _v;
+            }
+
+            // characters escaped by backslashes. Only documents with backslashes pay for the loop
+            inline uint64_t escaped_chars(uint64_t _backslash, uint64_t &_carry) {
+                uint64_t escaped = _carry;
+                _backslash &= ~_carry;
+                _carry = 0;
+                while (_backslash) {
+                    auto i = trailing_zeros(_backslash);
+                    if (i == block_size - 1) {
+                        _carry = 1;
+                        break;
+                    }
+                    escaped |= 2ULL << i;
+                    // escaped backslash does not escape next character
+                    _backslash &= ~(3ULL << i);
+                }
+                return escaped;
+            }
+
+#ifdef BP_JSON_SIMD_X86
+            __attribute__((target("sse4.2")))
+            inline uint64_t mask(__m128i _m) {
+                return static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_m)));
+            }
+
+            __attribute__((target("avx2")))
+            inline uint64_t mask(__m256i _m) {
+                return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_m)));
+            }
+#endif
+        }
+
+        structural_index::kernel structural_index::best_kernel() {
+            if (supported(kernel::Avx2)) return kernel::Avx2;
+            if (supported(kernel::Sse42)) return kernel::Sse42;
+            return kernel::Scalar;
+        }
+
+        bool structural_index::supported(kernel _k) {
+            switch (_k) {
+#ifdef BP_JSON_SIMD_X86
+                case kernel::Avx2:
+                    return __builtin_cpu_supports("avx2");
+                case kernel::Sse42:
+                    return __builtin_cpu_supports("sse4.2");
+#endif
+                case kernel::Scalar:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        structural_index::structural_index(kernel _k) {
+            switch (_k) {
+#ifdef BP_JSON_SIMD_X86
+                case kernel::Avx2:
+                    classify_ = classify_avx2;
+                    break;
+                case kernel::Sse42:
+                    classify_ = classify_sse42;
+                    break;
+#endif
+                default:
+                    classify_ = classify_scalar;
+                    break;
+            }
+        }
+
+        bool structural_index::fail(const char *_msg, size_t _offset) {
+            error_ = _msg;
+            error_offset_ = _offset;
+            count_ = 0;
+            return false;
+        }
+
+        bool structural_index::build(const bp::string_view &_s) {
+            error_ = nullptr;
+            error_offset_ = 0;
+            count_ = 0;
+            if (_s.size() > UINT32_MAX) {
+                return fail("document is too large", 0);
+            }
+
+            auto data = reinterpret_cast<const uint8_t *>(_s.data());
+            auto size = _s.size();
+            uint64_t escape_carry = 0;
+            uint64_t string_carry = 0;
+            uint64_t scalar_carry = 0;
+            uint8_t tail[block_size];
+            block_masks m;
+
+            for (size_t base = 0; base < size; base += block_size) {
+                auto block = data + base;
+                if (size - base < block_size) {
+                    // last block is padded with whitespace which never gets into index
+                    std::memset(tail, ' ', block_size);
+                    std::memcpy(tail, block, size - base);
+                    block = tail;
+                }
+                classify_(block, m);
+
+                uint64_t escaped = m.backslash || escape_carry ? escaped_chars(m.backslash, escape_carry) : 0;
+                uint64_t quotes = m.quote & ~escaped;
+                // opening quotes and string contents, closing quotes are outside
+                uint64_t in_string = prefix_xor(quotes) ^ string_carry;
+                string_carry = 0 - (in_string >> 63);
+
+                if (m.control & in_string) {
+                    return fail("control character in string", base + trailing_zeros(m.control & in_string));
+                }
+
+                uint64_t scalar = ~(m.structural | m.whitespace | quotes | in_string);
+                uint64_t scalar_start = scalar & ~((scalar << 1) | scalar_carry);
+                scalar_carry = scalar >> 63;
+                uint64_t tokens = ((m.structural | scalar_start) & ~in_string) | quotes;
+
+                if (positions_.size() < count_ + block_size) {
+                    positions_.resize(std::max(positions_.size() * 2, count_ + block_size));
+                }
+                auto out = positions_.data() + count_;
+                while (tokens) {
+                    *out++ = static_cast<uint32_t>(base + trailing_zeros(tokens));
+                    tokens &= tokens - 1;
+                }
+                count_ = static_cast<size_t>(out - positions_.data());
+            }
+
+            if (string_carry) {
+                return fail("unterminated string", size);
+            }
+            return true;
+        }
+
+        void structural_index::classify_scalar(const uint8_t *_block, block_masks &_masks) {
+            static const class_table table;
+            _masks = block_masks{0, 0, 0, 0, 0};
+            for (size_t i = 0; i < block_size; ++i) {
+                auto cls = table.cls[_block[i]];
+                if (!cls) continue;
+                auto bit = 1ULL << i;
+                if (cls & Quote) _masks.quote |= bit;
+                if (cls & Backslash) _masks.backslash |= bit;
+                if (cls & Whitespace) _masks.whitespace |= bit;
+                if (cls & Structural) _masks.structural |= bit;
+                if (cls & Control) _masks.control |= bit;
+            }
+        }
+
+#ifdef BP_JSON_SIMD_X86
+        __attribute__((target("sse4.2")))
+        void structural_index::classify_sse42(const uint8_t *_block, block_masks &_masks) {
+            _masks = block_masks{0, 0, 0, 0, 0};
+            for (unsigned i = 0; i < block_size; i += 16) {
+                auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_block + i));
+                // '[' and ']' differ from '{' and '}' only in 0x20 bit
+                auto folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+                auto structural = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+                        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+                auto whitespace = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+                auto control = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1F)), v);
+                _masks.quote |= mask(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << i;
+                _masks.backslash |= mask(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << i;
+                _masks.whitespace |= mask(whitespace) << i;
+                _masks.structural |= mask(structural) << i;
+                _masks.control |= mask(control) << i;
+            }
+        }
+
+        __attribute__((target("avx2")))
+        void structural_index::classify_avx2(const uint8_t *_block, block_masks &_masks) {
+            _masks = block_masks{0, 0, 0, 0, 0};
+            for (unsigned i = 0; i < block_size; i += 32) {
+                auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_block + i));
+                auto folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+                auto structural = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                                        _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')),
+                                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+                auto whitespace = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+                auto control = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1F)), v);
+                _masks.quote |= mask(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << i;
+                _masks.backslash |= mask(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << i;
+                _masks.whitespace |= mask(whitespace) << i;
+                _masks.structural |= mask(structural) << i;
+                _masks.control |= mask(control) << i;
+            }
+        }
+#endif
+    }
+}
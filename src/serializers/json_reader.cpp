@@ -0,0 +1,814 @@
+#include <cstring>
+#include "numbers.hpp"
+#include "serializers/json_reader.hpp"
+#include "string_pool.hpp"
+
+namespace bp {
+    namespace serializers {
+        using namespace serializable;
+
+        namespace {
+            inline bool is_digit(char _c) { return _c >= '0' && _c <= '9'; }
+
+            inline bool is_space(char _c) { return _c == ' ' || _c == '\t' || _c == '\n' || _c == '\r'; }
+
+            inline bool is_number_char(char _c) {
+                return is_digit(_c) || _c == '-' || _c == '+' || _c == '.' || _c == 'e' || _c == 'E';
+            }
+
+            inline int hex_digit(char _c) {
+                if (_c >= '0' && _c <= '9') return _c - '0';
+                if (_c >= 'a' && _c <= 'f') return _c - 'a' + 10;
+                if (_c >= 'A' && _c <= 'F') return _c - 'A' + 10;
+                return -1;
+            }
+
+            void append_utf8(std::string &_out, uint32_t _cp) {
+                if (_cp < 0x80) {
+                    _out += static_cast<char>(_cp);
+                } else if (_cp < 0x800) {
+                    _out += static_cast<char>(0xC0 | (_cp >> 6));
+                    _out += static_cast<char>(0x80 | (_cp & 0x3F));
+                } else if (_cp < 0x10000) {
+                    _out += static_cast<char>(0xE0 | (_cp >> 12));
+                    _out += static_cast<char>(0x80 | ((_cp >> 6) & 0x3F));
+                    _out += static_cast<char>(0x80 | (_cp & 0x3F));
+                } else {
+                    _out += static_cast<char>(0xF0 | (_cp >> 18));
+                    _out += static_cast<char>(0x80 | ((_cp >> 12) & 0x3F));
+                    _out += static_cast<char>(0x80 | ((_cp >> 6) & 0x3F));
+                    _out += static_cast<char>(0x80 | (_cp & 0x3F));
+                }
+            }
+
+            bool read_hex(const char *&_it, const char *_end, uint32_t &_cp) {
+                // _it points to 'u'
+                if (_end - _it < 5) return false;
+                _cp = 0;
+                for (int i = 1; i <= 4; ++i) {
+                    auto d = hex_digit(_it[i]);
+                    if (d < 0) return false;
+                    _cp = (_cp << 4) | static_cast<uint32_t>(d);
+                }
+                _it += 5;
+                return true;
+            }
+
+            /**
+             * Decode string contents with escape sequences
+             * @param _it start of string contents, set to failed escape on error
+             * @param _end closing quote
+             * @param _out decoded string is appended to it
+             * @return nullptr or error message
+             */
+            const char *unescape(const char *&_it, const char *_end, std::string &_out) {
+                while (_it != _end) {
+                    auto plain = static_cast<const char *>(std::memchr(_it, '\\',
+                                                                       static_cast<size_t>(_end - _it)));
+                    if (!plain) {
+                        _out.append(_it, _end);
+                        break;
+                    }
+                    _out.append(_it, plain);
+                    _it = plain + 1;
+                    switch (_it == _end ? '\0' : *_it) {
+                        case '"':
+                        case '\\':
+                        case '/':
+                            _out += *_it;
+                            break;
+                        case 'b':
+                            _out += '\b';
+                            break;
+                        case 'f':
+                            _out += '\f';
+                            break;
+                        case 'n':
+                            _out += '\n';
+                            break;
+                        case 'r':
+                            _out += '\r';
+                            break;
+                        case 't':
+                            _out += '\t';
+                            break;
+                        case 'u': {
+                            uint32_t cp;
+                            if (!read_hex(_it, _end, cp)) {
+                                return "invalid unicode escape";
+                            }
+                            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                                uint32_t low;
+                                if (_end - _it < 2 || _it[0] != '\\' || _it[1] != 'u') {
+                                    return "unpaired surrogate";
+                                }
+                                ++_it;
+                                if (!read_hex(_it, _end, low) || low < 0xDC00 || low > 0xDFFF) {
+                                    return "unpaired surrogate";
+                                }
+                                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                                return "unpaired surrogate";
+                            }
+                            append_utf8(_out, cp);
+                            continue;
+                        }
+                        default:
+                            return "invalid escape";
+                    }
+                    ++_it;
+                }
+                return nullptr;
+            }
+
+            /**
+             * Report number scanned from text. Integers are reported as such when they fit into 64 bits
+             */
+            void report_number(json_handler &_handler, const bp::decimal_number &_num, const char *_begin,
+                               const char *_end) {
+                if (!_num.fractional && !_num.truncated && !_num.exponent) {
+                    if (!_num.negative) {
+                        if (_num.mantissa > static_cast<uint64_t>(INT64_MAX)) {
+                            _handler.uint_value(_num.mantissa);
+                        } else {
+                            _handler.int_value(static_cast<int64_t>(_num.mantissa));
+                        }
+                        return;
+                    }
+                    if (_num.mantissa <= static_cast<uint64_t>(INT64_MAX) + 1) {
+                        _handler.int_value(static_cast<int64_t>(0 - _num.mantissa));
+                        return;
+                    }
+                }
+                _handler.double_value(bp::to_double(_num, _begin, _end));
+            }
+        }
+
+        tree_builder::tree_builder(bp::arena *_arena, bp::string_pool *_pool) : arena_(_arena), pool_(_pool) {}
+
+        bool tree_builder::start_object() {
+            frames_.emplace_back(items_.size(), keys_.size());
+            return true;
+        }
+
+        void tree_builder::end_object() {
+            auto frame = frames_.back();
+            frames_.pop_back();
+            auto obj = make_object(arena_);
+            obj->reserve(items_.size() - frame.first);
+            for (size_t i = frame.first, k = frame.second; i < items_.size(); ++i, ++k) {
+                // duplicate keys: last value wins
+                (*obj)[keys_[k]] = std::move(items_[i]);
+            }
+            items_.resize(frame.first);
+            keys_.resize(frame.second);
+            items_.push_back(make_tree(arena_, std::move(obj)));
+        }
+
+        bool tree_builder::start_array() {
+            frames_.emplace_back(items_.size(), keys_.size());
+            return true;
+        }
+
+        void tree_builder::end_array() {
+            auto frame = frames_.back();
+            frames_.pop_back();
+            auto arr = make_array(arena_);
+            arr->reserve(items_.size() - frame.first);
+            for (size_t i = frame.first; i < items_.size(); ++i) {
+                arr->push_back(std::move(items_[i]));
+            }
+            items_.resize(frame.first);
+            items_.push_back(make_tree(arena_, std::move(arr)));
+        }
+
+        bool tree_builder::key(bp::hash_type _hash, const bp::string_view &) {
+            keys_.push_back(_hash);
+            return true;
+        }
+
+        void tree_builder::null_value() {
+            items_.push_back(make_tree(arena_));
+        }
+
+        void tree_builder::bool_value(bool _val) {
+            items_.push_back(make_tree(arena_, _val));
+        }
+
+        void tree_builder::int_value(int64_t _val) {
+            items_.push_back(make_tree(arena_, _val));
+        }
+
+        void tree_builder::uint_value(uint64_t _val) {
+            items_.push_back(make_tree(arena_, _val));
+        }
+
+        void tree_builder::double_value(double _val) {
+            items_.push_back(make_tree(arena_, _val));
+        }
+
+        void tree_builder::string_value(const bp::string_view &_val) {
+            // strings with escapes are decoded outside of source
+            bool borrow = source_.size() && _val.data() >= source_.data() &&
+                          _val.data() + _val.size() <= source_.data() + source_.size();
+            items_.push_back(make_string_tree(arena_, pool_, _val, borrow));
+        }
+
+        tree_ptr tree_builder::release() {
+            tree_ptr root;
+            if (frames_.empty() && items_.size() == 1) {
+                root = std::move(items_.back());
+            }
+            clear();
+            return root;
+        }
+
+        void tree_builder::clear() {
+            items_.clear();
+            keys_.clear();
+            frames_.clear();
+        }
+
+        constexpr size_t json_reader::max_depth;
+
+        json_reader::json_reader(bp::arena *_arena, bp::string_pool *_pool) : builder_(_arena, _pool) {}
+
+        tree_ptr json_reader::parse(const bp::string_view &_s) ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error)) {
+            builder_.set_source(zero_copy_ ? _s : bp::string_view());
+#ifdef HAS_EXCEPTIONS
+            try {
+                parse(_s, builder_);
+            } catch (...) {
+                builder_.clear();
+                throw;
+            }
+            return builder_.release();
+#else
+            if (!parse(_s, builder_)) {
+                builder_.clear();
+                return nullptr;
+            }
+            return builder_.release();
+#endif
+        }
+
+        bool json_reader::parse(const bp::string_view &_s, json_handler &_handler)
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error)) {
+            begin_ = cur_ = _s.data();
+            end_ = _s.data() + _s.size();
+            handler_ = &_handler;
+            failed_ = false;
+            error_.clear();
+
+            if (!index_.build(_s)) {
+                cur_ = begin_ + index_.error_offset();
+                fail(index_.error());
+            } else {
+                tok_ = index_.begin();
+                tok_end_ = index_.end();
+                skip_ws();
+                if (parse_value(0)) {
+                    skip_ws();
+                    if (cur_ != end_) {
+                        fail("unexpected trailing characters");
+                    }
+                }
+            }
+            handler_ = nullptr;
+#ifdef HAS_EXCEPTIONS
+            if (failed_) {
+                throw structure::parse_error(error_.c_str());
+            }
+#endif
+            return !failed_;
+        }
+
+        bool json_reader::fail(const char *_msg) {
+            if (!failed_) {
+                failed_ = true;
+                error_ = _msg;
+                error_ += " at offset ";
+                error_ += std::to_string(cur_ - begin_);
+            }
+            return false;
+        }
+
+        bool json_reader::parse_value(size_t _depth) {
+            if (cur_ == end_) {
+                return fail("unexpected end of input");
+            }
+            switch (*cur_) {
+                case '{':
+                    return parse_object(_depth);
+                case '[':
+                    return parse_array(_depth);
+                case '"': {
+                    bp::string_view s;
+                    if (!parse_string(s)) return false;
+                    handler_->string_value(s);
+                    return true;
+                }
+                case 't':
+                    if (!parse_literal("true", 4)) return false;
+                    handler_->bool_value(true);
+                    return true;
+                case 'f':
+                    if (!parse_literal("false", 5)) return false;
+                    handler_->bool_value(false);
+                    return true;
+                case 'n':
+                    if (!parse_literal("null", 4)) return false;
+                    handler_->null_value();
+                    return true;
+                default:
+                    if (*cur_ == '-' || is_digit(*cur_)) {
+                        return parse_number();
+                    }
+                    return fail("unexpected character");
+            }
+        }
+
+        bool json_reader::parse_object(size_t _depth) {
+            if (_depth >= max_depth) {
+                return fail("nesting is too deep");
+            }
+            if (!handler_->start_object()) {
+                return skip_value();
+            }
+            ++cur_;
+            skip_ws();
+            if (cur_ != end_ && *cur_ == '}') {
+                ++cur_;
+            } else {
+                while (true) {
+                    skip_ws();
+                    if (cur_ == end_ || *cur_ != '"') {
+                        return fail("expected object key");
+                    }
+                    bp::string_view key;
+                    if (!parse_string(key)) return false;
+                    bool wanted = handler_->key(keys_.hash(key), key);
+                    skip_ws();
+                    if (cur_ == end_ || *cur_ != ':') {
+                        return fail("expected ':'");
+                    }
+                    ++cur_;
+                    skip_ws();
+                    if (cur_ == end_) {
+                        return fail("unexpected end of input");
+                    }
+                    if (!(wanted ? parse_value(_depth + 1) : skip_value())) return false;
+                    skip_ws();
+                    if (cur_ != end_ && *cur_ == ',') {
+                        ++cur_;
+                    } else if (cur_ != end_ && *cur_ == '}') {
+                        ++cur_;
+                        break;
+                    } else {
+                        return fail("expected ',' or '}'");
+                    }
+                }
+            }
+            handler_->end_object();
+            return true;
+        }
+
+        bool json_reader::parse_array(size_t _depth) {
+            if (_depth >= max_depth) {
+                return fail("nesting is too deep");
+            }
+            if (!handler_->start_array()) {
+                return skip_value();
+            }
+            ++cur_;
+            skip_ws();
+            if (cur_ != end_ && *cur_ == ']') {
+                ++cur_;
+            } else {
+                while (true) {
+                    skip_ws();
+                    if (!parse_value(_depth + 1)) return false;
+                    skip_ws();
+                    if (cur_ != end_ && *cur_ == ',') {
+                        ++cur_;
+                    } else if (cur_ != end_ && *cur_ == ']') {
+                        ++cur_;
+                        break;
+                    } else {
+                        return fail("expected ',' or ']'");
+                    }
+                }
+            }
+            handler_->end_array();
+            return true;
+        }
+
+        bool json_reader::skip_value() {
+            switch (*cur_) {
+                case '{':
+                case '[': {
+                    // strings are indexed by their quotes only, so brackets inside them are never counted
+                    size_t depth = 0;
+                    do {
+                        auto c = begin_[*tok_];
+                        if (c == '{' || c == '[') {
+                            ++depth;
+                        } else if (c == '}' || c == ']') {
+                            --depth;
+                        }
+                        ++tok_;
+                    } while (depth && tok_ != tok_end_);
+                    if (depth) {
+                        cur_ = end_;
+                        return fail("unexpected end of input");
+                    }
+                    cur_ = begin_ + tok_[-1] + 1;
+                    return true;
+                }
+                case '"':
+                    cur_ = begin_ + tok_[1] + 1;
+                    tok_ += 2;
+                    return true;
+                default:
+                    ++tok_;
+                    cur_ = tok_ != tok_end_ ? begin_ + *tok_ : end_;
+                    return true;
+            }
+        }
+
+        bool json_reader::parse_number() {
+            auto start = cur_;
+            bp::decimal_number num;
+            auto end = bp::scan_number(cur_, end_, num);
+            if (!end) {
+                return fail("invalid number");
+            }
+            cur_ = end;
+            if (!at_delimiter()) {
+                return fail("unexpected character");
+            }
+
+            report_number(*handler_, num, start, cur_);
+            return true;
+        }
+
+        bool json_reader::parse_literal(const char *_literal, size_t _size) {
+            if (static_cast<size_t>(end_ - cur_) < _size || std::memcmp(cur_, _literal, _size) != 0) {
+                return fail("invalid literal");
+            }
+            cur_ += _size;
+            if (!at_delimiter()) return fail("unexpected character");
+            return true;
+        }
+
+        bool json_reader::at_delimiter() const {
+            if (cur_ == end_) return true;
+            switch (*cur_) {
+                case ' ':
+                case '\t':
+                case '\n':
+                case '\r':
+                case ',':
+                case ':':
+                case '[':
+                case ']':
+                case '{':
+                case '}':
+                case '"':
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        bool json_reader::parse_string(bp::string_view &_out) {
+            // index holds both quotes, control characters and unterminated strings are rejected while indexing
+            auto start = cur_ + 1;
+            auto close = begin_ + tok_[1];
+            tok_ += 2;
+            if (!std::memchr(start, '\\', static_cast<size_t>(close - start))) {
+                _out = bp::string_view(start, static_cast<size_t>(close - start));
+                cur_ = close + 1;
+                return true;
+            }
+
+            cur_ = start;
+            scratch_.clear();
+            if (auto err = unescape(cur_, close, scratch_)) {
+                return fail(err);
+            }
+            cur_ = close + 1;
+            _out = bp::string_view(scratch_.data(), scratch_.size());
+            return true;
+        }
+
+        json_push_parser::json_push_parser(bp::arena *_arena, bp::string_pool *_pool)
+                : handler_(&builder_), arena_(_arena), builder_(_arena, _pool) {}
+
+        json_push_parser::json_push_parser(json_handler &_handler) : handler_(&_handler), arena_(nullptr) {}
+
+        push_status json_push_parser::feed(const bp::string_view &_chunk)
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error)) {
+            if (state_ == state::Done || state_ == state::Failed) {
+                consumed_ = 0;
+                return status();
+            }
+            chunk_ = _chunk.data();
+            auto end = chunk_ + _chunk.size();
+            auto it = run(chunk_, end);
+            if (state_ != state::Failed) {
+                consumed_ = static_cast<size_t>(it - chunk_);
+                offset_ += consumed_;
+                if (state_ == state::String || state_ == state::Number) {
+                    // chunk is not referenced after return
+                    token_.append(mark_ ? mark_ : chunk_, end);
+                    mark_ = nullptr;
+                }
+            }
+            chunk_ = nullptr;
+            return status();
+        }
+
+        push_status json_push_parser::finish() ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error)) {
+            if (state_ == state::Number && frames_.empty()) {
+                end_number(nullptr);
+            } else if (state_ == state::Value && frames_.empty()) {
+                return push_status::NeedMore;
+            } else if (state_ != state::Done && state_ != state::Failed) {
+                fail("unexpected end of input", nullptr);
+            }
+            return status();
+        }
+
+        bool json_push_parser::take(structure &_out) {
+            if (state_ != state::Done || handler_ != &builder_) {
+                return false;
+            }
+            _out = structure(builder_.release(), arena_);
+            reset();
+            return true;
+        }
+
+        void json_push_parser::reset() {
+            builder_.clear();
+            state_ = state::Value;
+            frames_.clear();
+            skip_depth_ = SIZE_MAX;
+            skip_value_ = false;
+            escape_ = false;
+            mark_ = nullptr;
+            token_.clear();
+            offset_ = 0;
+            error_.clear();
+        }
+
+        const char *json_push_parser::run(const char *_it, const char *_end) {
+            while (_it != _end) {
+                // states up to AfterValue are between tokens
+                if (state_ <= state::AfterValue && is_space(*_it)) {
+                    ++_it;
+                    continue;
+                }
+                switch (state_) {
+                    case state::Value:
+                        switch (*_it) {
+                            case '{':
+                            case '[':
+                                if (!open(_it)) return _it;
+                                ++_it;
+                                continue;
+                            case '"':
+                                key_ = false;
+                                escaped_ = false;
+                                state_ = state::String;
+                                mark_ = ++_it;
+                                continue;
+                            case 't':
+                                literal_ = "true";
+                                break;
+                            case 'f':
+                                literal_ = "false";
+                                break;
+                            case 'n':
+                                literal_ = "null";
+                                break;
+                            default:
+                                if (*_it == '-' || is_digit(*_it)) {
+                                    state_ = state::Number;
+                                    mark_ = _it;
+                                    continue;
+                                }
+                                fail("unexpected character", _it);
+                                return _it;
+                        }
+                        literal_pos_ = 0;
+                        state_ = state::Literal;
+                        continue;
+                    case state::ArrayFirst:
+                        if (*_it == ']') {
+                            close();
+                            ++_it;
+                        } else {
+                            state_ = state::Value;
+                        }
+                        continue;
+                    case state::ObjectFirst:
+                    case state::Key:
+                        if (*_it == '"') {
+                            key_ = true;
+                            escaped_ = false;
+                            state_ = state::String;
+                            mark_ = ++_it;
+                        } else if (*_it == '}' && state_ == state::ObjectFirst) {
+                            close();
+                            ++_it;
+                        } else {
+                            fail("expected object key", _it);
+                            return _it;
+                        }
+                        continue;
+                    case state::Colon:
+                        if (*_it != ':') {
+                            fail("expected ':'", _it);
+                            return _it;
+                        }
+                        state_ = state::Value;
+                        ++_it;
+                        continue;
+                    case state::AfterValue: {
+                        auto object = frames_.back() == '{';
+                        if (*_it == ',') {
+                            state_ = object ? state::Key : state::Value;
+                        } else if (*_it == (object ? '}' : ']')) {
+                            close();
+                        } else {
+                            fail(object ? "expected ',' or '}'" : "expected ',' or ']'", _it);
+                            return _it;
+                        }
+                        ++_it;
+                        continue;
+                    }
+                    case state::String: {
+                        auto p = _it;
+                        for (; p != _end; ++p) {
+                            if (escape_) {
+                                escape_ = false;
+                            } else if (*p == '"') {
+                                break;
+                            } else if (*p == '\\') {
+                                escape_ = escaped_ = true;
+                            } else if (static_cast<unsigned char>(*p) < 0x20) {
+                                fail("control character in string", p);
+                                return p;
+                            }
+                        }
+                        if (p == _end || !end_string(p)) return p;
+                        _it = p + 1;
+                        continue;
+                    }
+                    case state::Number: {
+                        auto p = _it;
+                        while (p != _end && is_number_char(*p)) ++p;
+                        if (p == _end || !end_number(p)) return p;
+                        // delimiter is handled by next state
+                        _it = p;
+                        continue;
+                    }
+                    case state::Literal:
+                        if (*_it != literal_[literal_pos_]) {
+                            fail("invalid literal", _it);
+                            return _it;
+                        }
+                        ++_it;
+                        if (literal_[++literal_pos_] == '\0') {
+                            if (!quiet()) {
+                                if (literal_[0] == 'n') {
+                                    handler_->null_value();
+                                } else {
+                                    handler_->bool_value(literal_[0] == 't');
+                                }
+                            }
+                            end_value();
+                        }
+                        continue;
+                    default:
+                        return _it;
+                }
+            }
+            return _it;
+        }
+
+        bool json_push_parser::open(const char *_at) {
+            if (frames_.size() >= json_reader::max_depth) {
+                return fail("nesting is too deep", _at);
+            }
+            // value skipped by handler or container refused by it is consumed without reporting
+            bool skip = skip_value_ || (frames_.size() < skip_depth_ &&
+                                        !(*_at == '{' ? handler_->start_object() : handler_->start_array()));
+            frames_ += *_at;
+            skip_value_ = false;
+            if (skip) {
+                skip_depth_ = frames_.size();
+            }
+            state_ = *_at == '{' ? state::ObjectFirst : state::ArrayFirst;
+            return true;
+        }
+
+        void json_push_parser::close() {
+            bool silent = frames_.size() >= skip_depth_;
+            if (frames_.size() == skip_depth_) {
+                skip_depth_ = SIZE_MAX;
+            }
+            auto bracket = frames_.back();
+            frames_.pop_back();
+            if (!silent) {
+                if (bracket == '{') {
+                    handler_->end_object();
+                } else {
+                    handler_->end_array();
+                }
+            }
+            end_value();
+        }
+
+        bool json_push_parser::end_string(const char *_end) {
+            auto s = token(_end);
+            if (escaped_) {
+                scratch_.clear();
+                auto it = s.data();
+                if (auto err = unescape(it, s.data() + s.size(), scratch_)) {
+                    return fail(err, _end);
+                }
+                s = bp::string_view(scratch_.data(), scratch_.size());
+            }
+            if (key_) {
+                if (!quiet()) {
+                    skip_value_ = !handler_->key(keys_.hash(s), s);
+                }
+                state_ = state::Colon;
+            } else {
+                if (!quiet()) {
+                    handler_->string_value(s);
+                }
+                end_value();
+            }
+            token_.clear();
+            mark_ = nullptr;
+            return true;
+        }
+
+        bool json_push_parser::end_number(const char *_end) {
+            auto s = token(_end);
+            bp::decimal_number num;
+            if (bp::scan_number(s.data(), s.data() + s.size(), num) != s.data() + s.size()) {
+                return fail("invalid number", _end);
+            }
+            if (!quiet()) {
+                report_number(*handler_, num, s.data(), s.data() + s.size());
+            }
+            end_value();
+            token_.clear();
+            mark_ = nullptr;
+            return true;
+        }
+
+        bp::string_view json_push_parser::token(const char *_end) {
+            if (mark_) {
+                return bp::string_view(mark_, static_cast<size_t>(_end - mark_));
+            }
+            if (_end != chunk_) {
+                token_.append(chunk_, _end);
+            }
+            return bp::string_view(token_.data(), token_.size());
+        }
+
+        void json_push_parser::end_value() {
+            skip_value_ = false;
+            state_ = frames_.empty() ? state::Done : state::AfterValue;
+        }
+
+        bool json_push_parser::fail(const char *_msg, const char *_at) {
+            state_ = state::Failed;
+            consumed_ = static_cast<size_t>(_at - chunk_);
+            error_ = _msg;
+            error_ += " at offset ";
+            error_ += std::to_string(offset_ + consumed_);
+            return false;
+        }
+
+        push_status json_push_parser::status() ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error)) {
+            switch (state_) {
+                case state::Done:
+                    return push_status::Complete;
+                case state::Failed:
+#ifdef HAS_EXCEPTIONS
+                    throw structure::parse_error(error_.c_str());
+#else
+                    return push_status::Error;
+#endif
+                default:
+                    return push_status::NeedMore;
+            }
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#include <cstring>
+#include "serializers/json.hpp"
+#include "serializers/json_tape.hpp"
+#include "string_pool.hpp"
+
+namespace bp {
+    namespace serializers {
+        using namespace serializable;
+
+        json_tape::json_tape(bp::arena *_arena, bp::string_pool *_pool) :
+                arena_(_arena), pool_(_pool), reader_(_arena, _pool) {}
+
+        tree_ptr json_tape::parse(const bp::string_view &_s, bp::arena *_arena, bp::string_pool *_pool, bool _zero_copy)
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error)) {
+            auto tape = bp::make_intrusive<json_tape>(nullptr, _arena, _pool);
+            // default handler reports nothing, document is only validated
+            json_handler validator;
+            if (!tape->reader_.parse(_s, validator)) {
+                return nullptr;
+            }
+
+            auto &index = tape->reader_.index();
+            tape->zero_copy_ = _zero_copy;
+            if (_zero_copy) {
+                tape->text_ = _s.data();
+            } else {
+                tape->copy_.assign(_s.data(), _s.size());
+                tape->text_ = tape->copy_.data();
+            }
+            tape->size_ = _s.size();
+            tape->offsets_.assign(index.begin(), index.end());
+            tape->jumps_.resize(index.size());
+            std::vector<uint32_t> open;
+            for (uint32_t i = 0; i < tape->offsets_.size(); ++i) {
+                switch (tape->token(i)) {
+                    case '{':
+                    case '[':
+                        open.push_back(i);
+                        break;
+                    case '}':
+                    case ']':
+                        tape->jumps_[open.back()] = i;
+                        open.pop_back();
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            uint32_t root = 0;
+            return tape->value(root);
+        }
+
+        void json_tape::materialize(uint32_t _index, tree &_out) const {
+            auto i = _index + 1;
+            if (token(_index) == '{') {
+                auto obj = make_object(arena_);
+                while (token(i) != '}') {
+                    auto k = key(i);
+                    // key quotes and colon
+                    i += 3;
+                    // duplicate keys: last value wins
+                    (*obj)[k] = value(i);
+                    if (token(i) == ',') ++i;
+                }
+                _out = tree(std::move(obj));
+            } else {
+                auto arr = make_array(arena_);
+                while (token(i) != ']') {
+                    arr->push_back(value(i));
+                    if (token(i) == ',') ++i;
+                }
+                _out = tree(std::move(arr));
+            }
+        }
+
+        bp::string_view json_tape::text(uint32_t _index) const {
+            auto begin = offsets_[_index];
+            return bp::string_view(text_ + begin, offsets_[jumps_[_index]] - begin + 1);
+        }
+
+        bp::hash_type json_tape::format() const {
+            return Json;
+        }
+
+        tree_ptr json_tape::value(uint32_t &_index) const {
+            auto begin = offsets_[_index];
+            switch (text_[begin]) {
+                case '{':
+                case '[': {
+                    auto node = make_tree(arena_, raw_ptr(this), _index,
+                                          text_[begin] == '{' ? tree::kind::Object : tree::kind::Array);
+                    _index = jumps_[_index] + 1;
+                    return node;
+                }
+                case '"': {
+                    auto end = offsets_[_index + 1];
+                    _index += 2;
+                    auto s = text_ + begin + 1;
+                    if (!std::memchr(s, '\\', end - begin - 1)) {
+                        return make_string_tree(arena_, pool_, bp::string_view(s, end - begin - 1), zero_copy_);
+                    }
+                    return reader_.parse(bp::string_view(text_ + begin, end - begin + 1));
+                }
+                case 't':
+                    ++_index;
+                    return make_tree(arena_, true);
+                case 'f':
+                    ++_index;
+                    return make_tree(arena_, false);
+                case 'n':
+                    ++_index;
+                    return make_tree(arena_);
+                default: {
+                    ++_index;
+                    auto end = _index < offsets_.size() ? offsets_[_index] : size_;
+                    return reader_.parse(bp::string_view(text_ + begin, end - begin));
+                }
+            }
+        }
+
+        hash_type json_tape::key(uint32_t _index) const {
+            auto begin = offsets_[_index] + 1;
+            auto end = offsets_[_index + 1];
+            auto s = text_ + begin;
+            if (!std::memchr(s, '\\', end - begin)) {
+                return keys_.hash(bp::string_view(s, end - begin));
+            }
+            auto name = reader_.parse(bp::string_view(s - 1, end - begin + 2));
+            return bp::symbol(bp::string_view(name->str_data(), name->str_size())).to_hash();
+        }
+    }
+}
@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "numbers.hpp"
+#include "serializers/json.hpp"
+#include "serializers/json_writer.hpp"
+
+namespace bp {
+    namespace serializers {
+
+        namespace {
+            // rough size of formatted number, key with quotes and separators
+            constexpr size_t number_estimate = 12;
+            constexpr size_t key_estimate = 12;
+
+            /**
+             * Format number as written to JSON
+             * @param _v integer or floating point value
+             * @param _buf buffer of max_number_chars bytes
+             * @return end of text
+             */
+            char *format_number(const structure_view &_v, char *_buf) {
+                if (_v.is_int()) {
+                    return _v.is_uint64() ? bp::format_uint(_buf, _v.as<uint64_t>()) : bp::format_int(_buf, _v.as<int64_t>());
+                }
+                auto val = _v.as<double>();
+                if (!std::isfinite(val)) {
+                    // JSON has no representation for NaN and infinity
+                    std::memcpy(_buf, "null", 4);
+                    return _buf + 4;
+                }
+                // width of node is its storage encoding only, shortest float text would not read back as same double
+                auto end = bp::format_double(_buf, val);
+                if (!std::memchr(_buf, '.', static_cast<size_t>(end - _buf)) && !std::memchr(_buf, 'e', static_cast<size_t>(end - _buf))) {
+                    // keep integral floats floating point when read back
+                    *end++ = '.';
+                    *end++ = '0';
+                }
+                return end;
+            }
+
+            /**
+             * Get length of string with quotes and escape sequences
+             */
+            size_t string_size(const char *_data, size_t _size) {
+                size_t size = _size + 2;
+                for (size_t i = 0; i < _size; ++i) {
+                    auto c = static_cast<unsigned char>(_data[i]);
+                    if (c >= 0x20 && c != '"' && c != '\\') continue;
+                    switch (c) {
+                        case '"':
+                        case '\\':
+                        case '\n':
+                        case '\r':
+                        case '\t':
+                        case '\b':
+                        case '\f':
+                            size += 1;
+                            break;
+                        default:
+                            size += 5;
+                            break;
+                    }
+                }
+                return size;
+            }
+
+            /**
+             * Sink copying text into fixed buffer
+             */
+            class buffer_sink : public json_sink {
+            public:
+                buffer_sink(char *_buf, size_t _size) : it_(_buf), end_(_buf + _size) {}
+
+                bool write(const char *_data, size_t _size) override {
+                    if (_size > static_cast<size_t>(end_ - it_)) {
+                        return false;
+                    }
+                    std::memcpy(it_, _data, _size);
+                    it_ += _size;
+                    return true;
+                }
+
+            private:
+                char *it_;
+                char *end_;
+            };
+        }
+
+        json_writer::json_writer(std::string &_out, style _style, unsigned _indent) :
+                out_(_out), style_(_style), indent_(_indent) {}
+
+        json_writer::json_writer(json_sink &_sink, style _style, unsigned _indent, size_t _flush_size) :
+                out_(buffer_), style_(_style), indent_(_indent), sink_(&_sink), flush_size_(_flush_size) {
+            buffer_.reserve(_flush_size);
+        }
+
+        bool json_writer::write(const structure_view &_v) {
+            if (sink_) {
+                write_value(_v, 0);
+                flush();
+                return !failed_;
+            }
+            out_.reserve(out_.size() + estimate_size(_v));
+            write_value(_v, 0);
+            return true;
+        }
+
+        void json_writer::flush() {
+            if (!failed_ && !buffer_.empty() && !sink_->write(buffer_.data(), buffer_.size())) {
+                // rest of document is dropped
+                failed_ = true;
+            }
+            buffer_.clear();
+        }
+
+        size_t json_writer::estimate_size(const structure_view &_v) {
+            auto raw = _v.raw(Json);
+            if (raw.size()) {
+                return raw.size();
+            }
+            switch (_v.type()) {
+                case structure::value_type::Object: {
+                    size_t size = 2;
+                    for (auto item: _v.as_object()) {
+                        size += key_estimate + estimate_size(item.second);
+                    }
+                    return size;
+                }
+                case structure::value_type::Array: {
+                    size_t size = 2;
+                    for (auto item: _v.as_array()) {
+                        size += 1 + estimate_size(item);
+                    }
+                    return size;
+                }
+                case structure::value_type::String:
+                    return _v.str_size() + 2;
+                case structure::value_type::Int:
+                case structure::value_type::Float:
+                    return number_estimate;
+                default:
+                    return 5;
+            }
+        }
+
+        size_t json_writer::measure(const structure_view &_v) {
+            auto raw = _v.raw(Json);
+            if (raw.size()) {
+                return raw.size();
+            }
+            switch (_v.type()) {
+                case structure::value_type::Object: {
+                    size_t size = 1;
+                    for (auto item: _v.as_object()) {
+                        auto key = bp::sym_name(item.first);
+                        // key, colon and comma or closing brace
+                        size += string_size(key.data(), key.size()) + 2 + measure(item.second);
+                    }
+                    return std::max<size_t>(size, 2);
+                }
+                case structure::value_type::Array: {
+                    size_t size = 1;
+                    for (auto item: _v.as_array()) {
+                        size += 1 + measure(item);
+                    }
+                    return std::max<size_t>(size, 2);
+                }
+                case structure::value_type::String:
+                    return string_size(_v.str_data(), _v.str_size());
+                case structure::value_type::Int:
+                case structure::value_type::Float: {
+                    char buf[bp::max_number_chars];
+                    return static_cast<size_t>(format_number(_v, buf) - buf);
+                }
+                case structure::value_type::Bool:
+                    return _v.as<bool>() ? 4 : 5;
+                default:
+                    return 4;
+            }
+        }
+
+        void json_writer::write_value(const structure_view &_v, unsigned _level) {
+            if (sink_ && out_.size() >= flush_size_) {
+                flush();
+            }
+            if (style_ == style::Compact) {
+                // lazily parsed container nobody has touched is copied as is
+                auto raw = _v.raw(Json);
+                if (raw.size()) {
+                    out_.append(raw.data(), raw.size());
+                    return;
+                }
+            }
+            switch (_v.type()) {
+                case structure::value_type::Object: {
+                    out_ += '{';
+                    bool first = true;
+                    _v.for_each_sorted([&](const bp::hash_type &_key, const structure_view &_item) {
+                        if (!first) out_ += ',';
+                        first = false;
+                        new_line(_level + 1);
+                        auto key = bp::sym_name(_key);
+                        write_string(key.data(), key.size());
+                        out_ += ':';
+                        if (style_ == style::Pretty) out_ += ' ';
+                        write_value(_item, _level + 1);
+                    });
+                    if (!first) new_line(_level);
+                    out_ += '}';
+                    break;
+                }
+                case structure::value_type::Array: {
+                    out_ += '[';
+                    bool first = true;
+                    for (auto item: _v.as_array()) {
+                        if (!first) out_ += ',';
+                        first = false;
+                        new_line(_level + 1);
+                        write_value(item, _level + 1);
+                    }
+                    if (!first) new_line(_level);
+                    out_ += ']';
+                    break;
+                }
+                case structure::value_type::String:
+                    write_string(_v.str_data(), _v.str_size());
+                    break;
+                case structure::value_type::Int:
+                case structure::value_type::Float:
+                    write_number(_v);
+                    break;
+                case structure::value_type::Bool:
+                    out_ += _v.as<bool>() ? "true" : "false";
+                    break;
+                default:
+                    out_ += "null";
+                    break;
+            }
+        }
+
+        void json_writer::write_string(const char *_data, size_t _size) {
+            static const char hex[] = "0123456789abcdef";
+            out_ += '"';
+            size_t plain = 0;
+            for (size_t i = 0; i < _size; ++i) {
+                auto c = static_cast<unsigned char>(_data[i]);
+                if (c >= 0x20 && c != '"' && c != '\\') continue;
+                out_.append(_data + plain, i - plain);
+                plain = i + 1;
+                switch (c) {
+                    case '"':
+                        out_ += "\\\"";
+                        break;
+                    case '\\':
+                        out_ += "\\\\";
+                        break;
+                    case '\n':
+                        out_ += "\\n";
+                        break;
+                    case '\r':
+                        out_ += "\\r";
+                        break;
+                    case '\t':
+                        out_ += "\\t";
+                        break;
+                    case '\b':
+                        out_ += "\\b";
+                        break;
+                    case '\f':
+                        out_ += "\\f";
+                        break;
+                    default: {
+                        char esc[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                        out_.append(esc, sizeof(esc));
+                        break;
+                    }
+                }
+            }
+            out_.append(_data + plain, _size - plain);
+            out_ += '"';
+        }
+
+        void json_writer::write_number(const structure_view &_v) {
+            char buf[bp::max_number_chars];
+            out_.append(buf, format_number(_v, buf));
+        }
+
+        std::string to_json(const structure_view &_v, json_writer::style _style) {
+            std::string out;
+            json_writer(out, _style).write(_v);
+            return out;
+        }
+
+        size_t to_json(const structure_view &_v, char *_buf, size_t _size) {
+            auto size = json_writer::measure(_v);
+            if (size <= _size) {
+                buffer_sink sink(_buf, _size);
+                json_writer(sink).write(_v);
+            }
+            return size;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#include "serializers/key_cache.hpp"
+
+namespace bp {
+    namespace serializers {
+
+        constexpr size_t key_cache::default_slots;
+        constexpr size_t key_cache::max_key_size;
+
+        key_cache::key_cache(size_t _slots) : size_(2), shift_(63) {
+            while (size_ < _slots) {
+                size_ <<= 1;
+                --shift_;
+            }
+        }
+
+        double key_cache::hit_rate() const {
+            auto total = hits_ + misses_;
+            return total ? static_cast<double>(hits_) / static_cast<double>(total) : 0.0;
+        }
+
+        void key_cache::reset_stats() {
+            hits_ = 0;
+            misses_ = 0;
+        }
+
+        void key_cache::clear() {
+            slots_.reset();
+        }
+
+        bp::hash_type key_cache::insert(const bp::string_view &_key) {
+            ++misses_;
+            // symbol registers key name for reverse lookup
+            auto hash = bp::symbol(_key).to_hash();
+            if (_key.size() > max_key_size) {
+                return hash;
+            }
+            if (!slots_) {
+                slots_.reset(new entry[size_]);
+                for (size_t i = 0; i < size_; ++i) {
+                    slots_[i].size = max_key_size + 1;
+                }
+            }
+            auto &e = slots_[slot(_key)];
+            e.size = static_cast<uint32_t>(_key.size());
+            e.hash = hash;
+            std::memcpy(e.key, _key.data(), _key.size());
+            return hash;
+        }
+    }
+}
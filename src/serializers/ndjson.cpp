@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include "serializers/ndjson.hpp"
+#include "serializers/json_writer.hpp"
+
+namespace bp {
+    namespace serializers {
+
+        namespace {
+            // RFC 7464 record separator
+            constexpr char record_separator = '\x1e';
+        }
+
+        constexpr size_t ndjson_reader::default_buffer_size;
+        constexpr size_t ndjson_reader::default_max_record_size;
+        constexpr size_t ndjson_writer::default_flush_size;
+
+        ndjson_reader::ndjson_reader(size_t _buffer_size, size_t _max_record_size) :
+                buffer_(std::max<size_t>(std::min(_buffer_size, _max_record_size), 1)),
+                max_record_size_(_max_record_size), reader_(&arena_) {}
+
+        ndjson_reader::ndjson_reader(int _fd, size_t _buffer_size, size_t _max_record_size) :
+                ndjson_reader(_buffer_size, _max_record_size) {
+            fd_ = _fd;
+        }
+
+        ndjson_reader::ndjson_reader(FILE *_file, size_t _buffer_size, size_t _max_record_size) :
+                ndjson_reader(_buffer_size, _max_record_size) {
+            file_ = _file;
+        }
+
+        ndjson_reader::ndjson_reader(std::istream &_stream, size_t _buffer_size, size_t _max_record_size) :
+                ndjson_reader(_buffer_size, _max_record_size) {
+            stream_ = &_stream;
+        }
+
+        void ndjson_reader::set_string_pool(bp::string_pool *_pool) {
+            reader_ = json_reader(&arena_, _pool);
+        }
+
+        bool ndjson_reader::next(structure &_out) ENABLE_IF_HAS_EXCEPTIONS(throw (structure::parse_error)) {
+            // previous record must release its nodes before arena is recycled
+            _out = structure();
+            arena_.release();
+            if (!error_.empty()) {
+                return false;
+            }
+
+            while (true) {
+                auto data = buffer_.data();
+                auto nl = static_cast<const char *>(std::memchr(data + begin_ + scanned_, '\n', end_ - begin_ - scanned_));
+                size_t stop;
+                if (nl) {
+                    stop = static_cast<size_t>(nl - data);
+                } else {
+                    scanned_ = end_ - begin_;
+                    if (!eof_ && fill()) continue;
+                    if (!error_.empty()) {
+#ifdef HAS_EXCEPTIONS
+                        throw structure::parse_error(error_.c_str());
+#endif
+                        return false;
+                    }
+                    if (begin_ == end_) {
+                        return false;
+                    }
+                    // last record is not terminated
+                    stop = end_;
+                }
+
+                ++line_;
+                auto first = data + begin_;
+                auto last = data + stop;
+                begin_ = std::min(stop + 1, end_);
+                scanned_ = 0;
+                while (first != last && (*first == record_separator || *first == ' ' || *first == '\t' ||
+                                         *first == '\r')) {
+                    ++first;
+                }
+                if (first == last) {
+                    continue;
+                }
+
+                serializable::tree_ptr root;
+#ifdef HAS_EXCEPTIONS
+                try {
+                    root = reader_.parse(bp::string_view(first, static_cast<size_t>(last - first)));
+                } catch (structure::parse_error &_e) {
+                    throw structure::parse_error(("line " + std::to_string(line_) + ": " + _e.what()).c_str());
+                }
+#else
+                root = reader_.parse(bp::string_view(first, static_cast<size_t>(last - first)));
+                if (!root) {
+                    return fail("line " + std::to_string(line_) + ": " + reader_.error());
+                }
+#endif
+                _out = structure(std::move(root), &arena_);
+                return true;
+            }
+        }
+
+        bool ndjson_reader::fill() {
+            auto size = end_ - begin_;
+            if (begin_) {
+                std::memmove(buffer_.data(), buffer_.data() + begin_, size);
+                begin_ = 0;
+                end_ = size;
+            }
+            if (end_ == buffer_.size()) {
+                if (buffer_.size() >= max_record_size_) {
+                    return fail("line " + std::to_string(line_ + 1) + ": record is too long");
+                }
+                buffer_.resize(std::min(buffer_.size() * 2, max_record_size_));
+            }
+
+            auto dst = buffer_.data() + end_;
+            auto room = buffer_.size() - end_;
+            size_t n = 0;
+            if (stream_) {
+                stream_->read(dst, static_cast<std::streamsize>(room));
+                n = static_cast<size_t>(stream_->gcount());
+                if (!n && stream_->bad()) {
+                    return fail("read failed");
+                }
+            } else if (file_) {
+                n = std::fread(dst, 1, room, file_);
+                if (!n && std::ferror(file_)) {
+                    return fail("read failed");
+                }
+            } else {
+                ssize_t res;
+                do {
+                    res = ::read(fd_, dst, room);
+                } while (res < 0 && errno == EINTR);
+                if (res < 0) {
+                    return fail(std::string("read failed: ") + std::strerror(errno));
+                }
+                n = static_cast<size_t>(res);
+            }
+            if (!n) {
+                eof_ = true;
+                return false;
+            }
+            end_ += n;
+            return true;
+        }
+
+        bool ndjson_reader::fail(const std::string &_msg) {
+            error_ = _msg;
+            return false;
+        }
+
+        ndjson_writer::ndjson_writer(json_framing _framing, size_t _flush_size) :
+                framing_(_framing), flush_size_(_flush_size) {
+            buffer_.reserve(_flush_size);
+        }
+
+        ndjson_writer::ndjson_writer(int _fd, json_framing _framing, size_t _flush_size) :
+                ndjson_writer(_framing, _flush_size) {
+            fd_ = _fd;
+        }
+
+        ndjson_writer::ndjson_writer(FILE *_file, json_framing _framing, size_t _flush_size) :
+                ndjson_writer(_framing, _flush_size) {
+            file_ = _file;
+        }
+
+        ndjson_writer::ndjson_writer(std::ostream &_stream, json_framing _framing, size_t _flush_size) :
+                ndjson_writer(_framing, _flush_size) {
+            stream_ = &_stream;
+        }
+
+        ndjson_writer::~ndjson_writer() {
+            if (write_out()) {
+                if (file_) std::fflush(file_);
+                if (stream_) stream_->flush();
+            }
+        }
+
+        bool ndjson_writer::write(const structure_view &_record)
+                ENABLE_IF_HAS_EXCEPTIONS(throw (structure::structure_error)) {
+            if (framing_ == json_framing::Sequence) {
+                buffer_ += record_separator;
+            }
+            json_writer(buffer_).write(_record);
+            buffer_ += '\n';
+            if (buffer_.size() >= flush_size_ && !write_out()) {
+#ifdef HAS_EXCEPTIONS
+                throw structure::structure_error("write failed");
+#endif
+                return false;
+            }
+            return true;
+        }
+
+        bool ndjson_writer::flush() ENABLE_IF_HAS_EXCEPTIONS(throw (structure::structure_error)) {
+            bool ok = write_out();
+            if (ok && file_) {
+                ok = std::fflush(file_) == 0;
+            }
+            if (ok && stream_) {
+                ok = static_cast<bool>(stream_->flush());
+            }
+#ifdef HAS_EXCEPTIONS
+            if (!ok) {
+                throw structure::structure_error("write failed");
+            }
+#endif
+            return ok;
+        }
+
+        bool ndjson_writer::write_out() noexcept {
+            if (buffer_.empty()) {
+                return true;
+            }
+            bool ok;
+            if (stream_) {
+                ok = static_cast<bool>(stream_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size())));
+            } else if (file_) {
+                ok = std::fwrite(buffer_.data(), 1, buffer_.size(), file_) == buffer_.size();
+            } else {
+                size_t done = 0;
+                while (done < buffer_.size()) {
+                    auto res = ::write(fd_, buffer_.data() + done, buffer_.size() - done);
+                    if (res < 0) {
+                        if (errno == EINTR) continue;
+                        break;
+                    }
+                    done += static_cast<size_t>(res);
+                }
+                ok = done == buffer_.size();
+            }
+            // capacity is kept for next records
+            buffer_.clear();
+            return ok;
+        }
+    }
+}
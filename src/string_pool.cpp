@@ -0,0 +1,76 @@
+#include "string_pool.hpp"
+#include <atomic>
+
+namespace {
+    std::atomic<uint32_t> next_pool_id(1);
+}
+
+bp::string_pool::string_pool(size_t _max_length, bp::arena *_arena) :
+        max_length_(_max_length), arena_(_arena), id_(next_pool_id.fetch_add(1, std::memory_order_relaxed)) {}
+
+uint32_t bp::string_pool::hash(const bp::string_view &_s) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < _s.size(); ++i) {
+        h ^= static_cast<uint8_t>(_s.data()[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+size_t bp::string_pool::find_slot(const bp::string_view &_s, uint32_t _hash) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t i = _hash & mask;; i = (i + 1) & mask) {
+        const auto &s = slots_[i];
+        if (!s.str || (s.hash == _hash && s.str->view() == _s)) {
+            return i;
+        }
+    }
+}
+
+void bp::string_pool::grow() {
+    std::vector<slot> old(slots_.empty() ? 16 : slots_.size() * 2);
+    old.swap(slots_);
+    for (auto &s: old) {
+        if (s.str) {
+            slots_[find_slot(s.str->view(), s.hash)] = std::move(s);
+        }
+    }
+}
+
+bp::serializable::string_ptr bp::string_pool::intern(const bp::string_view &_s) {
+    // keep load factor under 3/4
+    if ((size_ + 1) * 4 > slots_.size() * 3) {
+        grow();
+    }
+    auto h = hash(_s);
+    auto &s = slots_[find_slot(_s, h)];
+    if (!s.str) {
+        s.str = serializable::string_node::create(_s.data(), _s.size(), arena_, id_);
+        if (!s.str) return nullptr;
+        s.hash = h;
+        ++size_;
+    }
+    return s.str;
+}
+
+bp::serializable::string_ptr bp::string_pool::find(const bp::string_view &_s) const {
+    if (slots_.empty()) return nullptr;
+    return slots_[find_slot(_s, hash(_s))].str;
+}
+
+size_t bp::string_pool::collect() {
+    std::vector<slot> old(slots_.size());
+    old.swap(slots_);
+    size_t dropped = 0;
+    for (auto &s: old) {
+        if (!s.str) continue;
+        if (s.str.use_count() == 1) {
+            ++dropped;
+        } else {
+            slots_[find_slot(s.str->view(), s.hash)] = std::move(s);
+        }
+    }
+    size_ -= dropped;
+    return dropped;
+}
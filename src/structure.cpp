@@ -1,46 +1,222 @@
 #include "structure.hpp"
+#include "string_pool.hpp"
 
 using namespace bp::serializable;
 
-struct variant_visitor {
-    using result_type = bp::structure::value_type;
-
-    bp::structure::value_type operator()(value_ptr _val) const {
-        if (_val) {
-            return bp::visit(bp::value_type_visitor(), *_val);
-        } else {
-            return bp::structure::value_type::Null;
+namespace {
+    bp::structure::value_type node_type(const tree &_node) {
+        switch (_node.get_kind()) {
+            case tree::kind::Bool:
+                return bp::structure::value_type::Bool;
+            case tree::kind::Int:
+            case tree::kind::UInt:
+                return bp::structure::value_type::Int;
+            case tree::kind::Float:
+                return bp::structure::value_type::Float;
+            case tree::kind::ShortString:
+            case tree::kind::String:
+            case tree::kind::Interned:
+            case tree::kind::StringView:
+                return bp::structure::value_type::String;
+            case tree::kind::Object:
+                return bp::structure::value_type::Object;
+            case tree::kind::Array:
+                return bp::structure::value_type::Array;
+            default:
+                return bp::structure::value_type::Null;
         }
     }
 
-    bp::structure::value_type operator()(object_ptr) const { return bp::structure::value_type::Object; }
+    struct value_visitor {
+        using result_type = tree;
+
+        template<typename T>
+        tree operator()(const T &_val) const { return tree(_val); }
+    };
+}
+
+const object_ptr &tree::null_object() {
+    static const object_ptr ptr;
+    return ptr;
+}
+
+const array_ptr &tree::null_array() {
+    static const array_ptr ptr;
+    return ptr;
+}
+
+tree::tree(const value &_val) : tree(bp::visit(value_visitor(), _val)) {}
+
+bool tree::operator==(const tree &_t) const {
+    if (kind_ == kind::Raw) resolve();
+    if (_t.kind_ == kind::Raw) _t.resolve();
+    if (kind_ != _t.kind_) {
+        return is_string() && _t.is_string() &&
+               str_size() == _t.str_size() && std::memcmp(str_data(), _t.str_data(), str_size()) == 0;
+    }
+    switch (kind_) {
+        case kind::Null:
+            return true;
+        case kind::Bool:
+            return bool_ == _t.bool_;
+        case kind::Int:
+            return int_ == _t.int_;
+        case kind::UInt:
+            return uint_ == _t.uint_;
+        case kind::Float:
+            return double_ == _t.double_;
+        case kind::Interned:
+            // strings interned in the same pool are equal only if they are the same string
+            if (string_ == _t.string_) return true;
+            if (string_->pool_id() == _t.string_->pool_id()) return false;
+            // fall through
+        case kind::ShortString:
+        case kind::String:
+        case kind::StringView:
+            return str_size() == _t.str_size() && std::memcmp(str_data(), _t.str_data(), str_size()) == 0;
+        case kind::Object:
+            return object_ == _t.object_;
+        case kind::Array:
+            return array_ == _t.array_;
+        case kind::Raw:
+            break;
+    }
+    return false;
+}
+
+void tree::resolve() const {
+    tree res;
+    raw_.source->materialize(raw_.index, res);
+    // node is logically unchanged, only its representation is
+    auto self = const_cast<tree *>(this);
+    self->reset();
+    self->move_from(std::move(res));
+}
+
+tree_ptr tree::share(const tree_ptr &_node, bp::arena *_arena) {
+    if (_node->kind_ != kind::Object && _node->kind_ != kind::Array) {
+        // scalars are copied, long strings are immutable and shared by pointer
+        return make_tree(_arena, *_node);
+    }
+    if (!(_node->flags_ & flag_shared)) {
+        _node->flags_ |= flag_shared;
+    }
+    return make_tree(_arena, *_node);
+}
+
+tree_ptr tree::share_tree(const tree_ptr &_node, bp::arena *_arena) {
+    auto res = copy_exposed(_node, _arena);
+    return res ? res : share(_node, _arena);
+}
 
-    bp::structure::value_type operator()(array_ptr) const { return bp::structure::value_type::Array; }
-};
+tree_ptr tree::copy_exposed(const tree_ptr &_node, bp::arena *_arena) {
+    // shared container was checked when it became shared: writers reach its items only by detaching
+    if ((_node->kind_ != kind::Object && _node->kind_ != kind::Array) || (_node->flags_ & flag_shared)) {
+        return nullptr;
+    }
+    // copies of exposed items, created once the first one is found
+    std::vector<tree_ptr> copies;
+    bool exposed = _node->kind_ == kind::Object ? _node->object_.use_count() > 1 : _node->array_.use_count() > 1;
+    size_t size = _node->kind_ == kind::Object ? _node->object_->size() : _node->array_->size();
+    auto visit = [&](size_t _i, const tree_ptr &_item) {
+        auto copy = copy_exposed(_item, _arena);
+        if (!copy && _item->refs().use_count() > 1) {
+            copy = share(_item, _arena);
+        }
+        if (copy && copies.empty()) {
+            copies.resize(size);
+        }
+        if (copy) {
+            copies[_i] = std::move(copy);
+            exposed = true;
+        }
+    };
+    size_t i = 0;
+    if (_node->kind_ == kind::Object) {
+        for (const auto &entry: *_node->object_) visit(i++, entry.second);
+    } else {
+        for (const auto &entry: *_node->array_) visit(i++, entry);
+    }
+    if (!exposed) {
+        return nullptr;
+    }
+    i = 0;
+    if (_node->kind_ == kind::Object) {
+        auto obj = make_object(_arena);
+        obj->reserve(size);
+        for (const auto &entry: *_node->object_) {
+            bool copied = !copies.empty() && copies[i];
+            obj->emplace_hint(obj->end(), entry.first, copied ? std::move(copies[i]) : share(entry.second, _arena));
+            ++i;
+        }
+        return make_tree(_arena, std::move(obj));
+    }
+    auto arr = make_array(_arena);
+    arr->reserve(size);
+    for (const auto &entry: *_node->array_) {
+        bool copied = !copies.empty() && copies[i];
+        arr->push_back(copied ? std::move(copies[i]) : share(entry, _arena));
+        ++i;
+    }
+    return make_tree(_arena, std::move(arr));
+}
+
+void tree::detach_slow(bp::arena *_arena) {
+    flags_ = 0;
+    switch (kind_) {
+        case kind::Object: {
+            if (object_.use_count() == 1) return;
+            auto obj = make_object(_arena);
+            obj->reserve(object_->size());
+            for (const auto &entry: *object_) {
+                obj->emplace_hint(obj->end(), entry.first, share(entry.second, _arena));
+            }
+            object_ = std::move(obj);
+            break;
+        }
+        case kind::Array: {
+            if (array_.use_count() == 1) return;
+            auto arr = make_array(_arena);
+            arr->reserve(array_->size());
+            for (const auto &entry: *array_) {
+                arr->push_back(share(entry, _arena));
+            }
+            array_ = std::move(arr);
+            break;
+        }
+        default:
+            break;
+    }
+}
 
-tree_ptr clone_variant(const tree_ptr &_ptr) {
-    auto type = bp::visit(variant_visitor(), *_ptr);
+tree_ptr clone_variant(const tree_ptr &_ptr, bp::arena *_arena) {
     tree_ptr res;
-    switch (type) {
-        case bp::structure::value_type::Object: {
-            auto obj = std::make_shared<bp::serializable::object>();
+    switch (_ptr->get_kind()) {
+        case tree::kind::Object: {
+            auto obj = make_object(_arena);
+            obj->reserve(_ptr->as_object()->size());
             for (const auto &entry: *_ptr->as_object()) {
-                obj->emplace(entry.first, clone_variant(entry.second));
+                obj->emplace_hint(obj->end(), entry.first, clone_variant(entry.second, _arena));
             }
-            res = std::make_shared<bp::serializable::tree>(obj);
+            res = make_tree(_arena, obj);
             break;
         }
-        case bp::structure::value_type::Array: {
-            auto arr = std::make_shared<bp::serializable::array>();
+        case tree::kind::Array: {
+            auto arr = make_array(_arena);
+            arr->reserve(_ptr->as_array()->size());
             for (const auto &entry: *_ptr->as_array()) {
-                arr->emplace_back(clone_variant(entry));
+                arr->emplace_back(clone_variant(entry, _arena));
             }
-            res = std::make_shared<bp::serializable::tree>(arr);
+            res = make_tree(_arena, arr);
 
             break;
         }
+        case tree::kind::String: {
+            res = make_tree(_arena, bp::string_view(_ptr->str_data(), _ptr->str_size()), _arena);
+            break;
+        }
         default: {
-            res = std::make_shared<bp::serializable::tree>(*_ptr);
+            res = make_tree(_arena, *_ptr);
         }
     }
     return res;
@@ -51,9 +227,10 @@ tree_ptr clone_variant(const tree_ptr &_ptr) {
 //        val_(std::make_shared<bp::serializable::tree>(_obj)) {
 //}
 
-bp::structure::structure(bp::serializable::tree_ptr _obj) : value_type_(value_type::Null), val_(_obj) {
+bp::structure::structure(bp::serializable::tree_ptr _obj, bp::arena *_arena) :
+        value_type_(value_type::Null), val_(_obj), arena_(_arena) {
     if (_obj) {
-        value_type_ = bp::visit(variant_visitor(), *val_);
+        value_type_ = node_type(*val_);
     } else {
         initialize_if_null(value_type::Null);
         value_type_ = value_type::Null;
@@ -120,10 +297,10 @@ void bp::structure::initialize_if_null(bp::structure::value_type _type) {
     if (is_null()) {
         switch (_type) {
             case value_type::Object:
-                *val_ = std::make_shared<object >();
+                *val_ = tree(make_object(arena_));
                 break;
             case value_type::Array:
-                *val_ = std::make_shared<array >();
+                *val_ = tree(make_array(arena_));
                 break;
             default:
                 break;
@@ -134,7 +311,10 @@ void bp::structure::initialize_if_null(bp::structure::value_type _type) {
 
 bp::structure bp::structure::operator[](int index) ENABLE_IF_HAS_EXCEPTIONS(throw (type_error)) {
     if (is_array()) {
-        return val_->as_array()->operator[](static_cast<size_t>(index % size()));
+        detach();
+        bp::structure item(val_->as_array()->operator[](static_cast<size_t>(index % size())), arena_);
+        item.pool_ = pool_;
+        return item;
     } else {
 #ifdef HAS_EXCEPTIONS
         throw type_error("not an array");
@@ -155,11 +335,19 @@ bp::structure bp::structure::operator[](const bp::hash_type &_key) ENABLE_IF_HAS
 #endif
         }
     }
-    return val_->as_object()->emplace(_key, std::make_shared<tree>(nullptr)).first->second;
+    detach();
+    auto r = val_->as_object()->emplace(_key, nullptr);
+    if (r.second) {
+        r.first->second = make_tree(arena_);
+    }
+    bp::structure item(r.first->second, arena_);
+    item.pool_ = pool_;
+    return item;
 }
 
 bool bp::structure::erase(const bp::hash_type &_key) ENABLE_IF_HAS_EXCEPTIONS(throw (type_error, std::out_of_range)) {
     if (is_object()) {
+        detach();
         val_->as_object()->erase(_key);
         return true;
     } else {
@@ -173,12 +361,15 @@ bool bp::structure::erase(const bp::hash_type &_key) ENABLE_IF_HAS_EXCEPTIONS(th
 bp::structure bp::structure::at(const bp::hash_type &_key) const ENABLE_IF_HAS_EXCEPTIONS(throw (type_error, std::out_of_range)) {
     if (is_object()) {
         auto val = val_->as_object().get();
-#ifndef HAS_EXCEPTIONS
-        if (val->find(_key) == val->end()) {
+#ifdef HAS_EXCEPTIONS
+        return item(val->at(_key));
+#else
+        auto it = val->find(_key);
+        if (it == val->end()) {
             return bp::structure();
         }
+        return item(it->second);
 #endif
-        return val->at(_key);
     } else {
 #ifdef HAS_EXCEPTIONS
         throw type_error("not an object");
@@ -194,7 +385,7 @@ bp::structure bp::structure::at(int _key) const ENABLE_IF_HAS_EXCEPTIONS(throw (
             return bp::structure();
         }
 #endif
-        return val->operator[](static_cast<size_t>(_key % size()));
+        return item(val->operator[](static_cast<size_t>(_key % size())));
     } else {
 #ifdef HAS_EXCEPTIONS
         throw type_error("not an array");
@@ -203,8 +394,20 @@ bp::structure bp::structure::at(int _key) const ENABLE_IF_HAS_EXCEPTIONS(throw (
     }
 }
 
+bp::structure bp::structure::at(const bp::hash_type &_key) ENABLE_IF_HAS_EXCEPTIONS(throw (type_error, std::out_of_range)) {
+    detach();
+    return static_cast<const structure *>(this)->at(_key);
+}
+
+bp::structure bp::structure::at(int _key) ENABLE_IF_HAS_EXCEPTIONS(throw (type_error, std::out_of_range)) {
+    detach();
+    return static_cast<const structure *>(this)->at(_key);
+}
+
 bp::structure &bp::structure::operator=(const structure &_str) {
     if (&_str == this) return *this;
+    // assignment aliases containers, so shared one is made exclusive to keep writes visible in both
+    _str.detach();
     this->value_type_ = _str.value_type_;
     *this->val_ = *_str.val_;
     return *this;
@@ -213,18 +416,12 @@ bp::structure &bp::structure::operator=(const structure &_str) {
 bp::structure &bp::structure::operator=(structure &&_str) {
     if (!this->val_) {
         this->val_ = _str.val_;
+        this->arena_ = _str.arena_;
     } else {
         if (!_str.val_) {
             this->val_.reset();
         } else {
-            // TODO: check why it necessary?
-            if (bp::holds_alternative<object_ptr>(*_str.val_)) {
-                *this->val_ = _str.val_->as_object();
-            } else if (bp::holds_alternative<array_ptr>(*_str.val_)) {
-                *this->val_ = _str.val_->as_array();
-            } else {
-                *this->val_ = _str.val_->as_value();
-            }
+            *this->val_ = *_str.val_;
         }
     }
     this->value_type_ = _str.value_type_;
@@ -233,6 +430,10 @@ bp::structure &bp::structure::operator=(structure &&_str) {
     return *this;
 }
 
+void bp::structure::assign(const bp::string_view &_val, std::true_type) {
+    *val_ = make_string_value(arena_, pool_, _val);
+}
+
 bool bp::structure::emplace(const std::initializer_list<std::pair<bp::hash_type, bp::structure>> &_val) {
     if (!emplace_init()) { return false; }
     for (const auto &entry: _val) {
@@ -244,6 +445,10 @@ bool bp::structure::emplace(const std::initializer_list<std::pair<bp::hash_type,
 bool bp::structure::emplace(const bp::hash_type &_key, const bp::structure &_str) {
     if (!emplace_init()) { return false; }
     if (!_str.is_null()) {
+        if (_str.arena_ != arena_) {
+            return val_->as_object()->emplace(_key, clone_variant(_str.val_, arena_)).second;
+        }
+        _str.detach();
         return emplace_resolve(_key, *_str.val_);
     } else {
         return emplace_resolve(_key, serializable::tree());
@@ -263,34 +468,38 @@ bool bp::structure::emplace(const bp::string_view &_key, const bp::structure &_s
 }
 
 bp::structure::value_type bp::structure::get_variant_type(const bp::serializable::tree &_var) const {
-    return bp::visit(variant_visitor(), _var);
+    return node_type(_var);
 }
 
-bp::structure::structure(const structure &_s) : value_type_(_s.value_type_), val_(_s.val_) {
+bp::structure::structure(const structure &_s) :
+        value_type_(_s.value_type_), val_(_s.val_), arena_(_s.arena_), pool_(_s.pool_),
+        zero_copy_(_s.zero_copy_) {
 
 }
 
-bp::structure::structure(structure &&_s) : value_type_(std::move(_s.value_type_)), val_(std::move(_s.val_)) {
+bp::structure::structure(structure &&_s) :
+        value_type_(std::move(_s.value_type_)), val_(std::move(_s.val_)), arena_(_s.arena_), pool_(_s.pool_),
+        zero_copy_(_s.zero_copy_) {
     _s.value_type_ = value_type::Null;
     _s.val_ = nullptr;
 }
 
 bp::structure bp::structure::deepcopy() const {
-    return structure(clone_variant(val_));
+    return structure(tree::share_tree(val_, arena_), arena_);
 }
 
 bp::structure::structure(const std::initializer_list<bp::serializable::tree> &_val) :
         value_type_(value_type::Array),
-        val_(std::make_shared<serializable::tree>(std::make_shared<array>())) {
+        val_(make_tree(nullptr, make_array())) {
     for (const auto &item: _val) {
-        this->append(bp::structure(std::make_shared<bp::serializable::tree>(item)));
+        this->append(bp::structure(make_tree(nullptr, item)));
     }
 
 }
 
 bp::structure::structure(const std::initializer_list<std::pair<bp::string_view, bp::structure>> &_val) :
         value_type_(value_type::Object),
-        val_(std::make_shared<serializable::tree>(std::make_shared<object>())) {
+        val_(make_tree(nullptr, make_object())) {
     for (const auto &item: _val) {
         this->emplace_resolve(item.first, std::move(*item.second.val_));
     }
@@ -298,7 +507,7 @@ bp::structure::structure(const std::initializer_list<std::pair<bp::string_view,
 
 bp::structure::structure(const std::initializer_list<std::pair<bp::hash_type, bp::structure>> &_val):
         value_type_(value_type::Object),
-        val_(std::make_shared<serializable::tree>(std::make_shared<object>())) {
+        val_(make_tree(nullptr, make_object())) {
     for (const auto &item: _val) {
         this->emplace_resolve(item.first, std::move(*item.second.val_));
     }
@@ -317,6 +526,12 @@ bool bp::structure::operator==(const bp::structure &_s) const {
 
     bool res = false;
 
+    if (is_object() || is_array()) {
+        // containers of different size can not be equal, empty ones always are
+        if (size() != _s.size()) return false;
+        res = true;
+    }
+
     if (is_object()) {
         for (const auto &item: this->as_object()) {
             if (!_s.has_key(item.first)) {
@@ -338,9 +553,9 @@ bool bp::structure::operator==(const bp::structure &_s) const {
 #ifndef TESTING
         // TODO: ireate over allowed types and match is<>->as<>
         if (is_int()) {
-            res = as<int>() == _s.as<int>();
+            res = as<int64_t>() == _s.as<int64_t>() && as<uint64_t>() == _s.as<uint64_t>();
         } else if (is_float()) {
-            res = as<float>() == _s.as<float>();
+            res = as<double>() == _s.as<double>();
         } else if (is_bool()) {
             res = as<bool>() == _s.as<bool>();
         } else if (is_string()) {
@@ -360,12 +575,24 @@ bp::structure::structure(bp::structure::value_type _t) : structure() {
     initialize_if_null(_t);
 }
 
+bp::structure::structure(bp::arena &_arena) : value_type_(value_type::Null),
+                                              val_(make_tree(&_arena)), arena_(&_arena) {}
+
+bp::structure::structure(bp::structure::value_type _t, bp::arena &_arena) : structure(_arena) {
+    initialize_if_null(_t);
+}
+
 bp::structure::structure() : value_type_(value_type::Null),
-                             val_(std::make_shared<serializable::tree>(nullptr)) {}
+                             val_(make_tree(nullptr)) {}
 
 bool bp::structure::clear() {
     if (is_array()) {
-        val_->as_array()->clear();
+        if (val_->is_shared()) {
+            // drop shared items without copying them
+            *val_ = tree(make_array(arena_));
+        } else {
+            val_->as_array()->clear();
+        }
         return true;
     } else {
 #ifdef HAS_EXCEPTIONS
@@ -378,7 +605,12 @@ bool bp::structure::clear() {
 bool bp::structure::append(const bp::structure &_val) {
     initialize_if_null(value_type::Array);
     if (is_array()) {
-        val_->as_array()->push_back(_val.val_);
+        detach();
+        if (_val.arena_ == arena_) {
+            val_->as_array()->push_back(_val.val_);
+        } else {
+            val_->as_array()->push_back(clone_variant(_val.val_, arena_));
+        }
     } else {
 #ifdef HAS_EXCEPTIONS
         throw type_error("not an array");
@@ -388,6 +620,44 @@ bool bp::structure::append(const bp::structure &_val) {
     return true;
 }
 
+bool bp::structure::reserve(size_t _n) ENABLE_IF_HAS_EXCEPTIONS(throw (type_error)) {
+    detach();
+    if (is_array()) {
+        val_->as_array()->reserve(_n);
+    } else if (is_object()) {
+        val_->as_object()->reserve(_n);
+    } else {
+#ifdef HAS_EXCEPTIONS
+        throw type_error("not a container");
+#endif
+        return false;
+    }
+    return true;
+}
+
+bp::structure::object_builder::object_builder(size_t _size, bp::arena *_arena) :
+        obj_(make_object(_arena)), arena_(_arena) {
+    obj_->reserve(_size);
+}
+
+bp::structure::object_builder &bp::structure::object_builder::add(const bp::hash_type &_key, const structure &_val) {
+    if (_val.arena_ != arena_) {
+        return add_node(_key, clone_variant(_val.val_, arena_));
+    }
+    return add_node(_key, tree_ptr(_val.val_));
+}
+
+bp::structure::object_builder &bp::structure::object_builder::add_node(const bp::hash_type &_key, tree_ptr &&_node) {
+    (*obj_)[_key] = std::move(_node);
+    return *this;
+}
+
+bp::structure bp::structure::object_builder::build() {
+    auto res = structure(make_tree(arena_, std::move(obj_)), arena_);
+    obj_ = make_object(arena_);
+    return res;
+}
+
 bool bp::structure::create_object(const bp::string_view &_s) {
     return this->emplace(_s, structure(value_type::Object));
 }
@@ -410,7 +680,7 @@ bool bp::structure::empty() const {
 
 void bp::structure::reset() {
     value_type_ = value_type::Null;
-    val_.reset(new serializable::tree(nullptr));
+    val_ = make_tree(arena_);
 }
 
 bp::structure& bp::structure::merge(const bp::structure &_s) ENABLE_IF_HAS_EXCEPTIONS(throw (type_error)) {
@@ -83,7 +83,7 @@ std::pair<object::key_type, bp::structure> bp::structure::object_iterator::opera
     if (!object_ || it_==end_) {
         return std::make_pair(KEY_EMPTY, bp::structure());
     }
-    return std::make_pair(it_->first, bp::structure(it_->second));
+    return std::make_pair(it_->first, object_->item(it_->second));
 }
 
 bool bp::structure::object_iterator::operator!=(const bp::structure::object_iterator& _rhs) const {
@@ -138,7 +138,7 @@ bp::structure bp::structure::array_iterator::operator*() {
     if (!object_) {
         return bp::structure();
     }
-    return bp::structure(*it_);
+    return object_->item(*it_);
 }
 
 bool bp::structure::array_iterator::operator!=(const bp::structure::array_iterator& _rhs) const {
@@ -1,78 +1,65 @@
 #include "structure.hpp"
+#include "structure_view.hpp"
 
 namespace bp {
+    // conversions are shared with structure_view
+
     template<>
     std::string structure::as<std::string>() const {
-        switch (type()) {
-            case value_type::Int:
-                return bp::to_string(val_->as<int>());
-            case value_type::Float:
-                return bp::to_string(val_->as<float>());
-            case value_type::Bool:
-                return val_->as<bool>() ? "true" : "false";
-            case value_type::String:
-                return val_->as<std::string>();
-            default:
-                return "";
-        }
+        return structure_view(*this).as<std::string>();
     }
 
     template<>
     int32_t structure::as<int32_t>() const {
-        return as_int<int32_t>();
+        return structure_view(*this).as<int32_t>();
     }
     template<>
     uint32_t structure::as<uint32_t>() const {
-        return as_int<uint32_t>();
+        return structure_view(*this).as<uint32_t>();
     }
     template<>
     int16_t structure::as<int16_t>() const {
-        return as_int<int16_t>();
+        return structure_view(*this).as<int16_t>();
     }
     template<>
     uint16_t structure::as<uint16_t>() const {
-        return as_int<uint16_t>();
+        return structure_view(*this).as<uint16_t>();
     }
     template<>
     int8_t structure::as<int8_t>() const {
-        return as_int<int8_t>();
+        return structure_view(*this).as<int8_t>();
     }
     template<>
     uint8_t structure::as<uint8_t>() const {
-        return as_int<uint8_t>();
+        return structure_view(*this).as<uint8_t>();
+    }
+    template<>
+    int64_t structure::as<int64_t>() const {
+        return structure_view(*this).as<int64_t>();
+    }
+    template<>
+    uint64_t structure::as<uint64_t>() const {
+        return structure_view(*this).as<uint64_t>();
     }
 #ifdef SPARK
     template<>
     int structure::as<int>() const {
-        return as_int<int>();
+        return structure_view(*this).as<int>();
     }
 #endif
 
     template<>
     float structure::as<float>() const {
-        switch (type()) {
-            case value_type::Int:
-                return val_->as<int>();
-            case value_type::Float:
-                return val_->as<float>();
-            default:
-                return 0;
-        }
+        return structure_view(*this).as<float>();
+    }
+
+    template<>
+    double structure::as<double>() const {
+        return structure_view(*this).as<double>();
     }
 
     template<>
     bool structure::as<bool>() const {
-        switch (type()) {
-            case value_type::Int:
-                return val_->as<int>() != 0;
-            case value_type::Bool:
-                return val_->as<bool>();
-            case value_type::String: {
-                auto s = val_->as<std::string>();
-                return !(s == "false" || s == "0" || s.empty());
-            }
-            default:
-                return false;
-        }
+        return structure_view(*this).as<bool>();
     }
 }
\ No newline at end of file
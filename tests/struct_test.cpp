@@ -175,7 +175,7 @@ TEST(StructTest, data_types) {
     s["a"] = 1.0f;
     v = s.at("a"_h);
     ASSERT_EQ(v.as<int>(), 1) << "as<int>()(float)";
-    ASSERT_EQ(v.as<std::string>(), std::to_string(1.0)) << "as<std::string>()(float)";
+    ASSERT_EQ(v.as<std::string>(), std::string("1")) << "as<std::string>()(float)";
     ASSERT_EQ(v.as<bool>(), false) << "as<bool>()(float)";
     ASSERT_EQ(v.as<float>(), 1.0) << "as<float>()(float)";
 
@@ -0,0 +1,319 @@
+#include "hash_table.hpp"
+#include "intrusive_ptr.hpp"
+#include "node_pool.hpp"
+#include "small_map.hpp"
+#include "string_pool.hpp"
+#include "structure.hpp"
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <cstring>
+#include <random>
+#include <vector>
+
+TEST(HashTableTest, matches_map) {
+    bp::hash_table<uint32_t, std::shared_ptr<int>> table;
+    std::map<uint32_t, int> reference;
+    std::mt19937 rnd(42);
+
+    for (int i = 0; i < 100000; ++i) {
+        uint32_t key = rnd() % 5000;
+        switch (rnd() % 3) {
+            case 0:
+            case 1: {
+                auto r = table.emplace(key, std::make_shared<int>(i));
+                auto e = reference.emplace(key, i);
+                ASSERT_EQ(r.second, e.second);
+                ASSERT_EQ(*r.first->second, e.first->second);
+                break;
+            }
+            default:
+                ASSERT_EQ(table.erase(key), reference.erase(key));
+                break;
+        }
+        ASSERT_EQ(table.size(), reference.size());
+    }
+
+    for (const auto &kv: reference) {
+        auto it = table.find(kv.first);
+        ASSERT_TRUE(it != table.end());
+        ASSERT_EQ(*it->second, kv.second);
+    }
+    size_t count = 0;
+    for (const auto &kv: table) {
+        ASSERT_EQ(reference.count(kv.first), 1);
+        ++count;
+    }
+    ASSERT_EQ(count, reference.size());
+
+    auto copy = table;
+    table.clear();
+    ASSERT_TRUE(table.empty());
+    ASSERT_EQ(copy.size(), reference.size());
+    ASSERT_TRUE(table.find(reference.begin()->first) == table.end());
+}
+
+TEST(HashTableTest, colliding_keys) {
+    // keys differing only in low bits land in neighbouring slots
+    bp::hash_table<uint32_t, int> table;
+    for (uint32_t i = 0; i < 4096; ++i) {
+        table.emplace(i << 20, static_cast<int>(i));
+    }
+    for (uint32_t i = 0; i < 4096; ++i) {
+        ASSERT_EQ(table.find(i << 20)->second, static_cast<int>(i));
+    }
+}
+
+TEST(SmallMapTest, switches_representation) {
+    bp::small_map<uint32_t, int, 4> map;
+    for (uint32_t i = 0; i < 4; ++i) {
+        map.emplace(10 - i, static_cast<int>(i));
+    }
+    ASSERT_TRUE(map.is_inline());
+    uint32_t prev = 0;
+    for (const auto &kv: map) {
+        ASSERT_LT(prev, kv.first);
+        prev = kv.first;
+    }
+    map.emplace(100, 100);
+    ASSERT_FALSE(map.is_inline());
+    ASSERT_EQ(map.size(), 5);
+    ASSERT_EQ(map.at(10), 0);
+    ASSERT_EQ(map.at(100), 100);
+    ASSERT_EQ(map.erase(10), 1);
+    ASSERT_EQ(map.count(10), 0);
+}
+
+namespace {
+    // allocator running out of memory like node pool in node_pool::checked_scope
+    template<typename T>
+    struct limited_allocator {
+        using value_type = T;
+
+        explicit limited_allocator(size_t *_budget) : budget(_budget) {}
+
+        template<typename U>
+        limited_allocator(const limited_allocator<U> &_a) : budget(_a.budget) {}
+
+        T *allocate(size_t _n) {
+            if (*budget < _n * sizeof(T)) return nullptr;
+            *budget -= _n * sizeof(T);
+            return static_cast<T *>(::operator new(_n * sizeof(T)));
+        }
+
+        void deallocate(T *_p, size_t) { ::operator delete(_p); }
+
+        template<typename U>
+        bool operator==(const limited_allocator<U> &_a) const { return budget == _a.budget; }
+
+        template<typename U>
+        bool operator!=(const limited_allocator<U> &_a) const { return budget != _a.budget; }
+
+        size_t *budget;
+    };
+}
+
+TEST(SmallMapTest, failed_growth) {
+    using alloc = limited_allocator<std::pair<const uint32_t, int>>;
+    size_t budget = 0;
+    bp::node_pool::checked_scope scope;
+
+    bp::hash_table<uint32_t, int, alloc> table{alloc(&budget)};
+    auto t = table.emplace(1, 1);
+    ASSERT_FALSE(t.second);
+    ASSERT_TRUE(t.first == table.end());
+    ASSERT_TRUE(table.empty());
+
+    bp::small_map<uint32_t, int, 8, alloc> map{alloc(&budget)};
+    for (uint32_t i = 0; i < 8; ++i) {
+        ASSERT_TRUE(map.emplace(i, static_cast<int>(i)).second);
+    }
+    auto r = map.emplace(8, 8);
+    ASSERT_FALSE(r.second);
+    ASSERT_TRUE(r.first == map.end());
+    ASSERT_TRUE(map.is_inline());
+    ASSERT_EQ(map.size(), 8);
+
+    // table which cannot rehash keeps its entries
+    budget = SIZE_MAX;
+    ASSERT_TRUE(map.emplace(8, 8).second);
+    ASSERT_FALSE(map.is_inline());
+    budget = 0;
+    uint32_t key = 9;
+    while (map.emplace(key, static_cast<int>(key)).second) {
+        ++key;
+    }
+    ASSERT_GT(key, 9u);
+    ASSERT_EQ(map.size(), key);
+    ASSERT_EQ(map.count(key), 0);
+    for (uint32_t i = 0; i < key; ++i) {
+        ASSERT_EQ(map.find(i)->second, static_cast<int>(i));
+    }
+    ASSERT_FALSE(scope.failed());
+
+#if defined(BP_NODE_POOL_SIZE) && !defined(HAS_EXCEPTIONS)
+    // object of tree in exhausted global pool
+    auto obj = bp::serializable::make_object();
+    std::vector<void *> blocks;
+    while (auto p = bp::node_pool::instance().allocate(16)) {
+        blocks.push_back(p);
+    }
+    for (uint32_t i = 0; i < 8; ++i) {
+        ASSERT_TRUE(obj->emplace(bp::hash_type(i), nullptr).second);
+    }
+    ASSERT_FALSE(obj->emplace(bp::hash_type(8), nullptr).second);
+    ASSERT_TRUE(scope.failed());
+    ASSERT_EQ(obj->size(), 8);
+    for (auto p : blocks) {
+        bp::node_pool::instance().deallocate(p);
+    }
+#endif
+}
+
+namespace {
+    struct counted {
+        explicit counted(int *_destroyed) : destroyed(_destroyed) {}
+
+        ~counted() { ++*destroyed; }
+
+        const bp::ref_count &refs() const { return refs_; }
+
+        int *destroyed;
+        bp::ref_count refs_;
+    };
+}
+
+TEST(IntrusivePtrTest, ref_counting) {
+    static_assert(sizeof(bp::intrusive_ptr<counted>) == sizeof(void *), "handle must be a single pointer");
+    int destroyed = 0;
+    {
+        auto heap = bp::make_intrusive<counted>(nullptr, &destroyed);
+        ASSERT_FALSE(heap->refs().in_arena());
+        auto copy = heap;
+        ASSERT_EQ(heap.use_count(), 2);
+        copy.reset();
+        ASSERT_EQ(heap.use_count(), 1);
+    }
+    ASSERT_EQ(destroyed, 1);
+
+    bp::arena arena;
+    {
+        auto in_arena = bp::make_intrusive<counted>(&arena, &destroyed);
+        ASSERT_TRUE(in_arena->refs().in_arena());
+        bp::intrusive_ptr<const counted> copy(in_arena);
+        ASSERT_EQ(copy.use_count(), 2);
+        ASSERT_TRUE(copy == in_arena);
+    }
+    ASSERT_EQ(destroyed, 2);
+}
+
+TEST(StringPoolTest, deduplicates) {
+    bp::string_pool pool;
+    std::vector<bp::serializable::string_ptr> strings;
+    for (int i = 0; i < 1000; ++i) {
+        strings.push_back(pool.intern(bp::string_view("value number " + std::to_string(i % 100) + " of pool")));
+    }
+    ASSERT_EQ(pool.size(), 100);
+    ASSERT_TRUE(strings[5] == strings[105]);
+    ASSERT_TRUE(strings[5]->view() == bp::string_view("value number 5 of pool"));
+    ASSERT_TRUE(pool.find(bp::string_view("value number 7 of pool")) == strings[7]);
+    ASSERT_TRUE(pool.find(bp::string_view("missing")) == nullptr);
+
+    bp::serializable::tree a(strings[1]), b(strings[101]), c(strings[2]);
+    bp::serializable::tree plain(bp::string_view("value number 1 of pool"));
+    ASSERT_EQ(a.get_kind(), bp::serializable::tree::kind::Interned);
+    ASSERT_TRUE(a == b);
+    ASSERT_FALSE(a == c);
+    ASSERT_TRUE(a == plain);
+
+    strings.resize(50);
+    ASSERT_EQ(pool.collect(), 50);
+    ASSERT_EQ(pool.size(), 50);
+    ASSERT_TRUE(pool.intern(bp::string_view("value number 3 of pool")) == strings[3]);
+
+    // assigned strings are interned in pool of structure
+    bp::structure s;
+    s.set_string_pool(&pool);
+    s["k"] = std::string("assigned value of pool");
+    ASSERT_EQ(pool.size(), 51);
+    ASSERT_TRUE(pool.find(bp::string_view("assigned value of pool")) != nullptr);
+    ASSERT_EQ(s["k"].as<std::string>(), "assigned value of pool");
+}
+
+TEST(NodePoolTest, allocates_from_fixed_memory) {
+    alignas(std::max_align_t) static char memory[8 * 1024];
+    bp::node_pool pool(memory, sizeof(memory));
+    ASSERT_GT(pool.capacity(), 7000u);
+    ASSERT_LE(pool.capacity(), sizeof(memory));
+
+    std::vector<void *> blocks;
+    std::mt19937 rnd(7);
+    while (auto p = pool.allocate(1 + rnd() % 300)) {
+        ASSERT_TRUE(pool.owns(p));
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(p) % alignof(std::max_align_t), 0u);
+        std::memset(p, 0xAB, 1);
+        blocks.push_back(p);
+    }
+    ASSERT_EQ(pool.failures(), 1u);
+    ASSERT_EQ(pool.used(), pool.high_water());
+    auto high_water = pool.high_water();
+
+    // freed blocks are reused by their size class, freed page runs by any request
+    for (auto p : blocks) {
+        pool.deallocate(p);
+    }
+    ASSERT_EQ(pool.used(), 0u);
+    ASSERT_EQ(pool.high_water(), high_water);
+    auto node = pool.allocate(sizeof(bp::serializable::tree));
+    ASSERT_NE(node, nullptr);
+    pool.deallocate(node);
+    ASSERT_EQ(pool.allocate(sizeof(bp::serializable::tree)), node);
+    ASSERT_EQ(pool.allocate(pool.capacity()), nullptr);
+    ASSERT_FALSE(pool.owns(&pool));
+
+#ifdef BP_NODE_POOL_SIZE
+    // nodes not bound to arena live in global pool
+    using namespace bp::literals;
+    auto used = bp::node_pool::instance().used();
+    {
+        bp::structure s{{"list"_h, {1, 2, "long string value in pool"}}};
+        ASSERT_GT(bp::node_pool::instance().used(), used);
+    }
+    ASSERT_EQ(bp::node_pool::instance().used(), used);
+#endif
+}
+
+TEST(NodePoolTest, releases_empty_pages) {
+    alignas(std::max_align_t) static char memory[64 * 1024];
+    bp::node_pool pool(memory, sizeof(memory));
+
+    std::vector<void *> blocks;
+    while (auto p = pool.allocate(16)) {
+        blocks.push_back(p);
+    }
+    ASSERT_EQ(blocks.size(), pool.capacity() / 16);
+    ASSERT_EQ(pool.allocate(32), nullptr);
+
+    // pages left by one class serve other classes and runs
+    for (auto p : blocks) {
+        pool.deallocate(p);
+    }
+    ASSERT_EQ(pool.used(), 0u);
+    auto run = pool.allocate(4096);
+    ASSERT_NE(run, nullptr);
+    pool.deallocate(run);
+    blocks.clear();
+    while (auto p = pool.allocate(32)) {
+        blocks.push_back(p);
+    }
+    ASSERT_EQ(blocks.size(), pool.capacity() / 32);
+
+    // page with live block stays with its class, the rest are released
+    for (size_t i = 1; i < blocks.size(); ++i) {
+        pool.deallocate(blocks[i]);
+    }
+    ASSERT_EQ(pool.used(), 32u);
+    ASSERT_NE(pool.allocate(pool.capacity() - bp::node_pool::page_size), nullptr);
+    ASSERT_EQ(pool.allocate(bp::node_pool::page_size + 1), nullptr);
+    ASSERT_NE(pool.allocate(32), nullptr);
+}
@@ -0,0 +1,156 @@
+#include "structure.hpp"
+#include "serializers/dcm_buf.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+using namespace bp::literals;
+
+namespace {
+    bp::structure make_message() {
+        bp::structure s;
+        s["i8"] = int8_t(-5);
+        s["i16"] = int16_t(-300);
+        s["i32"] = int32_t(70000);
+        s["i64"] = int64_t(5000000000);
+        s["min"] = std::numeric_limits<int64_t>::min();
+        s["max"] = std::numeric_limits<uint64_t>::max();
+        s["f"] = 1.5f;
+        s["d"] = 0.1;
+        s["s"] = "string longer than node capacity";
+        s["e"] = "";
+        s["b"] = true;
+        s["n"] = nullptr;
+        s["list"].append(1);
+        s["list"].append("two");
+        s["list"].append(bp::structure{3.5, false});
+        s["o"]["k"] = "v";
+        return s;
+    }
+
+    class string_sink : public bp::serializers::dcm_sink {
+    public:
+        bool write(const char *_data, size_t _size) override {
+            out.append(_data, _size);
+            ++writes;
+            return true;
+        }
+
+        std::string out;
+        size_t writes = 0;
+    };
+}
+
+TEST(DcmTest, round_trip_widths) {
+    struct width {
+        bp::structure value;
+        char tag;
+    };
+    width widths[] = {{bp::structure(int8_t(-5)), '1'},
+                      {bp::structure(int16_t(-300)), '2'},
+                      {bp::structure(int32_t(70000)), 'i'},
+                      {bp::structure(int64_t(5000000000)), '8'},
+                      {bp::structure(std::numeric_limits<int64_t>::min()), '8'},
+                      {bp::structure(std::numeric_limits<uint64_t>::max()), 'u'},
+                      {bp::structure(1.5f), 'f'},
+                      {bp::structure(0.1), 'd'}};
+    for (auto &w: widths) {
+        auto bin = w.value.serialize<bp::serializers::Dcm>();
+        ASSERT_EQ(bin[0], w.tag);
+        bp::structure s;
+        ASSERT_TRUE(s.parse<bp::serializers::Dcm>(bin));
+        ASSERT_TRUE(s == w.value) << w.tag;
+    }
+
+    auto src = make_message();
+    bp::structure s;
+    ASSERT_TRUE(s.parse<bp::serializers::Dcm>(src.serialize<bp::serializers::Dcm>()));
+    ASSERT_TRUE(s == src);
+    ASSERT_EQ(s.at("min"_h).as<int64_t>(), std::numeric_limits<int64_t>::min());
+    ASSERT_EQ(s.at("max"_h).as<uint64_t>(), std::numeric_limits<uint64_t>::max());
+}
+
+TEST(DcmTest, writer) {
+    auto src = make_message();
+    auto bin = src.serialize<bp::serializers::Dcm>();
+    ASSERT_EQ(bp::serializers::dcm_writer::measure(src), bin.size());
+
+    // small flush size splits message into many writes of the same bytes
+    string_sink sink;
+    bp::serializers::dcm_writer writer(sink, 8);
+    ASSERT_TRUE(writer.write(src));
+    ASSERT_EQ(sink.out, bin);
+    ASSERT_GT(sink.writes, 1u);
+
+    std::string buf(bin.size(), 'x');
+    ASSERT_EQ(bp::serializers::to_dcm(src, &buf[0], buf.size()), bin.size());
+    ASSERT_EQ(buf, bin);
+
+    // nothing is written into buffer too small for message
+    std::string small(bin.size() - 1, 'x');
+    ASSERT_EQ(bp::serializers::to_dcm(src, &small[0], small.size()), bin.size());
+    ASSERT_EQ(small, std::string(bin.size() - 1, 'x'));
+}
+
+TEST(DcmTest, canonical_order) {
+    // large objects equal by value are written the same regardless of insertion and erasure history
+    bp::structure grown, reserved;
+    for (int i = 0; i < 40; ++i) {
+        grown["k" + std::to_string(i)] = i;
+        reserved["k" + std::to_string(39 - i)] = 39 - i;
+        reserved["tmp" + std::to_string(i)] = i;
+    }
+    for (int i = 0; i < 40; ++i) {
+        reserved.erase(bp::symbol("tmp" + std::to_string(i)).to_hash());
+    }
+    ASSERT_TRUE(grown == reserved);
+    ASSERT_EQ(grown.serialize<bp::serializers::Dcm>(), reserved.serialize<bp::serializers::Dcm>());
+}
+
+TEST(DcmTest, push_parser) {
+    auto src = make_message();
+    auto bin = src.serialize<bp::serializers::Dcm>();
+    bp::serializers::dcm_push_parser parser;
+
+    for (size_t i = 0; i < bin.size(); ++i) {
+        auto status = parser.feed(bp::string_view(bin.data() + i, 1));
+        ASSERT_EQ(status, i + 1 < bin.size() ? bp::serializers::push_status::NeedMore
+                                             : bp::serializers::push_status::Complete);
+        ASSERT_EQ(parser.consumed(), 1u);
+    }
+    bp::structure s;
+    ASSERT_TRUE(parser.take(s));
+    ASSERT_TRUE(s == src);
+
+    // parser stops at the end of message, the rest of chunk is fed again
+    auto two = bin + bin;
+    ASSERT_EQ(parser.feed(two), bp::serializers::push_status::Complete);
+    ASSERT_EQ(parser.consumed(), bin.size());
+    ASSERT_TRUE(parser.take(s));
+    ASSERT_EQ(parser.feed(bp::string_view(two.data() + bin.size(), bin.size())),
+              bp::serializers::push_status::Complete);
+    ASSERT_EQ(parser.consumed(), bin.size());
+    ASSERT_TRUE(parser.take(s));
+    ASSERT_TRUE(s == src);
+
+    ASSERT_THROW(parser.feed(std::string("a\1\0\0\0z", 6)), bp::structure::parse_error);
+    ASSERT_FALSE(parser.error().empty());
+}
+
+TEST(DcmTest, malformed_input) {
+    auto bin = make_message().serialize<bp::serializers::Dcm>();
+    for (size_t size = 1; size < bin.size(); ++size) {
+        // own copy of prefix, so reads past its end are caught by sanitizers
+        std::string truncated(bin, 0, size);
+        bp::structure s;
+        ASSERT_THROW(s.parse<bp::serializers::Dcm>(truncated), bp::structure::parse_error) << size;
+    }
+
+    bp::structure s;
+    ASSERT_THROW(s.parse<bp::serializers::Dcm>(std::string("o\xff\xff\xff\xff", 5)), bp::structure::parse_error);
+    ASSERT_THROW(s.parse<bp::serializers::Dcm>(std::string("a\xff\xff\xff\xff", 5)), bp::structure::parse_error);
+    ASSERT_THROW(s.parse<bp::serializers::Dcm>(std::string("o\1\0", 3)), bp::structure::parse_error);
+    ASSERT_THROW(s.parse<bp::serializers::Dcm>(std::string("z")), bp::structure::parse_error);
+    ASSERT_THROW(s.parse<bp::serializers::Dcm>(std::string("a\1\0\0\0z", 6)), bp::structure::parse_error);
+}
@@ -1,12 +1,25 @@
 #include "structure.hpp"
+#include "structure_view.hpp"
+#include "string_pool.hpp"
 #ifdef ARDUINO_JSON
 #include "serializers/json_arduino.hpp"
 #else
 #include "serializers/json.hpp"
+#include "serializers/json_writer.hpp"
+#include "serializers/json_in_situ.hpp"
+#include "serializers/json_index.hpp"
+#include "serializers/json_reader.hpp"
+#include "serializers/ndjson.hpp"
+#include "persistent_structure.hpp"
+#include <sstream>
+#include <unistd.h>
 #endif
 #include <gtest/gtest.h>
 #include <string>
 #include <algorithm>
+#include <limits>
+#include <cstring>
+#include <vector>
 #include <binelpro/symbol.hpp>
 #include <jsoncpp/json/json.h>
 
@@ -76,3 +89,559 @@ TEST(StructTest, parser) {
     ASSERT_TRUE(pkt.has_key("cmd"_h));
     ASSERT_EQ(pkt.get<std::string>("cmd"_h), "status");
 }
+
+TEST(JsonTest, arena_parser) {
+    bp::arena arena;
+    auto s = bp::structure::create_from_string<SerializerType>("{\"a\":[1,2,3],\"s\":\"string which does not fit into node\"}", arena);
+
+    ASSERT_EQ(s.get_arena(), &arena);
+    ASSERT_GT(arena.used(), 0);
+    ASSERT_EQ(s["a"].size(), 3);
+    ASSERT_EQ(s["a"][2].as<int>(), 3);
+    ASSERT_EQ(s.get<std::string>("s"_h), "string which does not fit into node");
+}
+
+TEST(JsonTest, interned_strings) {
+    bp::string_pool pool;
+    auto s = bp::structure::create_from_string<SerializerType>(
+            "[{\"class\":\"temperature sensor node\"},{\"class\":\"temperature sensor node\"},{\"class\":\"ok\"}]",
+            pool);
+
+    ASSERT_EQ(pool.size(), 1);
+    bp::structure_view first(s[0]["class"]);
+    bp::structure_view second(s[1]["class"]);
+    ASSERT_EQ(first.str_data(), second.str_data());
+    ASSERT_TRUE(first == second);
+    ASSERT_TRUE(first.str_view() == bp::string_view("temperature sensor node"));
+    ASSERT_EQ(s[2].get<std::string>("class"_h), "ok");
+}
+
+TEST(JsonTest, large_numbers) {
+    auto s = bp::structure::create_from_string<SerializerType>(
+            "{\"id\":9007199254740993,\"big\":18446744073709551615,\"neg\":-9223372036854775808,"
+            "\"d\":0.1,\"i\":1}");
+
+    ASSERT_EQ(s.at("id"_h).as<int64_t>(), 9007199254740993LL);
+    ASSERT_EQ(s.at("big"_h).as<uint64_t>(), 18446744073709551615ULL);
+    ASSERT_EQ(s.at("neg"_h).as<int64_t>(), std::numeric_limits<int64_t>::min());
+    ASSERT_EQ(s.at("d"_h).as<double>(), 0.1);
+    ASSERT_TRUE(s.at("i"_h).is_int());
+
+    auto back = bp::structure::create_from_string<SerializerType>(s.serialize<SerializerType>());
+    ASSERT_TRUE(back == s);
+    ASSERT_EQ(back.at("id"_h).as<int64_t>(), 9007199254740993LL);
+    ASSERT_EQ(back.at("big"_h).as<uint64_t>(), 18446744073709551615ULL);
+    ASSERT_EQ(back.at("d"_h).as<double>(), 0.1);
+}
+
+#ifndef ARDUINO_JSON
+TEST(JsonTest, native_parser) {
+    auto s = bp::structure::create_from_string<SerializerType>(
+            " {\"esc\":\"a\\\"b\\\\c\\/\\n\\u00e9\\ud83d\\ude00\",\"e\":1.5e3,\"neg\":-0.25,\"t\":true,\"f\":false,"
+            "\"n\":null,\"arr\":[],\"obj\":{},\"dup\":1,\"dup\":2,\"nested\":[[1,[2]],{\"k\":\"v\"}]} ");
+
+    ASSERT_EQ(s.at("esc"_h).as<std::string>(), "a\"b\\c/\n\xc3\xa9\xf0\x9f\x98\x80");
+    ASSERT_EQ(s.at("e"_h).as<double>(), 1500.0);
+    ASSERT_EQ(s.at("neg"_h).as<double>(), -0.25);
+    ASSERT_TRUE(s.at("t"_h).as<bool>());
+    ASSERT_TRUE(s.at("f"_h).is_bool());
+    ASSERT_TRUE(s.at("n"_h).is_null());
+    ASSERT_TRUE(s.at("arr"_h).is_array());
+    ASSERT_TRUE(s.at("obj"_h).is_object());
+    ASSERT_EQ(s.at("dup"_h).as<int>(), 2);
+    ASSERT_EQ(s.at("nested"_h)[0][1][0].as<int>(), 2);
+    ASSERT_EQ(s.at("nested"_h)[1].at("k"_h).as<std::string>(), "v");
+
+    auto reference = bp::structure::create_from_string<bp::serializers::JsonCpp>(s.serialize<SerializerType>());
+    ASSERT_TRUE(reference == bp::structure::create_from_string<SerializerType>(s.serialize<SerializerType>()));
+
+    const char *malformed[] = {"", "{", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "tru", "01x", "\"abc", "\"\\x\"",
+                               "\"\\ud83d\"", "1 2", "[1.]", "-", "{1:2}"};
+    for (auto doc: malformed) {
+        ASSERT_THROW(bp::structure::create_from_string<SerializerType>(doc), bp::structure::parse_error) << doc;
+    }
+    ASSERT_THROW(bp::structure::create_from_string<SerializerType>(std::string(1000, '[')), bp::structure::parse_error);
+}
+
+TEST(JsonTest, writer) {
+    auto s = bp::structure::create_from_string<bp::serializers::Json>(
+            "{\"a\":[1,-2,18446744073709551615,-9223372036854775808],\"b\":\"q\\\"\\\\\\n\\u0001\",\"c\":{},\"d\":[],"
+            "\"e\":0.1,\"f\":1500.0,\"g\":null,\"h\":true}");
+    bp::structure f(1.5f);
+
+    ASSERT_EQ(bp::structure({1, "x"}).serialize<bp::serializers::Json>(), "[1,\"x\"]");
+    ASSERT_EQ(f.serialize<bp::serializers::Json>(), "1.5");
+    ASSERT_EQ(bp::serializers::to_json(s.at("b"_h)), "\"q\\\"\\\\\\n\\u0001\"");
+    ASSERT_EQ(bp::serializers::to_json(s.at("f"_h)), "1500.0");
+    ASSERT_GT(bp::serializers::json_writer::estimate_size(s), 0u);
+
+    auto compact = s.serialize<bp::serializers::Json>();
+    auto pretty = s.serialize<bp::serializers::JsonPretty>();
+    ASSERT_EQ(compact.find(' '), std::string::npos);
+    ASSERT_NE(pretty.find("\n    \"a\": [\n        1,"), std::string::npos);
+    ASSERT_TRUE(s == bp::structure::create_from_string<bp::serializers::Json>(compact));
+    ASSERT_TRUE(s == bp::structure::create_from_string<bp::serializers::Json>(pretty));
+    ASSERT_TRUE(s == bp::structure::create_from_string<bp::serializers::JsonCpp>(compact));
+    ASSERT_TRUE(f == bp::structure::create_from_string<bp::serializers::Json>(f.serialize<bp::serializers::Json>()));
+
+    // large objects equal by value are written the same regardless of insertion and erasure history
+    bp::structure grown, reserved;
+    for (int i = 0; i < 40; ++i) {
+        grown["k" + std::to_string(i)] = i;
+        reserved["k" + std::to_string(39 - i)] = 39 - i;
+        reserved["tmp" + std::to_string(i)] = i;
+    }
+    for (int i = 0; i < 40; ++i) {
+        reserved.erase(bp::symbol("tmp" + std::to_string(i)).to_hash());
+    }
+    ASSERT_TRUE(grown == reserved);
+    ASSERT_EQ(grown.serialize<bp::serializers::Json>(), reserved.serialize<bp::serializers::Json>());
+    ASSERT_EQ(grown.serialize<bp::serializers::JsonPretty>(), reserved.serialize<bp::serializers::JsonPretty>());
+
+    // doubles exactly representable as float and integers out of 64-bit range are read back bit-exactly
+    for (auto text: {"0.100000001490116119384765625", "0.5", "3.4028234663852886e+38", "1.401298464324817e-45",
+                     "18446744073709551616", "-9223372036854775809"}) {
+        auto v = bp::structure::create_from_string<bp::serializers::Json>(std::string("[") + text + "]");
+        auto back = bp::structure::create_from_string<bp::serializers::Json>(v.serialize<bp::serializers::Json>());
+        auto a = v[0].as<double>(), b = back[0].as<double>();
+        ASSERT_EQ(std::memcmp(&a, &b, sizeof(a)), 0) << text << " " << v.serialize<bp::serializers::Json>();
+        auto c = std::stod(v[0].as<std::string>());
+        ASSERT_EQ(std::memcmp(&a, &c, sizeof(a)), 0) << text << " " << v[0].as<std::string>();
+    }
+
+    // exact size pre-pass, caller's buffer and sink
+    bp::structure big(bp::structure::value_type::Array);
+    for (int i = 0; i < 200; ++i) {
+        big.append(s);
+    }
+    auto big_json = big.serialize<bp::serializers::Json>();
+    ASSERT_GT(big_json.size(), 1536u);
+    for (auto v : {bp::structure_view(s), bp::structure_view(f), bp::structure_view(big), bp::structure_view(s.at("b"_h))}) {
+        ASSERT_EQ(bp::serializers::json_writer::measure(v), bp::serializers::to_json(v).size());
+    }
+    std::string buf(big_json.size(), '\0');
+    ASSERT_EQ(bp::serializers::to_json(big, &buf[0], buf.size() - 1), big_json.size());
+    ASSERT_EQ(buf, std::string(big_json.size(), '\0'));
+    ASSERT_EQ(bp::serializers::to_json(big, &buf[0], buf.size()), big_json.size());
+    ASSERT_EQ(buf, big_json);
+
+    struct sink : bp::serializers::json_sink {
+        std::string text;
+        size_t pieces = 0;
+        size_t limit = SIZE_MAX;
+
+        bool write(const char *_data, size_t _size) override {
+            if (text.size() + _size > limit) return false;
+            text.append(_data, _size);
+            ++pieces;
+            return true;
+        }
+    } out;
+    ASSERT_TRUE(bp::serializers::json_writer(out, bp::serializers::json_writer::style::Compact, 4, 64).write(big));
+    ASSERT_EQ(out.text, big_json);
+    ASSERT_GT(out.pieces, big_json.size() / 128);
+    out = sink();
+    out.limit = 1000;
+    ASSERT_FALSE(bp::serializers::json_writer(out).write(big));
+    ASSERT_LE(out.text.size(), 1000u);
+}
+
+TEST(JsonTest, structural_index) {
+    using bp::serializers::structural_index;
+    // strings and backslash runs crossing block boundaries
+    std::string doc = "{\"a\\\\\":[1, true,\"x\\\"y\"], \"" + std::string(70, 'z') + "\\\\\\\"" + std::string(60, '\\') +
+                      "\":-2.5e3,\"n\":null}";
+    std::vector<uint32_t> expected;
+    for (size_t i = 0, in_string = 0; i < doc.size(); ++i) {
+        auto c = doc[i];
+        if (in_string) {
+            if (c == '\\') {
+                ++i;
+            } else if (c == '"') {
+                expected.push_back(static_cast<uint32_t>(i));
+                in_string = 0;
+            }
+        } else if (c == '"') {
+            expected.push_back(static_cast<uint32_t>(i));
+            in_string = 1;
+        } else if (std::strchr("{}[]:,", c) || (c != ' ' && std::strchr("{}[]:, ", doc[i - 1]))) {
+            expected.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    for (auto k: {structural_index::kernel::Scalar, structural_index::kernel::Sse42, structural_index::kernel::Avx2}) {
+        if (!structural_index::supported(k)) continue;
+        structural_index index(k);
+        ASSERT_TRUE(index.build(doc));
+        ASSERT_EQ(std::vector<uint32_t>(index.begin(), index.end()), expected);
+
+        ASSERT_FALSE(index.build(doc.substr(0, 100)));
+        ASSERT_STREQ(index.error(), "unterminated string");
+        ASSERT_FALSE(index.build("[\"" + std::string(80, 'a') + "\t\"]"));
+        ASSERT_EQ(index.error_offset(), 82u);
+    }
+
+    auto s = bp::structure::create_from_string<bp::serializers::Json>(doc);
+    ASSERT_EQ(s.at(bp::symbol(std::string(70, 'z') + "\\\"" + std::string(30, '\\')).to_hash()).as<double>(), -2500.0);
+    ASSERT_EQ(s.at("a\\"_h)[2].as<std::string>(), "x\"y");
+    ASSERT_THROW(bp::structure::create_from_string<bp::serializers::Json>("[truex]"), bp::structure::parse_error);
+    ASSERT_THROW(bp::structure::create_from_string<bp::serializers::Json>("[1x]"), bp::structure::parse_error);
+}
+
+TEST(JsonTest, sax) {
+    // collects ids of records and counts events, skipping every "skip" member and arrays of records
+    struct handler : bp::serializers::json_handler {
+        std::vector<int64_t> ids;
+        std::string log;
+        bool id_next = false;
+
+        bool start_object() override {
+            log += '{';
+            return true;
+        }
+        void end_object() override { log += '}'; }
+        bool start_array() override {
+            log += '[';
+            return log.size() < 3;
+        }
+        void end_array() override { log += ']'; }
+        bool key(bp::hash_type _hash, const bp::string_view &_name) override {
+            log += std::string(_name.data(), _name.size()) + ':';
+            id_next = _hash == "id"_h;
+            return _hash != "skip"_h;
+        }
+        void null_value() override { log += 'n'; }
+        void bool_value(bool _val) override { log += _val ? 't' : 'f'; }
+        void int_value(int64_t _val) override {
+            if (id_next) ids.push_back(_val);
+            log += 'i';
+        }
+        void uint_value(uint64_t) override { log += 'u'; }
+        void double_value(double) override { log += 'd'; }
+        void string_value(const bp::string_view &_val) override { log += std::string(_val.data(), _val.size()); }
+    } h;
+
+    bp::serializers::json_reader reader;
+    ASSERT_TRUE(reader.parse("[{\"id\":1,\"skip\":{\"id\":2,\"a\":[\"}\"]},\"x\\n\":\"v\",\"b\":null},"
+                             "{\"id\":3,\"skip\":4,\"f\":1.5,\"u\":18446744073709551615,\"t\":[true]},[{\"id\":5}]]", h));
+    ASSERT_EQ(h.ids, (std::vector<int64_t>{1, 3}));
+    ASSERT_EQ(h.log, "[{id:iskip:x\n:vb:n}{id:iskip:f:du:ut:[}[]");
+
+    ASSERT_THROW(reader.parse("{\"skip\":[1,{]", h), bp::structure::parse_error);
+    ASSERT_THROW(reader.parse("{\"skip\":[1,2] \"a\":1}", h), bp::structure::parse_error);
+
+    auto root = reader.parse("{\"a\":[1,{\"b\":null}]}");
+    ASSERT_TRUE(root && root->get_kind() == bp::serializable::tree::kind::Object);
+    ASSERT_EQ(root->as_object()->size(), 1u);
+}
+
+TEST(JsonTest, lazy) {
+    const std::string doc = "{\"route\": \"a\", \"payload\": {\"x\": [1, 2], \"s\\n\": \"long string value with \\\"escapes\\\"\"},"
+                            " \"list\": [{\"k\": 1}, true, null, -1.5e3, 18446744073709551615]}";
+    auto s = bp::structure::create_from_string<bp::serializers::JsonLazy>(doc);
+    ASSERT_TRUE(s.is_object());
+    ASSERT_EQ(bp::structure_view(s).raw(bp::serializers::Json), doc);
+    ASSERT_EQ(s.serialize<bp::serializers::Json>(), doc);
+
+    ASSERT_EQ(s.at("route"_h).as<std::string>(), "a");
+    ASSERT_TRUE(bp::structure_view(s).raw(bp::serializers::Json).empty());
+    auto copy = s.deepcopy();
+    auto payload = s.at("payload"_h);
+    ASSERT_TRUE(payload.is_object());
+    ASSERT_EQ(bp::structure_view(payload).raw(bp::serializers::Json), "{\"x\": [1, 2], \"s\\n\": \"long string value with \\\"escapes\\\"\"}");
+    auto json = s.serialize<bp::serializers::Json>();
+    ASSERT_NE(json.find("{\"x\": [1, 2], \"s\\n\""), std::string::npos);
+
+    payload["y"_h] = 2;
+    ASSERT_EQ(payload.at("s\n"_h).as<std::string>(), "long string value with \"escapes\"");
+    ASSERT_EQ(payload.at("x"_h)[1].as<int>(), 2);
+    json = s.serialize<bp::serializers::Json>();
+    ASSERT_EQ(json.find("{\"x\": [1, 2]"), std::string::npos);
+    ASSERT_NE(json.find("\"x\":[1,2]"), std::string::npos);
+    ASSERT_FALSE(copy.at("payload"_h).has_key("y"_h));
+
+    auto eager = bp::structure::create_from_string<bp::serializers::Json>(doc);
+    ASSERT_TRUE(eager == bp::structure::create_from_string<bp::serializers::JsonLazy>(doc));
+    ASSERT_TRUE(eager == bp::structure::create_from_string<bp::serializers::Json>(copy.serialize<bp::serializers::Json>()));
+    ASSERT_EQ(bp::structure::create_from_string<bp::serializers::JsonLazy>(" 12 ").as<int>(), 12);
+    ASSERT_EQ(bp::structure::create_from_string<bp::serializers::JsonLazy>("\"\\u00e9\"").as<std::string>(), "\xc3\xa9");
+    ASSERT_THROW(bp::structure::create_from_string<bp::serializers::JsonLazy>("{\"a\":[1,2}"), bp::structure::parse_error);
+}
+
+TEST(JsonTest, ndjson) {
+    using bp::serializers::ndjson_reader;
+    using bp::serializers::ndjson_writer;
+    using bp::serializers::json_framing;
+
+    std::ostringstream out;
+    {
+        ndjson_writer writer(out, json_framing::Lines, 16);
+        for (int i = 0; i < 5; ++i) {
+            bp::structure rec{{"id"_h, i}, {"name"_h, std::string(i * 10, 'x')}};
+            ASSERT_TRUE(writer.write(rec));
+        }
+        ASSERT_TRUE(writer.flush());
+    }
+    auto lines = out.str();
+    ASSERT_EQ(std::count(lines.begin(), lines.end(), '\n'), 5);
+    ASSERT_EQ(lines.substr(0, lines.find('\n')), "{\"id\":0,\"name\":\"\"}");
+
+    // small buffer grows to fit longest record
+    std::istringstream in(lines + "\n  \r\n{\"id\":5,\"name\":\"tail\"}");
+    ndjson_reader reader(in, 16);
+    bp::structure rec;
+    int count = 0;
+    while (reader.next(rec)) {
+        ASSERT_EQ(rec.at("id"_h).as<int>(), count);
+        if (count < 5) {
+            ASSERT_EQ(rec.at("name"_h).as<std::string>(), std::string(count * 10, 'x'));
+        }
+        ++count;
+    }
+    ASSERT_EQ(count, 6);
+    ASSERT_EQ(reader.line(), 8u);
+    ASSERT_TRUE(reader.error().empty());
+    ASSERT_FALSE(reader.next(rec));
+
+    // JSON text sequence through stdio file and descriptor
+    auto file = std::tmpfile();
+    ASSERT_TRUE(file);
+    {
+        ndjson_writer writer(file, json_framing::Sequence);
+        writer.write(bp::structure{{"a"_h, 1}});
+        writer.write(bp::structure({1, 2, 3}));
+    }
+    std::rewind(file);
+    {
+        ndjson_reader seq(file);
+        ASSERT_TRUE(seq.next(rec));
+        ASSERT_EQ(rec.at("a"_h).as<int>(), 1);
+        ASSERT_TRUE(seq.next(rec));
+        ASSERT_EQ(rec.size(), 3u);
+        ASSERT_FALSE(seq.next(rec));
+    }
+    std::rewind(file);
+    auto fd = fileno(file);
+    ASSERT_EQ(lseek(fd, 0, SEEK_SET), 0);
+    {
+        ndjson_reader seq(fd, 4);
+        ASSERT_TRUE(seq.next(rec));
+        ASSERT_TRUE(seq.next(rec));
+        ASSERT_EQ(rec[2].as<int>(), 3);
+        ASSERT_FALSE(seq.next(rec));
+    }
+    std::fclose(file);
+
+    std::istringstream bad("{\"a\":1}\n{\"a\":\n");
+    ndjson_reader bad_reader(bad);
+    ASSERT_TRUE(bad_reader.next(rec));
+    ASSERT_THROW(bad_reader.next(rec), bp::structure::parse_error);
+
+    std::istringstream big("[1,2,3,4,5,6,7,8,9,10]\n");
+    ndjson_reader big_reader(big, 4, 8);
+    ASSERT_THROW(big_reader.next(rec), bp::structure::parse_error);
+    ASSERT_NE(big_reader.error().find("too long"), std::string::npos);
+}
+
+TEST(JsonTest, key_cache) {
+    bp::serializers::key_cache cache(4);
+    ASSERT_EQ(cache.hit_rate(), 0.0);
+    ASSERT_EQ(cache.hash("id"), "id"_h);
+    ASSERT_EQ(cache.hash("id"), "id"_h);
+    ASSERT_EQ(cache.hash("di"), "di"_h);
+    // same length, first and last bytes
+    ASSERT_EQ(cache.hash("prefix_a_suffix"), "prefix_a_suffix"_h);
+    ASSERT_EQ(cache.hash("prefix_b_suffix"), "prefix_b_suffix"_h);
+    auto long_key = std::string(40, 'k');
+    ASSERT_EQ(cache.hash(long_key), bp::symbol(long_key).to_hash());
+    ASSERT_EQ(cache.hash(long_key), bp::symbol(long_key).to_hash());
+    ASSERT_EQ(cache.hits(), 1u);
+    ASSERT_EQ(cache.misses(), 6u);
+    ASSERT_EQ(bp::sym_name("di"_h), "di");
+
+    std::string doc = "[";
+    for (int i = 0; i < 100; ++i) {
+        doc += std::string(i ? "," : "") + "{\"id\":1,\"value\":2.5,\"location\":{\"lat\":1,\"lon\":2}}";
+    }
+    doc += "]";
+    bp::serializers::json_reader reader;
+    auto root = reader.parse(doc);
+    ASSERT_EQ(reader.keys().misses(), 5u);
+    ASSERT_EQ(reader.keys().hits(), 495u);
+    ASSERT_GT(reader.keys().hit_rate(), 0.98);
+    reader.parse(doc);
+    ASSERT_EQ(reader.keys().misses(), 5u);
+
+    auto s = bp::structure::create_from_string<bp::serializers::JsonLazy>(doc);
+    ASSERT_EQ(s[99].at("location"_h).at("lon"_h).as<int>(), 2);
+    ASSERT_TRUE(s == bp::structure::create_from_string<bp::serializers::JsonCpp>(doc));
+}
+
+TEST(JsonTest, zero_copy) {
+    std::string doc = "{\"long\":\"string value longer than node capacity\",\"short\":\"abc\","
+                      "\"esc\":\"escaped \\\"string\\\" is decoded into copy\",\"list\":[\"long string value in array\"]}";
+    auto in_doc = [&doc](const bp::string_view &_v) {
+        return _v.data() >= doc.data() && _v.data() < doc.data() + doc.size();
+    };
+    auto copy = bp::structure::create_from_string<bp::serializers::Json>(doc);
+
+    auto s = bp::structure::create_in_situ<bp::serializers::Json>(doc);
+    ASSERT_TRUE(s.get_zero_copy());
+    ASSERT_TRUE(in_doc(s.at("long"_h).str_view()));
+    ASSERT_TRUE(s.at("long"_h).str_view() == bp::string_view("string value longer than node capacity"));
+    ASSERT_TRUE(in_doc(s.at("list"_h)[0].str_view()));
+    ASSERT_FALSE(in_doc(s.at("short"_h).str_view()));
+    ASSERT_FALSE(in_doc(s.at("esc"_h).str_view()));
+    ASSERT_EQ(s.at("esc"_h).as<std::string>(), "escaped \"string\" is decoded into copy");
+    ASSERT_EQ(s.at("long"_h).as<std::string>(), "string value longer than node capacity");
+    ASSERT_TRUE(s.at("long"_h).is_string());
+    ASSERT_TRUE(s == copy);
+    ASSERT_EQ(s.serialize<bp::serializers::Json>(), copy.serialize<bp::serializers::Json>());
+
+    bp::arena arena;
+    {
+        auto lazy = bp::structure::create_in_situ<bp::serializers::JsonLazy>(doc, &arena);
+        ASSERT_EQ(bp::structure_view(lazy).raw(bp::serializers::Json).data(), doc.data());
+        ASSERT_TRUE(in_doc(lazy.at("long"_h).str_view()));
+        ASSERT_TRUE(lazy == copy);
+    }
+
+    // snapshots own their strings
+    bp::persistent_structure p(s);
+    doc.replace(doc.find("string value"), 6, "STRING");
+    ASSERT_EQ(s.at("long"_h).as<std::string>(), "STRING value longer than node capacity");
+    ASSERT_EQ(p.at("long"_h).as<std::string>(), "string value longer than node capacity");
+}
+
+TEST(JsonTest, push_parser) {
+    using bp::serializers::push_status;
+    std::string doc = "{\"id\":-12,\"name\":\"caf\\u00e9 \\ud83d\\ude00 \\\"q\\\"\",\"list\":[1.5e3,true,false,null,[],{}],"
+                      "\"u\":18446744073709551615,\"nested\":{\"k\":\"long string value without escapes\"}}";
+    auto expected = bp::structure::create_from_string<bp::serializers::Json>(doc);
+
+    // document split at every byte boundary
+    bp::serializers::json_push_parser parser;
+    for (size_t step = 1; step <= doc.size(); step = step * 2 + 1) {
+        for (size_t i = 0; i < doc.size(); i += step) {
+            auto chunk = doc.substr(i, step);
+            auto st = parser.feed(chunk);
+            ASSERT_EQ(st, i + step >= doc.size() ? push_status::Complete : push_status::NeedMore) << i;
+            ASSERT_EQ(parser.consumed(), chunk.size());
+        }
+        bp::structure s;
+        ASSERT_TRUE(parser.take(s));
+        ASSERT_TRUE(s == expected);
+        ASSERT_EQ(s.at("name"_h).as<std::string>(), "caf\xc3\xa9 \xf0\x9f\x98\x80 \"q\"");
+    }
+
+    // several documents in one chunk, top-level number ends with delimiter or end of input
+    std::string stream = " {\"a\":1}\n[2, 3] 42\n7";
+    bp::string_view rest(stream);
+    std::vector<std::string> docs;
+    bp::structure s;
+    while (parser.feed(rest) == push_status::Complete) {
+        ASSERT_TRUE(parser.take(s));
+        docs.push_back(s.serialize<bp::serializers::Json>());
+        rest = bp::string_view(rest.data() + parser.consumed(), rest.size() - parser.consumed());
+    }
+    ASSERT_EQ(parser.finish(), push_status::Complete);
+    ASSERT_TRUE(parser.take(s));
+    docs.push_back(s.serialize<bp::serializers::Json>());
+    ASSERT_EQ(docs, (std::vector<std::string>{"{\"a\":1}", "[2,3]", "42", "7"}));
+    ASSERT_EQ(parser.finish(), push_status::NeedMore);
+
+    // errors
+    ASSERT_EQ(parser.feed("[1, 2"), push_status::NeedMore);
+    ASSERT_THROW(parser.finish(), bp::structure::parse_error);
+    parser.reset();
+    ASSERT_EQ(parser.feed("[1, "), push_status::NeedMore);
+    try {
+        parser.feed("]");
+        FAIL();
+    } catch (bp::structure::parse_error &) {
+        ASSERT_EQ(parser.error(), "unexpected character at offset 4");
+    }
+    for (std::string bad : {"{\"a\" 1}", "[1 2]", "[tru]", "\"\x01\"", "[1.2.3]", "{\"a\":1]", "\"\\x\""}) {
+        parser.reset();
+        ASSERT_THROW(parser.feed(bad), bp::structure::parse_error) << bad;
+    }
+    parser.reset();
+    ASSERT_THROW(parser.feed(std::string(bp::serializers::json_reader::max_depth + 1, '[')),
+                 bp::structure::parse_error);
+
+    // events are reported to handler as chunks arrive, skipped subtrees are not reported
+    struct handler : bp::serializers::json_handler {
+        std::string log;
+
+        bool start_object() override {
+            log += '{';
+            return true;
+        }
+        void end_object() override { log += '}'; }
+        bool start_array() override {
+            log += '[';
+            return false;
+        }
+        bool key(bp::hash_type _hash, const bp::string_view &_name) override {
+            log += std::string(_name.data(), _name.size()) + ':';
+            return _hash != "skip"_h;
+        }
+        void int_value(int64_t) override { log += 'i'; }
+        void string_value(const bp::string_view &_val) override { log += std::string(_val.data(), _val.size()); }
+    } h;
+    bp::serializers::json_push_parser sax(h);
+    ASSERT_EQ(sax.feed("{\"a\":1,\"skip\":{\"b\":[1,{\"c\":2}]},\"l\":[{\"d\":"), push_status::NeedMore);
+    ASSERT_EQ(h.log, "{a:iskip:l:[");
+    ASSERT_EQ(sax.feed("3}],\"e\":\"x\"}"), push_status::Complete);
+    ASSERT_EQ(h.log, "{a:iskip:l:[e:x}");
+    ASSERT_FALSE(sax.take(s));
+}
+
+TEST(JsonTest, in_situ_parser) {
+    std::string doc = " {\"id\":-12,\"name\":\"caf\\u00e9 \\ud83d\\ude00 \\\"quoted\\\" with escapes\",\"list\":[1.5e3,true,false,null,[],{}],"
+                      "\"u\":18446744073709551615,\"nested\":{\"k\":\"long string value without escapes\"}} ";
+    auto expected = bp::structure::create_from_string<bp::serializers::Json>(doc);
+
+    // strings are decoded inside buffer and referenced from it
+    bp::arena arena;
+    bp::serializers::json_in_situ_parser parser(&arena);
+    parser.set_zero_copy(true);
+    std::vector<char> buf(doc.begin(), doc.end());
+    bp::structure s;
+    ASSERT_TRUE(parser.parse(buf.data(), buf.size(), s));
+    ASSERT_TRUE(s == expected);
+    auto in_buf = [&buf](const bp::string_view &_v) {
+        return _v.data() >= buf.data() && _v.data() < buf.data() + buf.size();
+    };
+    ASSERT_EQ(s.at("name"_h).as<std::string>(), "caf\xc3\xa9 \xf0\x9f\x98\x80 \"quoted\" with escapes");
+    ASSERT_TRUE(in_buf(s.at("name"_h).str_view()));
+    ASSERT_TRUE(in_buf(s.at("nested"_h).at("k"_h).str_view()));
+    ASSERT_EQ(parser.stats().nodes, 13u);
+    ASSERT_EQ(parser.stats().depth, 3u);
+    ASSERT_GT(parser.stats().stack_bytes, 0u);
+    ASSERT_EQ(parser.stats().tree_bytes, arena.used());
+    ASSERT_EQ(parser.stats().high_water(), parser.stats().stack_bytes + arena.used());
+
+    // any value is root
+    const char *roots[] = {"[1,[2,{\"a\":\"b\"}]]", "\"x\\ny\"", "-0.5", "true", "null", "[]"};
+    for (auto root: roots) {
+        std::string text(root);
+        ASSERT_TRUE(parser.parse(&text[0], text.size(), s)) << root;
+        ASSERT_TRUE(s == bp::structure::create_from_string<bp::serializers::Json>(root)) << root;
+    }
+
+    const char *malformed[] = {"", "{", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "tru", "01x", "\"abc", "\"\\x\"",
+                               "\"\\ud83d\"", "1 2", "[1.]", "-", "{1:2}", "[1}", "\"\x01\""};
+    for (auto bad: malformed) {
+        std::string text(bad);
+        ASSERT_THROW(parser.parse(&text[0], text.size()), bp::structure::parse_error) << bad;
+    }
+    std::string deep(bp::serializers::json_in_situ_parser::max_depth + 1, '[');
+    try {
+        parser.parse(&deep[0], deep.size());
+        FAIL();
+    } catch (bp::structure::parse_error &) {
+        ASSERT_EQ(parser.error(), "nesting is too deep at offset 512");
+    }
+}
+#endif
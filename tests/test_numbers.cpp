@@ -0,0 +1,143 @@
+#include "numbers.hpp"
+#include "structure_view.hpp"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace {
+    std::string format(double _val) {
+        char buf[bp::max_number_chars];
+        return std::string(buf, bp::format_double(buf, _val));
+    }
+
+    std::string format(float _val) {
+        char buf[bp::max_number_chars];
+        return std::string(buf, bp::format_float(buf, _val));
+    }
+
+    double parse(const std::string &_s) {
+        bp::decimal_number num;
+        auto end = bp::scan_number(_s.data(), _s.data() + _s.size(), num);
+        EXPECT_EQ(end, _s.data() + _s.size()) << _s;
+        return bp::to_double(num, _s.data(), end);
+    }
+
+    bool same_bits(double _a, double _b) {
+        return std::memcmp(&_a, &_b, sizeof(_a)) == 0;
+    }
+}
+
+TEST(NumbersTest, integers) {
+    char buf[bp::max_number_chars];
+    std::mt19937_64 rnd(1);
+    for (uint64_t p = 1; p; p = p > UINT64_MAX / 10 ? 0 : p * 10) {
+        for (auto v : {p - 1, p, p + 1, rnd() % p}) {
+            ASSERT_EQ(std::string(buf, bp::format_uint(buf, v)), std::to_string(v));
+            auto s = static_cast<int64_t>(v);
+            ASSERT_EQ(std::string(buf, bp::format_int(buf, -s)), std::to_string(-s));
+        }
+    }
+    for (int i = 0; i < 100000; ++i) {
+        auto v = rnd() >> (rnd() % 64);
+        ASSERT_EQ(std::string(buf, bp::format_uint(buf, v)), std::to_string(v));
+    }
+    ASSERT_EQ(std::string(buf, bp::format_uint(buf, UINT64_MAX)), "18446744073709551615");
+    ASSERT_EQ(std::string(buf, bp::format_int(buf, INT64_MIN)), "-9223372036854775808");
+    ASSERT_EQ(std::string(buf, bp::format_int(buf, 0)), "0");
+
+    bp::decimal_number num;
+    std::string s = "18446744073709551615";
+    ASSERT_EQ(bp::scan_number(s.data(), s.data() + s.size(), num), s.data() + s.size());
+    ASSERT_EQ(num.mantissa, UINT64_MAX);
+    ASSERT_FALSE(num.truncated || num.fractional || num.exponent);
+    s = "18446744073709551616";
+    bp::scan_number(s.data(), s.data() + s.size(), num);
+    ASSERT_TRUE(num.truncated);
+    ASSERT_EQ(parse(s), 18446744073709551616.0);
+}
+
+TEST(NumbersTest, format_shortest) {
+    ASSERT_EQ(format(0.0), "0");
+    ASSERT_EQ(format(-0.0), "-0");
+    ASSERT_EQ(format(0.1), "0.1");
+    ASSERT_EQ(format(0.3), "0.3");
+    ASSERT_EQ(format(1.0 / 3), "0.3333333333333333");
+    ASSERT_EQ(format(100.0), "100");
+    ASSERT_EQ(format(-1.5), "-1.5");
+    ASSERT_EQ(format(123456.789), "123456.789");
+    ASSERT_EQ(format(0.0001), "0.0001");
+    ASSERT_EQ(format(2.5e-7), "2.5e-7");
+    ASSERT_EQ(format(1e100), "1e+100");
+    ASSERT_EQ(format(5e-324), "5e-324");
+    ASSERT_EQ(format(std::numeric_limits<double>::max()), "1.7976931348623157e+308");
+    ASSERT_EQ(format(std::numeric_limits<double>::infinity()), "inf");
+    ASSERT_EQ(format(std::nan("")), "nan");
+    ASSERT_EQ(format(0.1f), "0.1");
+    ASSERT_EQ(format(16777216.0f), "16777216");
+    ASSERT_EQ(format(std::numeric_limits<float>::max()), "3.4028235e+38");
+    ASSERT_EQ(format(std::numeric_limits<float>::denorm_min()), "1e-45");
+
+    bp::structure s(0.1);
+    ASSERT_EQ(s.as<std::string>(), "0.1");
+    s = 1.5f;
+    ASSERT_EQ(s.as<std::string>(), "1.5");
+}
+
+TEST(NumbersTest, round_trip) {
+    std::mt19937_64 rnd(2);
+    char buf[bp::max_number_chars];
+    for (int i = 0; i < 200000; ++i) {
+        auto bits = rnd();
+        double val;
+        std::memcpy(&val, &bits, sizeof(val));
+        if (!std::isfinite(val)) continue;
+        auto s = format(val);
+        ASSERT_TRUE(same_bits(std::strtod(s.c_str(), nullptr), val)) << s;
+        ASSERT_TRUE(same_bits(parse(s), val)) << s;
+        // never longer than fixed 17 digit formatting
+        ASSERT_LE(s.size(), static_cast<size_t>(std::snprintf(buf, sizeof(buf), "%.17g", val))) << s;
+    }
+    // stride over all float bit patterns
+    for (uint64_t bits = 0; bits <= UINT32_MAX; bits += 16381) {
+        auto b = static_cast<uint32_t>(bits);
+        float val;
+        std::memcpy(&val, &b, sizeof(val));
+        if (!std::isfinite(val)) continue;
+        auto s = format(val);
+        auto back = std::strtof(s.c_str(), nullptr);
+        ASSERT_EQ(std::memcmp(&back, &val, sizeof(val)), 0) << s;
+    }
+}
+
+TEST(NumbersTest, parse) {
+    ASSERT_TRUE(same_bits(parse("-0.0"), -0.0));
+    ASSERT_EQ(parse("0e999"), 0.0);
+    ASSERT_EQ(parse("1e400"), std::numeric_limits<double>::infinity());
+    ASSERT_EQ(parse("1e-400"), 0.0);
+    ASSERT_EQ(parse("0.000000000000000000001234"), 1.234e-21);
+    ASSERT_EQ(parse("123456789012345678901234567890e-10"), 12345678901234567890.1234567890);
+
+    bp::decimal_number num;
+    for (std::string bad : {"", "-", "01", "1.", ".5", "1e", "1e+", "+1"}) {
+        auto end = bp::scan_number(bad.data(), bad.data() + bad.size(), num);
+        ASSERT_TRUE(!end || end != bad.data() + bad.size()) << bad;
+    }
+
+    std::mt19937_64 rnd(3);
+    char buf[64];
+    for (int i = 0; i < 100000; ++i) {
+        auto bits = rnd();
+        double val;
+        std::memcpy(&val, &bits, sizeof(val));
+        if (!std::isfinite(val)) continue;
+        std::snprintf(buf, sizeof(buf), "%.*g", static_cast<int>(1 + rnd() % 19), val);
+        ASSERT_TRUE(same_bits(parse(buf), std::strtod(buf, nullptr))) << buf;
+        std::snprintf(buf, sizeof(buf), "%llue%d", static_cast<unsigned long long>(rnd() % 100000000),
+                      static_cast<int>(rnd() % 50) - 25);
+        ASSERT_TRUE(same_bits(parse(buf), std::strtod(buf, nullptr))) << buf;
+    }
+}
@@ -0,0 +1,146 @@
+#include "persistent_structure.hpp"
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <binelpro/symbol.hpp>
+
+using namespace bp::literals;
+
+TEST(PersistentTest, versions) {
+    auto v0 = bp::persistent_structure::create_object();
+    auto v1 = v0.set("a"_h, 1).set("b"_h, "string which does not fit into node");
+    auto v2 = v1.set_in({"nested"_h, "value"_h}, 2.5f);
+    auto v3 = v2.set("a"_h, 10).erase("b"_h);
+
+    ASSERT_TRUE(v0.empty());
+    ASSERT_EQ(v1.size(), 2);
+    ASSERT_EQ(v1.at("a"_h).as<int>(), 1);
+    ASSERT_EQ(v1.at("b"_h).as<std::string>(), "string which does not fit into node");
+    ASSERT_FALSE(v1.has_key("nested"_h));
+    ASSERT_FLOAT_EQ(v2.at("nested"_h).at("value"_h).as<float>(), 2.5f);
+    ASSERT_EQ(v3.size(), 2);
+    ASSERT_EQ(v3.at("a"_h).as<int>(), 10);
+    ASSERT_FALSE(v3.has_key("b"_h));
+    ASSERT_EQ(v2.at("a"_h).as<int>(), 1);
+    ASSERT_TRUE(v3.at("nested"_h).same(v2.at("nested"_h)));
+    ASSERT_THROW(v1.at("missing"_h), std::out_of_range);
+    ASSERT_THROW(v1.append(1), bp::structure::type_error);
+
+    auto arr = bp::persistent_structure::create_array();
+    for (int i = 0; i < 2000; ++i) {
+        arr = arr.append(i);
+    }
+    auto changed = arr.set(1500, -1);
+    ASSERT_EQ(arr.size(), 2000);
+    ASSERT_EQ(arr.at(1500).as<int>(), 1500);
+    ASSERT_EQ(changed.at(1500).as<int>(), -1);
+    int expected = 0;
+    arr.for_each_element([&](const bp::persistent_structure &_v) {
+        ASSERT_EQ(_v.as<int>(), expected++);
+    });
+    ASSERT_EQ(expected, 2000);
+}
+
+TEST(PersistentTest, matches_map) {
+    std::mt19937 rnd(7);
+    std::map<uint32_t, int> reference;
+    auto obj = bp::persistent_structure::create_object();
+    for (int i = 0; i < 20000; ++i) {
+        uint32_t key = rnd() % 3000;
+        if (rnd() % 3) {
+            obj = obj.set(bp::hash_type(key), i);
+            reference[key] = i;
+        } else {
+            obj = obj.erase(bp::hash_type(key));
+            reference.erase(key);
+        }
+        ASSERT_EQ(obj.size(), reference.size());
+    }
+    for (const auto &kv: reference) {
+        ASSERT_EQ(obj.at(bp::hash_type(kv.first)).as<int>(), kv.second);
+    }
+    size_t count = 0;
+    obj.for_each_item([&](const bp::hash_type &_key, const bp::persistent_structure &_v) {
+        ASSERT_EQ(reference.at(_key), _v.as<int>());
+        ++count;
+    });
+    ASSERT_EQ(count, reference.size());
+}
+
+TEST(PersistentTest, conversion) {
+    bp::structure s;
+    s["int"] = 1;
+    s["str"] = "string which does not fit into node";
+    s["list"].append(1);
+    s["list"].append("two");
+    s["obj"]["k"] = true;
+
+    bp::persistent_structure p(s);
+    ASSERT_TRUE(p.is_object());
+    ASSERT_EQ(p.at("list"_h).size(), 2);
+    ASSERT_EQ(p.at("list"_h).at(1).as<std::string>(), "two");
+    s["int"] = 2;
+    ASSERT_EQ(p.at("int"_h).as<int>(), 1);
+
+    auto back = p.to_structure();
+    ASSERT_EQ(back.at("int"_h).as<int>(), 1);
+    ASSERT_EQ(back.at("str"_h).as<std::string>(), "string which does not fit into node");
+    ASSERT_EQ(back.at("obj"_h).at("k"_h).as<bool>(), true);
+    ASSERT_TRUE(bp::persistent_structure(back) == p);
+
+    bp::arena arena;
+    auto in_arena = p.to_structure(arena);
+    ASSERT_EQ(in_arena.get_arena(), &arena);
+    ASSERT_EQ(in_arena.at("list"_h)[0].as<int>(), 1);
+}
+
+TEST(PersistentTest, diff) {
+    auto v1 = bp::persistent_structure::create_object();
+    for (int i = 0; i < 100; ++i) {
+        v1 = v1.set(bp::hash_type(static_cast<uint32_t>(i)), i);
+    }
+    v1 = v1.set("list"_h, bp::persistent_structure::create_array().append(1).append(2));
+    auto v2 = v1.set(bp::hash_type(5), 50)
+                .erase(bp::hash_type(7))
+                .set(bp::hash_type(1000), "new")
+                .set_in({"list"_h}, v1.at("list"_h).set(1, 3));
+
+    std::map<uint32_t, std::pair<bp::persistent_structure, bp::persistent_structure>> changes;
+    size_t list_changes = 0;
+    bp::persistent_structure::diff(v1, v2, [&](const bp::persistent_structure::path &_path,
+                                               const bp::persistent_structure &_old,
+                                               const bp::persistent_structure &_new) {
+        if (_path.size() == 2) {
+            ASSERT_TRUE(_path[0].key == "list"_h);
+            ASSERT_TRUE(_path[1].is_index);
+            ASSERT_EQ(_path[1].index, 1);
+            ASSERT_EQ(_new.as<int>(), 3);
+            ++list_changes;
+            return;
+        }
+        ASSERT_EQ(_path.size(), 1);
+        changes.emplace(_path[0].key, std::make_pair(_old, _new));
+    });
+    ASSERT_EQ(list_changes, 1);
+    ASSERT_EQ(changes.size(), 3);
+    ASSERT_EQ(changes.at(5).second.as<int>(), 50);
+    ASSERT_TRUE(changes.at(7).second.is_null());
+    ASSERT_TRUE(changes.at(1000).first.is_null());
+}
+
+TEST(PersistentTest, threads) {
+    auto v = bp::persistent_structure::create_object().set("counter"_h, 0);
+    auto snapshot = v;
+    std::thread reader([snapshot]() {
+        for (int i = 0; i < 1000; ++i) {
+            ASSERT_EQ(snapshot.at("counter"_h).as<int>(), 0);
+        }
+    });
+    for (int i = 1; i < 1000; ++i) {
+        v = v.set("counter"_h, i);
+    }
+    reader.join();
+    ASSERT_EQ(v.at("counter"_h).as<int>(), 999);
+}
@@ -2,6 +2,8 @@
 #include <gtest/gtest.h>
 #include <string>
 #include <algorithm>
+#include <limits>
+#include <set>
 #include <binelpro/symbol.hpp>
 
 using namespace bp::literals;
@@ -168,7 +170,7 @@ TEST(StructTest, data_types) {
     s["a"] = 1.0f;
     v = s.at("a"_h);
     ASSERT_EQ(v.as<int>(), 1) << "as<int>()(float)";
-    ASSERT_EQ(v.as<std::string>(), std::to_string(1.0)) << "as<std::string>()(float)";
+    ASSERT_EQ(v.as<std::string>(), std::string("1")) << "as<std::string>()(float)";
     ASSERT_EQ(v.as<bool>(), false) << "as<bool>()(float)";
     ASSERT_EQ(v.as<float>(), 1.0) << "as<float>()(float)";
 
@@ -330,4 +332,265 @@ TEST(StructTest, getters) {
     ASSERT_EQ(s.get<bool>("b"_h), s.at("b"_h).as<bool>());
     ASSERT_EQ(s.get<std::string>("s"_h), s.at("s"_h).as<std::string>());
     ASSERT_EQ(s.get<std::string>("s"_h), "s");
-}
\ No newline at end of file
+}
+
+TEST(StructTest, container_equality) {
+    auto empty = bp::structure::create_object();
+    auto array = bp::structure::create_array();
+    ASSERT_TRUE(empty == bp::structure::create_object());
+    ASSERT_TRUE(array == bp::structure::create_array());
+    ASSERT_FALSE(empty == array);
+
+    bp::structure a, b;
+    a["x"] = 1;
+    b["x"] = 1;
+    ASSERT_TRUE(a == b);
+    b["y"] = 2;
+    ASSERT_FALSE(a == b);
+    ASSERT_FALSE(b == a);
+    ASSERT_FALSE(bp::structure({1, 2}) == bp::structure({1, 2, 3}));
+    ASSERT_FALSE(bp::structure({1, 2, 3}) == bp::structure({1, 2}));
+}
+
+TEST(StructTest, inline_scalars) {
+    bp::structure s;
+    s["short"] = "short";
+    s["long"] = "string which does not fit into node";
+    s["f"] = 2.5;
+    s["n"] = nullptr;
+
+    ASSERT_EQ(s.at("short"_h).as<std::string>(), "short");
+    ASSERT_EQ(s.at("long"_h).as<std::string>(), "string which does not fit into node");
+    ASSERT_TRUE(s.at("f"_h).is_float());
+    ASSERT_EQ(s.at("f"_h).as<float>(), 2.5);
+    ASSERT_TRUE(s.at("n"_h).is_null());
+
+    auto copy = s.deepcopy();
+    s["long"] = 1;
+    ASSERT_EQ(copy.at("long"_h).as<std::string>(), "string which does not fit into node");
+    ASSERT_TRUE(s.at("long"_h).is_int());
+}
+
+TEST(StructTest, numeric_lanes) {
+    bp::structure s;
+    s["small"] = 100;
+    s["id"] = int64_t(1) << 53 | 1;
+    s["big"] = std::numeric_limits<uint64_t>::max();
+    s["neg"] = std::numeric_limits<int64_t>::min();
+    s["d"] = 0.1;
+    s["f"] = 0.5f;
+
+    ASSERT_EQ(s.at("small"_h).as<int32_t>(), 100);
+    ASSERT_EQ(s.at("id"_h).as<int64_t>(), (int64_t(1) << 53) | 1);
+    ASSERT_TRUE(s.at("big"_h).is_int());
+    ASSERT_EQ(s.at("big"_h).as<uint64_t>(), std::numeric_limits<uint64_t>::max());
+    ASSERT_EQ(s.at("neg"_h).as<int64_t>(), std::numeric_limits<int64_t>::min());
+    ASSERT_EQ(s.at("d"_h).as<double>(), 0.1);
+    ASSERT_EQ(s.at("f"_h).as<float>(), 0.5f);
+    ASSERT_EQ(s.at("id"_h).as<std::string>(), "9007199254740993");
+
+    bp::serializable::tree small(100), mid(40000), wide(int64_t(1) << 40), f(0.5), d(0.1);
+    ASSERT_EQ(small.num_width(), 1);
+    ASSERT_EQ(mid.num_width(), 4);
+    ASSERT_EQ(wide.num_width(), 8);
+    ASSERT_EQ(f.num_width(), 4);
+    ASSERT_EQ(d.num_width(), 8);
+}
+
+TEST(StructTest, arena) {
+    bp::arena arena(1024);
+    {
+        bp::structure s(arena);
+        s.emplace("i", 1);
+        s.emplace("s", "string which does not fit into node");
+        s.create_array("a");
+        s["a"].append(1);
+        s["a"].append({{"k", "v"}});
+        s["o"]["n"] = 2;
+
+        ASSERT_EQ(s.get_arena(), &arena);
+        ASSERT_EQ(s.at("a"_h).get_arena(), &arena);
+        ASSERT_EQ(s.at("i"_h).as<int>(), 1);
+        ASSERT_EQ(s.at("s"_h).as<std::string>(), "string which does not fit into node");
+        ASSERT_EQ(s.at("a"_h).size(), 2);
+        ASSERT_EQ(s.at("a"_h)[1]["k"].as<std::string>(), "v");
+        ASSERT_EQ(s.at("o"_h).at("n"_h).as<int>(), 2);
+        ASSERT_GT(arena.used(), 0);
+
+        // assigned long string goes to arena as well
+        auto used = arena.used();
+        s["s"] = "replacement string which does not fit into node";
+        ASSERT_GT(arena.used(), used);
+        ASSERT_EQ(s.at("s"_h).as<std::string>(), "replacement string which does not fit into node");
+        s["s"] = "string which does not fit into node";
+
+        auto heap = bp::structure::create_object();
+        heap.emplace("copy", s);
+        ASSERT_EQ(heap.at("copy"_h).at("s"_h).as<std::string>(), "string which does not fit into node");
+        s.reset();
+        arena.release();
+        ASSERT_EQ(arena.used(), 0);
+        ASSERT_EQ(heap.at("copy"_h).at("a"_h)[1]["k"].as<std::string>(), "v");
+    }
+}
+
+TEST(StructTest, small_containers) {
+    bp::structure s;
+    std::vector<std::string> keys;
+    for (int i = 0; i < 20; ++i) {
+        keys.push_back("key" + std::to_string(i));
+        s[keys.back()] = i;
+        ASSERT_EQ(s.size(), i + 1);
+        for (int j = 0; j <= i; ++j) {
+            ASSERT_TRUE(s.has_key(bp::symbol(keys[j]).to_hash()));
+            ASSERT_EQ(s.at(bp::symbol(keys[j]).to_hash()).as<int>(), j);
+        }
+    }
+    std::set<bp::hash_type::type> seen;
+    for (auto kv: s.as_object()) {
+        ASSERT_TRUE(seen.insert(kv.first).second);
+    }
+    ASSERT_EQ(seen.size(), 20);
+    for (int i = 0; i < 20; i += 2) {
+        ASSERT_TRUE(s.erase(bp::symbol(keys[i]).to_hash()));
+    }
+    ASSERT_EQ(s.size(), 10);
+    ASSERT_FALSE(s.has_key(bp::symbol(keys[0]).to_hash()));
+    ASSERT_EQ(s.at(bp::symbol(keys[1]).to_hash()).as<int>(), 1);
+
+    bp::structure small;
+    small["a"] = 1;
+    small["b"] = 2;
+    small["c"] = 3;
+    ASSERT_TRUE(small.erase("b"_h));
+    ASSERT_FALSE(small.has_key("b"_h));
+    ASSERT_EQ(small.at("c"_h).as<int>(), 3);
+
+    bp::structure arr = bp::structure::create_array();
+    for (int i = 0; i < 10; ++i) {
+        arr.append(i);
+        ASSERT_EQ(arr.size(), i + 1);
+    }
+    int i = 0;
+    for (auto v: arr.as_array()) {
+        ASSERT_EQ(v.as<int>(), i++);
+    }
+    auto copy = arr.deepcopy();
+    ASSERT_TRUE(copy == arr);
+}
+
+TEST(StructTest, copy_on_write) {
+    bp::structure tpl;
+    tpl["name"] = "template";
+    tpl["nested"]["list"].append(1);
+    tpl["nested"]["list"].append(2);
+    tpl["nested"]["deep"]["v"] = 1;
+
+    auto copy = tpl.deepcopy();
+    ASSERT_TRUE(copy == tpl);
+
+    copy["nested"]["deep"]["v"] = 2;
+    copy["nested"]["list"].append(3);
+    copy["name"] = "copy";
+    ASSERT_EQ(tpl.at("nested"_h).at("deep"_h).at("v"_h).as<int>(), 1);
+    ASSERT_EQ(tpl.at("nested"_h).at("list"_h).size(), 2);
+    ASSERT_EQ(tpl.at("name"_h).as<std::string>(), "template");
+    ASSERT_EQ(copy.at("nested"_h).at("deep"_h).at("v"_h).as<int>(), 2);
+    ASSERT_EQ(copy.at("nested"_h).at("list"_h).size(), 3);
+
+    // aliases taken after copy are detached from it
+    auto copy2 = tpl.deepcopy();
+    auto alias = tpl["nested"]["deep"];
+    tpl["name"] = "changed";
+    alias["v"] = 5;
+    ASSERT_EQ(tpl.at("nested"_h).at("deep"_h).at("v"_h).as<int>(), 5);
+    ASSERT_EQ(copy2.at("nested"_h).at("deep"_h).at("v"_h).as<int>(), 1);
+    ASSERT_EQ(copy2.at("name"_h).as<std::string>(), "template");
+
+    copy2["nested"]["list"].clear();
+    ASSERT_EQ(copy2.at("nested"_h).at("list"_h).size(), 0);
+    ASSERT_EQ(tpl.at("nested"_h).at("list"_h).size(), 2);
+    ASSERT_TRUE(copy2.erase("name"_h));
+    ASSERT_TRUE(tpl.has_key("name"_h));
+
+    bp::structure merged;
+    merged.merge(tpl);
+    merged["nested"]["deep"]["v"] = 7;
+    ASSERT_EQ(tpl.at("nested"_h).at("deep"_h).at("v"_h).as<int>(), 5);
+}
+
+TEST(StructTest, copy_on_write_aliases) {
+    bp::structure tpl;
+    tpl["deep"]["v"] = 1;
+    tpl["list"].append(bp::structure{1});
+    tpl["obj"]["inner"]["v"] = 1;
+
+    // aliases taken before copy write into source only
+    auto early = tpl["deep"];
+    auto copy = tpl.deepcopy();
+    early["v"] = 2;
+    ASSERT_EQ(tpl.at("deep"_h).at("v"_h).as<int>(), 2);
+    ASSERT_EQ(copy.at("deep"_h).at("v"_h).as<int>(), 1);
+    early["v"] = 1;
+
+    // items obtained through const access never write into source
+    const bp::structure &ccopy = copy;
+    auto item = ccopy.at("deep"_h);
+    item["v"] = 3;
+    ASSERT_EQ(tpl.at("deep"_h).at("v"_h).as<int>(), 1);
+    const auto list = ccopy.at("list"_h);
+    for (auto entry: list.as_array()) {
+        entry.append(2);
+    }
+    ASSERT_EQ(tpl.at("list"_h).at(0).size(), 1);
+    const auto obj = ccopy.at("obj"_h);
+    for (auto entry: obj.as_object()) {
+        entry.second["v"] = 4;
+    }
+    ASSERT_EQ(tpl.at("obj"_h).at("inner"_h).at("v"_h).as<int>(), 1);
+
+    // assignment aliases copy the same way as any other structure
+    bp::structure alias;
+    alias = copy;
+    alias["deep"]["v"] = 5;
+    ASSERT_EQ(copy.at("deep"_h).at("v"_h).as<int>(), 5);
+    ASSERT_EQ(tpl.at("deep"_h).at("v"_h).as<int>(), 1);
+
+    // copy of copy stays independent from both
+    auto copy2 = copy.deepcopy();
+    copy["list"][0].append(6);
+    ASSERT_EQ(copy2.at("list"_h).at(0).size(), 1);
+    ASSERT_EQ(tpl.at("list"_h).at(0).size(), 1);
+}
+
+TEST(StructTest, bulk_build) {
+    std::vector<int> ints(1000);
+    for (int i = 0; i < 1000; ++i) ints[i] = i;
+    std::vector<std::string> strings{"a", "string which does not fit into node"};
+
+    bp::structure arr;
+    ASSERT_TRUE(arr.append(ints));
+    ASSERT_TRUE(arr.append(strings.begin(), strings.end()));
+    ASSERT_EQ(arr.size(), 1002);
+    ASSERT_EQ(arr[999].as<int>(), 999);
+    ASSERT_EQ(arr[1001].as<std::string>(), "string which does not fit into node");
+    ASSERT_TRUE(arr.reserve(5000));
+    ASSERT_THROW(bp::structure(1).reserve(1), bp::structure::type_error);
+    bp::structure obj(bp::structure::value_type::Object);
+    ASSERT_THROW(obj.append(ints), bp::structure::type_error);
+    ASSERT_TRUE(obj.reserve(100));
+
+    bp::arena arena;
+    bp::structure::object_builder builder(3, &arena);
+    auto built = builder.add("id"_h, 42)
+                        .add("name"_h, std::string("string which does not fit into node"))
+                        .add("list"_h, arr)
+                        .add("id"_h, 43)
+                        .build();
+    ASSERT_TRUE(built.is_object());
+    ASSERT_EQ(built.get_arena(), &arena);
+    ASSERT_EQ(built.size(), 3);
+    ASSERT_EQ(built.at("id"_h).as<int>(), 43);
+    ASSERT_EQ(built.at("name"_h).as<std::string>(), "string which does not fit into node");
+    ASSERT_EQ(built.at("list"_h).size(), 1002);
+}
@@ -0,0 +1,69 @@
+#include "structure_view.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <binelpro/symbol.hpp>
+
+using namespace bp::literals;
+
+TEST(ViewTest, read_api) {
+    bp::structure s;
+    s["int"] = 5;
+    s["float"] = 1.5f;
+    s["str"] = "string which does not fit into node";
+    s["bool"] = "false";
+    s["list"].append(1);
+    s["list"].append(2);
+    s["list"].append(3);
+    s["obj"]["k"] = 1;
+
+    bp::structure_view v = s;
+    ASSERT_TRUE(v.is_object());
+    ASSERT_EQ(v.size(), 6);
+    ASSERT_TRUE(v.has_key("int"_h));
+    ASSERT_EQ(v.at("int"_h).as<int32_t>(), 5);
+    ASSERT_EQ(v.at("int"_h).as<std::string>(), s.at("int"_h).as<std::string>());
+    ASSERT_FLOAT_EQ(v.at("float"_h).as<float>(), 1.5f);
+    ASSERT_EQ(v.at("float"_h).as<uint8_t>(), 1);
+    ASSERT_EQ(v.at("str"_h).as<std::string>(), "string which does not fit into node");
+    ASSERT_EQ(v.at("str"_h).str_size(), 35);
+    ASSERT_FALSE(v.at("bool"_h).as<bool>());
+    ASSERT_EQ(v.get<int>("int"_h), 5);
+    ASSERT_EQ(v.get<int>("missing"_h, 7), 7);
+    ASSERT_EQ(v.at("list"_h).at(-1).as<int32_t>(), 3);
+    ASSERT_EQ(v.at("obj"_h).at("k"_h).as<int32_t>(), 1);
+    ASSERT_THROW(v.at("missing"_h), std::out_of_range);
+    ASSERT_THROW(v.at(0), bp::structure::type_error);
+    ASSERT_TRUE(v.at("int"_h).is<int>());
+
+    int sum = 0;
+    for (auto item: v.at("list"_h).as_array()) {
+        sum += item.as<int32_t>();
+    }
+    ASSERT_EQ(sum, 6);
+
+    size_t count = 0;
+    for (auto kv: v.as_object()) {
+        ASSERT_TRUE(kv.second == bp::structure_view(s.at(kv.first)));
+        ++count;
+    }
+    ASSERT_EQ(count, 6);
+    count = 0;
+    for (auto key: v.keys()) {
+        ASSERT_TRUE(s.has_key(key));
+        ++count;
+    }
+    ASSERT_EQ(count, 6);
+    ASSERT_TRUE(v.at("int"_h).as_object().begin() == v.at("int"_h).as_object().end());
+    ASSERT_TRUE(bp::structure_view().is_null());
+}
+
+TEST(ViewTest, borrowed) {
+    static_assert(sizeof(bp::structure_view) == sizeof(void *), "view must be a plain pointer");
+    bp::structure s;
+    s["list"].append(1);
+    s["list"].append(2);
+    bp::structure_view list = bp::structure_view(s).at("list"_h);
+    auto it = list.as_array().begin();
+    ASSERT_EQ((*(it + 1)).as<int32_t>(), 2);
+    ASSERT_EQ(list.as_array().end() - it, 2);
+}